@@ -0,0 +1,16 @@
+#pragma once
+
+#include <QtGlobal>
+
+// 重采样后的交错 PCM（有符号整数、小端）的接收端。
+// 默认是声卡输出（FFmpeg::AudioPlayer），无界面/无声卡时可换成 HeadlessAudioSink
+class AudioSink {
+public:
+    virtual ~AudioSink() = default;
+
+    // 格式变化时调用，可能被调用多次
+    virtual void open(int sampleRate, int channels, int bitsPerSample) = 0;
+
+    // 在音频线程调用
+    virtual void write(const char *data, qint64 bytes) = 0;
+};
@@ -0,0 +1,56 @@
+#include "CommandQueue.h"
+#include <spdlog/fmt/fmt.h>
+
+CommandQueue::CommandQueue() {
+    Node *stub = new Node;
+    mHead.store(stub, std::memory_order_relaxed);
+    mTail = stub;
+}
+
+CommandQueue::~CommandQueue() {
+    while (Node *node = mTail) {
+        mTail = node->next.load(std::memory_order_relaxed);
+        delete node;
+    }
+}
+
+uint64_t CommandQueue::push(PlayerCommand::Type type, int64_t value) {
+    Node *node = new Node;
+    node->command.type = type;
+    node->command.value = value;
+    const uint64_t sequence = mSequence.fetch_add(
+                                  1, std::memory_order_relaxed) + 1;
+    node->command.sequence = sequence;
+    node->command.issued = std::chrono::steady_clock::now();
+    // exchange 之后、链接之前的短暂间隙里，消费者看到的队列在此处截止
+    Node *prev = mHead.exchange(node, std::memory_order_acq_rel);
+    // 链接之后节点可能已被消费者取走释放，不能再访问
+    prev->next.store(node, std::memory_order_release);
+    return sequence;
+}
+
+bool CommandQueue::pop(PlayerCommand &command) {
+    Node *tail = mTail;
+    Node *next = tail->next.load(std::memory_order_acquire);
+    if (!next) {
+        return false;
+    }
+    command = next->command;
+    mTail = next;
+    delete tail;
+    return true;
+}
+
+void CommandQueue::clear() {
+    PlayerCommand dropped;
+    while (pop(dropped)) {}
+}
+
+std::string CommandTimings::report() const {
+    return fmt::format("commands={} (last #{}) coalesced seeks={} "
+                       "apply avg={:.2f}ms max={:.2f}ms | seeks={} "
+                       "to first frame avg={:.1f}ms max={:.1f}ms",
+                       commands, lastSequence, coalesced,
+                       commands ? totalApplyMs / commands : 0.0, maxApplyMs,
+                       seeks, seeks ? totalSeekMs / seeks : 0.0, maxSeekMs);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// 播放控制命令，由界面线程发出，流水线在固定的检查点取出并应用
+struct PlayerCommand {
+    enum class Type {
+        Pause,
+        Resume,
+        Seek,
+        Speed,
+    };
+
+    Type type = Type::Pause;
+    // Seek 为目标毫秒，Speed 非 0 为加速
+    int64_t value = 0;
+    // 从 1 开始，每个队列单调递增
+    uint64_t sequence = 0;
+    std::chrono::steady_clock::time_point issued;
+};
+
+// 无锁多生产者单消费者队列（Vyukov 节点链表）。push 只有一次 exchange，
+// 任意线程可调用；pop 同一时刻只能有一个线程调用
+class CommandQueue {
+public:
+    CommandQueue();
+    ~CommandQueue();
+
+    CommandQueue(const CommandQueue &) = delete;
+    CommandQueue &operator=(const CommandQueue &) = delete;
+
+    // 返回命令的序号。并发 push 时按入队顺序取出，序号可能与之相差
+    uint64_t push(PlayerCommand::Type type, int64_t value = 0);
+
+    // 队列空（或生产者还没链接好节点）时返回 false
+    bool pop(PlayerCommand &command);
+
+    // 丢弃所有命令（消费者调用）
+    void clear();
+
+private:
+    struct Node {
+        std::atomic<Node *> next{nullptr};
+        PlayerCommand command;
+    };
+
+    // 生产者从 mHead 入队，消费者从 mTail 出队，mTail 始终是已取走的哨兵
+    alignas(64) std::atomic<Node *> mHead;
+    alignas(64) Node *mTail;
+    std::atomic<uint64_t> mSequence{0};
+};
+
+// 命令从发出到生效的耗时
+struct CommandTimings {
+    uint64_t commands = 0;
+    // 同一批中被之后的 seek 取代、没有执行的 seek
+    uint64_t coalesced = 0;
+    uint64_t lastSequence = 0;
+    // 发出 → 被流水线取出并应用
+    double totalApplyMs = 0.0;
+    double maxApplyMs = 0.0;
+    // seek 发出 → 新位置的第一帧（视频或音频）送出
+    uint64_t seeks = 0;
+    double totalSeekMs = 0.0;
+    double maxSeekMs = 0.0;
+
+    std::string report() const;
+};
@@ -1,12 +1,9 @@
 #pragma once
 
 
-#include <vector>
+#include "FrameTypes.h"
 #include <QWidget>
 #include <QStyle>
-struct AVFrame;
-using VideoFrame = AVFrame *;
-using AudioFrame = std::vector<const char *>;
 
 namespace g {
 inline void updateStyle(QWidget *widget) {
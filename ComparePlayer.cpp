@@ -0,0 +1,59 @@
+#include "ComparePlayer.h"
+#include "CompareWidget.h"
+#include <algorithm>
+#include <spdlog/spdlog.h>
+
+#define PREFIX  "[ComparePlayer]"
+
+ComparePlayer::ComparePlayer(CompareWidget *view)
+    : mA(std::make_unique<PlayerController>()),
+      mB(std::make_unique<PlayerController>()) {
+    mB->FollowClock(mA.get());
+    mB->SetAudioSink(&mMute);
+    for (PlayerController *player: {mA.get(), mB.get()}) {
+        // 两路都从关键帧解码到目标帧，seek 后落在同一时间戳上
+        player->SetAccurateSeek(true);
+    }
+    mA->AddVideoSink(view->sink(0));
+    mB->AddVideoSink(view->sink(1));
+}
+
+ComparePlayer::~ComparePlayer() {
+    Close();
+    mB.reset();
+    mA.reset();
+}
+
+void ComparePlayer::Open(const std::string &urlA, const std::string &urlB) {
+    spdlog::info(PREFIX "compare {} | {}", urlA, urlB);
+    mA->Open(urlA);
+    mB->Open(urlB);
+}
+
+void ComparePlayer::Play() {
+    // B 按 A 的起点计时：开始时 A 先走；暂停/继续两边只差一次调用
+    mA->Play();
+    mB->Play();
+}
+
+void ComparePlayer::SeekTo(int64_t positionMs) {
+    // A 的 SeekTo 返回时 seek 已挂起，B 的呈现从这时起等到 A 调整完时钟
+    mA->SeekTo(positionMs);
+    mB->SeekTo(positionMs);
+}
+
+void ComparePlayer::SeekBy(int64_t deltaMs) {
+    const auto [current, total] = CurrentPosition();
+    SeekTo(std::clamp<int64_t>(current + deltaMs, 0,
+                               std::max<int64_t>(total, 0)));
+}
+
+void ComparePlayer::Close() {
+    // B 引用 A 的时钟，先停
+    mB->Close();
+    mA->Close();
+}
+
+std::pair<int64_t, int64_t> ComparePlayer::CurrentPosition() const {
+    return mA->CurrentPosition();
+}
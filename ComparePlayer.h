@@ -0,0 +1,36 @@
+#pragma once
+
+#include "HeadlessSinks.h"
+#include "PlayerController.h"
+#include <memory>
+#include <string>
+
+class CompareWidget;
+
+// 编码对比播放：两个播放会话共用 A 的时钟（B 跟随 A），一起暂停、
+// 一起精确 seek 到同一帧；A 出声，B 静音。帧送到 CompareWidget 的两侧
+class ComparePlayer {
+public:
+    // view 需比 ComparePlayer 活得久
+    explicit ComparePlayer(CompareWidget *view);
+    ~ComparePlayer();
+
+    ComparePlayer(const ComparePlayer &) = delete;
+    ComparePlayer &operator=(const ComparePlayer &) = delete;
+
+    void Open(const std::string &urlA, const std::string &urlB);
+    // 开始/暂停/继续，两路同步切换
+    void Play();
+    void SeekTo(int64_t positionMs);
+    void SeekBy(int64_t deltaMs);
+    void Close();
+
+    // A 的位置（B 与之相同）和时长
+    std::pair<int64_t, int64_t> CurrentPosition() const;
+
+private:
+    HeadlessAudioSink mMute;
+    // mB 跟随 mA 的时钟，先析构
+    std::unique_ptr<PlayerController> mA;
+    std::unique_ptr<PlayerController> mB;
+};
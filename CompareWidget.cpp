@@ -0,0 +1,420 @@
+#include "CompareWidget.h"
+
+#include "QualityMetrics.h"
+#include "YuvConverter.h"
+#include "RepaintCoalescer.h"
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QPainterPath>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/fmt.h>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#define PREFIX  "[CompareWidget]"
+
+namespace {
+constexpr qint64 kSeekStepMs = 5000;
+// 等待另一路配对的帧数上限，超过即算错帧
+constexpr size_t kMaxUnmatched = 16;
+constexpr double kDefaultIntervalMs = 40.0;
+// 前若干次错帧逐条记录，之后每 kMismatchLogEvery 条记一次
+constexpr uint64_t kMismatchLogFirst = 10;
+constexpr uint64_t kMismatchLogEvery = 100;
+// 质量曲线：最近的样本数、高度和纵轴范围
+constexpr size_t kGraphSamples = 240;
+constexpr int kGraphHeight = 72;
+constexpr double kPsnrMin = 20.0;
+constexpr double kPsnrMax = 60.0;
+constexpr double kSsimMin = 0.8;
+
+double timestampMs(const AVFrame *frame) {
+    const double base = frame->time_base.num && frame->time_base.den
+                            ? av_q2d(frame->time_base)
+                            : 0.001;
+    return static_cast<double>(frame->pts) * base * 1000.0;
+}
+
+// 半透明底上画 PSNR（绿，kPsnrMin..kPsnrMax dB）和 SSIM（青，kSsimMin..1）
+// 曲线，左上角标最新一帧的数值
+void drawQualityGraph(QPainter &painter, const QRect &area,
+                      const std::vector<QualityMetrics::Sample> &samples) {
+    painter.fillRect(area, QColor(0, 0, 0, 160));
+    const auto plot = [&](auto value, double low, double high) {
+        QPainterPath path;
+        const double step = area.width() /
+                            static_cast<double>(kGraphSamples - 1);
+        for (size_t i = 0; i < samples.size(); ++i) {
+            const double t = std::clamp(
+                (value(samples[i]) - low) / (high - low), 0.0, 1.0);
+            const QPointF point{
+                area.right() - step * static_cast<double>(
+                    samples.size() - 1 - i),
+                area.bottom() - t * area.height()
+            };
+            if (i == 0) {
+                path.moveTo(point);
+            } else {
+                path.lineTo(point);
+            }
+        }
+        painter.drawPath(path);
+    };
+    painter.save();
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setPen(Qt::green);
+    plot([](const auto &s) { return s.psnr; }, kPsnrMin, kPsnrMax);
+    painter.setPen(Qt::cyan);
+    plot([](const auto &s) { return s.ssim; }, kSsimMin, 1.0);
+    painter.restore();
+    const QualityMetrics::Sample &last = samples.back();
+    painter.drawText(area.left() + 8, area.top() + 14,
+                     QString("PSNR %1dB (Y %2 U %3 V %4)  SSIM %5 (Y %6)")
+                     .arg(last.psnr, 0, 'f', 2).arg(last.psnrY, 0, 'f', 2)
+                     .arg(last.psnrU, 0, 'f', 2).arg(last.psnrV, 0, 'f', 2)
+                     .arg(last.ssim, 0, 'f', 4).arg(last.ssimY, 0, 'f', 4));
+}
+}
+
+struct CompareWidget::Side : VideoSink {
+    Side(Impl *view, int index): view(view), index(index) {}
+
+    void onVideoFrame(const FrameRef &frame) override;
+
+    void onVideoRotation(int value) override;
+
+    Impl *view;
+    const int index;
+    FrameRef last;
+    int rotation = 0;
+    // 已缩放到目标区域的 RGB32
+    std::vector<uint8_t> rgba;
+    QRect target;
+    int stride = 0;
+    // 未配对的帧（只在计算质量时保留引用）和相邻帧间隔（用于配对容差）
+    struct Pending {
+        double ms;
+        FrameRef frame;
+    };
+    std::deque<Pending> unmatched;
+    double lastMs = -1.0;
+    double intervalMs = kDefaultIntervalMs;
+};
+
+struct CompareWidget::Impl {
+    std::mutex mtx;
+    std::array<std::unique_ptr<Side>, 2> sides;
+    Mode mode = Mode::SideBySide;
+    QRect viewRect;
+    // 擦除分割线位置（0..1）
+    double wipe = 0.5;
+    bool visible = false;
+    PairStats stats;
+    QualityMetrics *metrics = nullptr;
+    std::unique_ptr<RepaintCoalescer> repaint;
+
+    // 需持有 mtx
+    QRect areaFor(const Side &side) const {
+        if (mode == Mode::Wipe) {
+            return viewRect;
+        }
+        const int half = viewRect.width() / 2;
+        return side.index == 0
+                   ? QRect{viewRect.left(), viewRect.top(), half,
+                           viewRect.height()}
+                   : QRect{viewRect.left() + half, viewRect.top(),
+                           viewRect.width() - half, viewRect.height()};
+    }
+
+    // 需持有 mtx
+    void renderLocked(Side &side) {
+        const AVFrame *frame = side.last.get();
+        if (!frame || !YuvConverter::isSupported(frame->format)) {
+            return;
+        }
+        const bool swap = side.rotation == 90 || side.rotation == 270;
+        side.target = fit(areaFor(side), swap ? frame->height : frame->width,
+                          swap ? frame->width : frame->height);
+        if (side.target.width() < 2 || side.target.height() < 2) {
+            return;
+        }
+        side.stride = side.target.width() * 4;
+        side.rgba.resize(static_cast<size_t>(side.stride) *
+                         side.target.height());
+        YuvConverter::instance().convertScaled(
+            frame, side.rgba.data(), side.stride, side.target.width(),
+            side.target.height(), side.rotation);
+    }
+
+    static QRect fit(const QRect &outer, int w, int h) {
+        if (w <= 0 || h <= 0) {
+            return {};
+        }
+        const bool widthLimited = outer.width() * h < outer.height() * w;
+        const int scaledW = widthLimited ? outer.width() : w * outer.height() / h;
+        const int scaledH = widthLimited ? h * outer.width() / w : outer.height();
+        return {
+            outer.left() + (outer.width() - scaledW) / 2,
+            outer.top() + (outer.height() - scaledH) / 2,
+            scaledW & ~1, scaledH & ~1
+        };
+    }
+
+    void mismatch(int side, double ms) {
+        ++stats.mismatches;
+        if (stats.mismatches <= kMismatchLogFirst ||
+            stats.mismatches % kMismatchLogEvery == 0) {
+            spdlog::warn(PREFIX "unpaired frame on {} at {:.1f}ms "
+                         "(mismatches:{})", side == 0 ? "A" : "B", ms,
+                         stats.mismatches);
+        }
+    }
+
+    // 需持有 mtx。新帧先与另一路等待中的帧配对；另一路中更早且已
+    // 超出容差的帧再也不会有配对，记为错帧
+    void pair(Side &mine, double ms, const FrameRef &frame) {
+        Side &other = *sides[1 - mine.index];
+        if (mine.lastMs >= 0 && ms > mine.lastMs) {
+            mine.intervalMs = ms - mine.lastMs;
+        }
+        if (mine.lastMs >= 0 && ms < mine.lastMs - mine.intervalMs / 2) {
+            // 时间戳倒退：seek，之前等待配对的帧作废
+            mine.unmatched.clear();
+            other.unmatched.clear();
+        }
+        mine.lastMs = ms;
+        const double tolerance = std::min(mine.intervalMs, other.intervalMs)
+                                 / 2;
+        while (!other.unmatched.empty() &&
+               other.unmatched.front().ms < ms - tolerance) {
+            mismatch(other.index, other.unmatched.front().ms);
+            other.unmatched.pop_front();
+        }
+        if (!other.unmatched.empty() &&
+            std::abs(other.unmatched.front().ms - ms) <= tolerance) {
+            const Side::Pending &match = other.unmatched.front();
+            ++stats.pairs;
+            stats.maxSkewMs = std::max(stats.maxSkewMs,
+                                       std::abs(match.ms - ms));
+            if (metrics && match.frame) {
+                const bool mineIsA = mine.index == 0;
+                metrics->submit(mineIsA ? frame.get() : match.frame.get(),
+                                mineIsA ? match.frame.get() : frame.get(),
+                                mineIsA ? ms : match.ms);
+            }
+            other.unmatched.pop_front();
+            return;
+        }
+        mine.unmatched.push_back({ms, metrics ? frame : FrameRef{}});
+        if (mine.unmatched.size() > kMaxUnmatched) {
+            mismatch(mine.index, mine.unmatched.front().ms);
+            mine.unmatched.pop_front();
+        }
+    }
+};
+
+void CompareWidget::Side::onVideoFrame(const FrameRef &frame) {
+    {
+        std::lock_guard lock(view->mtx);
+        last = frame;
+        view->pair(*this, timestampMs(frame.get()), frame);
+        if (!view->visible) {
+            return;
+        }
+        view->renderLocked(*this);
+    }
+    view->repaint->markDirty();
+}
+
+void CompareWidget::Side::onVideoRotation(int value) {
+    std::lock_guard lock(view->mtx);
+    rotation = value;
+    view->renderLocked(*this);
+}
+
+CompareWidget::CompareWidget(QWidget *parent): QWidget(parent),
+                                               mImpl(new Impl{}) {
+    for (int i = 0; i < 2; ++i) {
+        mImpl->sides[i] = std::make_unique<Side>(mImpl, i);
+    }
+    mImpl->repaint = std::make_unique<RepaintCoalescer>(this);
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    setFocusPolicy(Qt::StrongFocus);
+}
+
+CompareWidget::~CompareWidget() {
+    spdlog::info(PREFIX "{}", report());
+    delete mImpl;
+}
+
+VideoSink *CompareWidget::sink(int side) const {
+    return side == 0 || side == 1 ? mImpl->sides[side].get() : nullptr;
+}
+
+void CompareWidget::setMode(Mode mode) {
+    {
+        std::lock_guard lock(mImpl->mtx);
+        mImpl->mode = mode;
+        for (auto &side: mImpl->sides) {
+            mImpl->renderLocked(*side);
+        }
+    }
+    update();
+}
+
+CompareWidget::Mode CompareWidget::mode() const {
+    std::lock_guard lock(mImpl->mtx);
+    return mImpl->mode;
+}
+
+void CompareWidget::setMetrics(QualityMetrics *metrics) {
+    std::lock_guard lock(mImpl->mtx);
+    mImpl->metrics = metrics;
+    for (auto &side: mImpl->sides) {
+        side->unmatched.clear();
+    }
+}
+
+CompareWidget::PairStats CompareWidget::pairStats() const {
+    std::lock_guard lock(mImpl->mtx);
+    return mImpl->stats;
+}
+
+std::string CompareWidget::report() const {
+    const PairStats stats = pairStats();
+    return fmt::format("pairs={} mismatches={} max skew={:.2f}ms",
+                       stats.pairs, stats.mismatches, stats.maxSkewMs);
+}
+
+void CompareWidget::paintEvent(QPaintEvent *event) {
+    (void)event;
+    // metrics 只在 GUI 线程设置，取历史不需要持有 mtx
+    const std::vector<QualityMetrics::Sample> samples =
+        mImpl->metrics ? mImpl->metrics->history(kGraphSamples)
+                       : std::vector<QualityMetrics::Sample>{};
+    QPainter painter(this);
+    painter.fillRect(rect(), Qt::black);
+    std::lock_guard lock(mImpl->mtx);
+    const int wipeX = static_cast<int>(mImpl->viewRect.width() * mImpl->wipe);
+    for (auto &side: mImpl->sides) {
+        if (side->rgba.empty()) {
+            continue;
+        }
+        const QImage image(side->rgba.data(), side->target.width(),
+                           side->target.height(), side->stride,
+                           QImage::Format_ARGB32);
+        if (mImpl->mode == Mode::Wipe) {
+            painter.save();
+            painter.setClipRect(side->index == 0
+                                    ? QRect{0, 0, wipeX, height()}
+                                    : QRect{wipeX, 0, width() - wipeX,
+                                            height()});
+            painter.drawImage(side->target.topLeft(), image);
+            painter.restore();
+        } else {
+            painter.drawImage(side->target.topLeft(), image);
+        }
+    }
+    painter.setPen(Qt::yellow);
+    if (mImpl->mode == Mode::Wipe) {
+        painter.drawLine(wipeX, 0, wipeX, height());
+    }
+    const auto label = [&](const Side &side) {
+        const AVFrame *frame = side.last.get();
+        return frame
+                   ? QString("%1 %2ms").arg(side.index == 0 ? "A" : "B")
+                                        .arg(timestampMs(frame), 0, 'f', 1)
+                   : QString(side.index == 0 ? "A" : "B");
+    };
+    painter.drawText(8, 16, label(*mImpl->sides[0]));
+    painter.drawText(mImpl->mode == Mode::Wipe ? wipeX + 8 : width() / 2 + 8,
+                     16, label(*mImpl->sides[1]));
+    painter.drawText(8, height() - 8,
+                     QString("pairs %1  mismatches %2  max skew %3ms")
+                     .arg(mImpl->stats.pairs).arg(mImpl->stats.mismatches)
+                     .arg(mImpl->stats.maxSkewMs, 0, 'f', 2));
+    if (!samples.empty()) {
+        drawQualityGraph(painter, {0, height() - kGraphHeight - 24, width(),
+                                   kGraphHeight}, samples);
+    }
+}
+
+void CompareWidget::resizeEvent(QResizeEvent *event) {
+    {
+        std::lock_guard lock(mImpl->mtx);
+        mImpl->viewRect = rect();
+        for (auto &side: mImpl->sides) {
+            mImpl->renderLocked(*side);
+        }
+    }
+    QWidget::resizeEvent(event);
+}
+
+void CompareWidget::mousePressEvent(QMouseEvent *event) {
+    mouseMoveEvent(event);
+}
+
+void CompareWidget::mouseMoveEvent(QMouseEvent *event) {
+    if (!(event->buttons() & Qt::LeftButton)) {
+        return;
+    }
+    {
+        std::lock_guard lock(mImpl->mtx);
+        mImpl->wipe = std::clamp(
+            event->localPos().x() / std::max(1, width()), 0.0, 1.0);
+    }
+    update();
+}
+
+void CompareWidget::keyPressEvent(QKeyEvent *event) {
+    switch (event->key()) {
+        case Qt::Key_Space:
+            emit pauseRequested();
+            break;
+        case Qt::Key_Left:
+            emit seekRequested(-kSeekStepMs);
+            break;
+        case Qt::Key_Right:
+            emit seekRequested(kSeekStepMs);
+            break;
+        case Qt::Key_W:
+            setMode(mode() == Mode::Wipe ? Mode::SideBySide : Mode::Wipe);
+            break;
+        default:
+            QWidget::keyPressEvent(event);
+            return;
+    }
+    event->accept();
+}
+
+void CompareWidget::showEvent(QShowEvent *event) {
+    {
+        std::lock_guard lock(mImpl->mtx);
+        mImpl->visible = true;
+        for (auto &side: mImpl->sides) {
+            mImpl->renderLocked(*side);
+        }
+    }
+    mImpl->repaint->start();
+    QWidget::showEvent(event);
+}
+
+void CompareWidget::hideEvent(QHideEvent *event) {
+    {
+        std::lock_guard lock(mImpl->mtx);
+        mImpl->visible = false;
+    }
+    mImpl->repaint->stop();
+    QWidget::hideEvent(event);
+}
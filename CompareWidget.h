@@ -0,0 +1,69 @@
+#pragma once
+
+#include "VideoSink.h"
+#include <QWidget>
+#include <string>
+
+class QualityMetrics;
+
+// 两路视频的对比显示：左右并排，或同一画面上用分割线擦除对比
+// （鼠标拖动分割线）。同时按时间戳配对两路送来的帧，统计配对数、
+// 未配对的帧（错帧）和最大时间差，未配对时写日志。设置 QualityMetrics 后
+// 配对成功的帧对交给它计算 PSNR/SSIM，底部画最近的曲线。
+// 按键：空格暂停/继续，左右方向键 seek，W 切换并排/擦除。
+class CompareWidget final : public QWidget {
+    Q_OBJECT
+
+public:
+    enum class Mode {
+        SideBySide,
+        Wipe,
+    };
+
+    struct PairStats {
+        uint64_t pairs = 0;
+        uint64_t mismatches = 0;
+        double maxSkewMs = 0.0;
+    };
+
+    explicit CompareWidget(QWidget *parent = nullptr);
+    ~CompareWidget() override;
+
+    // side 0 为 A（左/分割线左侧），1 为 B
+    VideoSink *sink(int side) const;
+
+    void setMode(Mode mode);
+
+    Mode mode() const;
+
+    // 配对帧的质量计算，nullptr 关闭。metrics 需比控件活得久
+    void setMetrics(QualityMetrics *metrics);
+
+    PairStats pairStats() const;
+
+    std::string report() const;
+
+Q_SIGNALS:
+    void seekRequested(qint64 deltaMs);
+    void pauseRequested();
+
+protected:
+    void paintEvent(QPaintEvent *event) override;
+
+    void resizeEvent(QResizeEvent *event) override;
+
+    void mousePressEvent(QMouseEvent *event) override;
+
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+    void keyPressEvent(QKeyEvent *event) override;
+
+    void showEvent(QShowEvent *event) override;
+
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    struct Side;
+    struct Impl;
+    Impl *mImpl{};
+};
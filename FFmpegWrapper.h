@@ -2,6 +2,7 @@
 #include <QAudioOutput>
 #include <QIODevice>
 #include "SoundTouchTest.h"
+#include "AudioSink.h"
 
 extern "C" {
 #include <libavcodec/avcodec.h>
@@ -10,13 +11,19 @@ extern "C" {
 #include <libswresample/swresample.h>
 #include <libavutil/imgutils.h>
 #include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+#include <libavutil/display.h>
 #include <libavfilter/avfilter.h>
 #include <libavfilter/buffersink.h>
 #include <libavfilter/buffersrc.h>
 }
 
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <source_location>
 #include <spdlog/spdlog.h>
+#include <string>
 #include <vector>
 
 class FFmpeg {
@@ -82,18 +89,58 @@ public:
         warnOnError(videoStream >= 0, videoStream);
     }
 
+    // lowres 为解码降采样级数（宽高各除以 2^lowres），超出解码器支持的部分忽略
     static void openCodec(AVCodecContext *&codecCtx, int streamIndex,
-                          AVFormatContext const *formatCtx) {
+                          AVFormatContext const *formatCtx, int lowres = 0) {
         AVStream *stream = formatCtx->streams[streamIndex];
         AVCodec const *codec = avcodec_find_decoder(stream->codecpar->codec_id);
 
         codecCtx = avcodec_alloc_context3(codec);
 
         avcodec_parameters_to_context(codecCtx, stream->codecpar);
+        if (codec && lowres > 0) {
+            codecCtx->lowres = std::min(lowres, int(codec->max_lowres));
+        }
 
         avcodec_open2(codecCtx, codec, nullptr);
     }
 
+    // 解码输出不小于 maxWidth x maxHeight 的最大 lowres 级数；
+    // 解码器不支持 lowres（如 H.264/HEVC）时为 0
+    static int chooseLowres(const AVStream *stream, int maxWidth,
+                            int maxHeight) {
+        const AVCodec *codec = avcodec_find_decoder(
+            stream->codecpar->codec_id);
+        if (!codec || maxWidth <= 0 || maxHeight <= 0) {
+            return 0;
+        }
+        int lowres = 0;
+        while (lowres < codec->max_lowres &&
+               (stream->codecpar->width >> (lowres + 1)) >= maxWidth &&
+               (stream->codecpar->height >> (lowres + 1)) >= maxHeight) {
+            ++lowres;
+        }
+        return lowres;
+    }
+
+    // 显示矩阵中的旋转角度，归一化为顺时针 0/90/180/270
+    static int getRotation(const AVStream *stream) {
+        const uint8_t *matrix = av_stream_get_side_data(
+            stream, AV_PKT_DATA_DISPLAYMATRIX, nullptr);
+        if (!matrix) {
+            return 0;
+        }
+        // av_display_rotation_get 返回逆时针角度
+        double theta = -av_display_rotation_get(
+            reinterpret_cast<const int32_t *>(matrix));
+        int rotation = static_cast<int>(std::lround(theta / 90.0)) * 90;
+        rotation %= 360;
+        if (rotation < 0) {
+            rotation += 360;
+        }
+        return rotation;
+    }
+
     static HasError readPaket(AVFormatContext *formatCtx, AVPacket *&packet) {
         packet = av_packet_alloc();
 
@@ -158,19 +205,31 @@ public:
     static HasError decodeVideo(AVFrame *frame, std::vector<uint8_t> &aligned_y,
                                 std::vector<uint8_t> &aligned_u,
                                 std::vector<uint8_t> &aligned_v) {
-        if (frame->format != AV_PIX_FMT_YUV420P) {
+        // 仅支持 8 位三平面格式（420/422/444），其余格式直接交给 YuvConverter
+        if (frame->format != AV_PIX_FMT_YUV420P &&
+            frame->format != AV_PIX_FMT_YUV422P &&
+            frame->format != AV_PIX_FMT_YUV444P &&
+            frame->format != AV_PIX_FMT_YUVJ420P &&
+            frame->format != AV_PIX_FMT_YUVJ422P &&
+            frame->format != AV_PIX_FMT_YUVJ444P) {
             spdlog::error("decodeVideo format:{}", frame->format);
             return Error;
         }
+        int shift_x = 0;
+        int shift_y = 0;
+        av_pix_fmt_get_chroma_sub_sample(
+            static_cast<AVPixelFormat>(frame->format), &shift_x, &shift_y);
 
+        const int uv_width = AV_CEIL_RSHIFT(frame->width, shift_x);
+        const int uv_height = AV_CEIL_RSHIFT(frame->height, shift_y);
         int y_size = frame->width * frame->height;
-        int uv_size = y_size / 4;
+        int uv_size = uv_width * uv_height;
         aligned_y = std::vector<uint8_t>(y_size);
         aligned_u = std::vector<uint8_t>(uv_size);
         aligned_v = std::vector<uint8_t>(uv_size);
 
-        if (frame->linesize[0] == frame->width && frame->linesize[1] == frame->
-            width / 2) {
+        if (frame->linesize[0] == frame->width && frame->linesize[1] ==
+            uv_width && frame->linesize[2] == uv_width) {
             std::memcpy(
                 aligned_y.data(),
                 frame->data[0],
@@ -199,16 +258,16 @@ public:
             }
 
             // 拷贝 U 和 V 分量
-            for (int i = 0; i < frame->height / 2; ++i) {
+            for (int i = 0; i < uv_height; ++i) {
                 std::memcpy(
-                    aligned_u.data() + i * frame->width / 2,
+                    aligned_u.data() + i * uv_width,
                     frame->data[1] + i * frame->linesize[1],
-                    frame->width / 2
+                    uv_width
                     );
                 std::memcpy(
-                    aligned_v.data() + i * frame->width / 2,
+                    aligned_v.data() + i * uv_width,
                     frame->data[2] + i * frame->linesize[2],
-                    frame->width / 2
+                    uv_width
                     );
             }
         }
@@ -217,14 +276,22 @@ public:
     }
 
 
-    class AudioPlayer {
+    class AudioPlayer : public AudioSink {
     public:
         AudioPlayer() : audioOutput(nullptr), outputDevice(nullptr) {}
 
-        ~AudioPlayer() {
+        ~AudioPlayer() override {
             Quit(); // 析构时也确保资源清理
         }
 
+        void open(int sampleRate, int channels, int bitsPerSample) override {
+            SetFormat(0, sampleRate, bitsPerSample, channels);
+        }
+
+        void write(const char *data, qint64 bytes) override {
+            writeData(data, bytes);
+        }
+
         void SetFormat(int dst_nb_samples, int rate, int sample_size, int nch) {
             Quit(); // 保证旧的 QAudioOutput 释放
 
@@ -357,8 +424,7 @@ public:
             }
 
             int data_size = av_get_bytes_per_sample(dst_sample_fmt_);
-            audioPlayer.SetFormat(dst_nb_samples_, dst_rate, data_size * 8,
-                                  dst_nb_channels);
+            output_->open(dst_rate, dst_nb_channels, data_size * 8);
             return 0;
         }
 
@@ -385,7 +451,8 @@ public:
             return 0;
         }
 
-        int SwrConvert() {
+        // 只转换不输出，结果在 OutputData()，返回字节数
+        int Convert() {
             int ret = swr_convert(swr_ctx, dst_data_, dst_nb_samples_,
                                   (uint8_t const **)src_data_, src_nb_samples_);
             if (ret < 0) {
@@ -393,16 +460,22 @@ public:
                 exit(1);
             }
 
-            int dst_bufsize = av_samples_get_buffer_size(
+            return av_samples_get_buffer_size(
                 &dst_linesize, dst_nb_channels,
                 ret, dst_sample_fmt_, 1);
+        }
+
+        // 交错格式的转换结果
+        const char *OutputData() const {
+            return (const char *)(dst_data_[0]);
+        }
+
+        int SwrConvert() {
+            int dst_bufsize = Convert();
 
             int planar = av_sample_fmt_is_planar(dst_sample_fmt_);
-            if (planar) {
-                int data_size = av_get_bytes_per_sample(dst_sample_fmt_);
-            } else {
-                audioPlayer.writeData((const char *)(dst_data_[0]),
-                                      dst_bufsize);
+            if (!planar) {
+                output_->write(OutputData(), dst_bufsize);
             }
 
             return dst_bufsize;
@@ -424,9 +497,15 @@ public:
             swr_free(&swr_ctx);
         }
 
+        // 输出端，nullptr 恢复为声卡。需在 Init 之前设置
+        void SetOutput(AudioSink *output) {
+            output_ = output ? output : &audioPlayer;
+        }
+
         AudioPlayer audioPlayer;
 
     private:
+        AudioSink *output_{&audioPlayer};
         struct SwrContext *swr_ctx;
 
         uint8_t **src_data_;
@@ -445,12 +524,193 @@ public:
 #endif
     };
 
-    static HasError decodeAudio(SwrResample *&swrResample, AVFrame *frame,
-                                AVCodecContext *audioCodecCtx, int speed = 1.0
-        ) {
+    // buffer -> description -> buffersink 的视频滤镜图，
+    // 使用滤镜图自带的 slice 线程（yadif/bwdif 等支持按行并行）
+    class FilterGraph {
+    public:
+        FilterGraph() {}
+
+        ~FilterGraph() {
+            Close();
+        }
+
+        FilterGraph(const FilterGraph &) = delete;
+        FilterGraph &operator=(const FilterGraph &) = delete;
 
+        // 按 frame 的尺寸/格式建立滤镜图。threads 为 0 时由 libavfilter 决定
+        int Init(const AVFrame *frame, AVRational timeBase,
+                 const std::string &description, int threads = 0) {
+            Close();
+            graph_ = avfilter_graph_alloc();
+            if (!graph_) {
+                return AVERROR(ENOMEM);
+            }
+            graph_->nb_threads = threads;
+            graph_->thread_type = AVFILTER_THREAD_SLICE;
+
+            const AVRational sar = frame->sample_aspect_ratio.den
+                                       ? frame->sample_aspect_ratio
+                                       : AVRational{0, 1};
+            char args[256];
+            snprintf(args, sizeof(args),
+                     "video_size=%dx%d:pix_fmt=%d:time_base=%d/%d:"
+                     "pixel_aspect=%d/%d",
+                     frame->width, frame->height, frame->format,
+                     timeBase.num, timeBase.den, sar.num, sar.den);
+            int ret = avfilter_graph_create_filter(
+                &src_, avfilter_get_by_name("buffer"), "in", args, nullptr,
+                graph_);
+            if (ret >= 0) {
+                ret = avfilter_graph_create_filter(
+                    &sink_, avfilter_get_by_name("buffersink"), "out",
+                    nullptr, nullptr, graph_);
+            }
+            if (ret >= 0) {
+                AVFilterInOut *outputs = avfilter_inout_alloc();
+                AVFilterInOut *inputs = avfilter_inout_alloc();
+                outputs->name = av_strdup("in");
+                outputs->filter_ctx = src_;
+                inputs->name = av_strdup("out");
+                inputs->filter_ctx = sink_;
+                ret = avfilter_graph_parse_ptr(graph_, description.c_str(),
+                                               &inputs, &outputs, nullptr);
+                avfilter_inout_free(&inputs);
+                avfilter_inout_free(&outputs);
+            }
+            if (ret >= 0) {
+                ret = avfilter_graph_config(graph_, nullptr);
+            }
+            if (warnOnError(ret >= 0, ret)) {
+                Close();
+                return ret;
+            }
+            width_ = frame->width;
+            height_ = frame->height;
+            format_ = frame->format;
+            description_ = description;
+            return 0;
+        }
+
+        bool IsOpen() const {
+            return graph_ != nullptr;
+        }
+
+        // 输出帧的时间基，fps/setpts 等滤镜会改变它。需已 Init
+        AVRational OutputTimeBase() const {
+            return av_buffersink_get_time_base(sink_);
+        }
+
+        // 输入尺寸/格式与滤镜配置一致
+        bool Matches(const AVFrame *frame,
+                     const std::string &description) const {
+            return graph_ && frame->width == width_ &&
+                   frame->height == height_ && frame->format == format_ &&
+                   description == description_;
+        }
+
+        // 送入一帧（保留调用方的引用），取出当前可得的全部输出帧
+        HasError Filter(const AVFrame *frame, std::vector<AVFrame *> &out) {
+            const auto begin = std::chrono::steady_clock::now();
+            int ret = av_buffersrc_add_frame_flags(
+                src_, const_cast<AVFrame *>(frame),
+                AV_BUFFERSRC_FLAG_KEEP_REF);
+            if (warnOnError(ret >= 0, ret)) {
+                return Error;
+            }
+            while (true) {
+                AVFrame *filtered = av_frame_alloc();
+                ret = av_buffersink_get_frame(sink_, filtered);
+                if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+                    av_frame_free(&filtered);
+                    break;
+                }
+                if (ret < 0) {
+                    av_frame_free(&filtered);
+                    warnOnError(false, ret);
+                    return Error;
+                }
+                out.push_back(filtered);
+            }
+            const double ms = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - begin).count();
+            lastMs_ = ms;
+            totalMs_ += ms;
+            maxMs_ = std::max(maxMs_, ms);
+            ++frames_;
+            return NoError;
+        }
+
+        // 输入结束：取出滤镜内部缓存的帧（yadif、tpad 等）后关闭。
+        // 之后的帧会重建滤镜图
+        HasError Drain(std::vector<AVFrame *> &out) {
+            if (!graph_) {
+                return NoError;
+            }
+            int ret = av_buffersrc_add_frame_flags(src_, nullptr, 0);
+            while (ret >= 0) {
+                AVFrame *filtered = av_frame_alloc();
+                ret = av_buffersink_get_frame(sink_, filtered);
+                if (ret < 0) {
+                    av_frame_free(&filtered);
+                    break;
+                }
+                out.push_back(filtered);
+            }
+            Close();
+            return warnOnError(ret == AVERROR(EAGAIN) || ret == AVERROR_EOF,
+                               ret);
+        }
+
+        void Close() {
+            avfilter_graph_free(&graph_);
+            src_ = nullptr;
+            sink_ = nullptr;
+            description_.clear();
+        }
+
+        // 每帧滤镜耗时统计
+        uint64_t Frames() const {
+            return frames_;
+        }
+
+        double LastMs() const {
+            return lastMs_;
+        }
+
+        double AverageMs() const {
+            return frames_ ? totalMs_ / frames_ : 0.0;
+        }
+
+        double MaxMs() const {
+            return maxMs_;
+        }
+
+        const std::string &Description() const {
+            return description_;
+        }
+
+    private:
+        AVFilterGraph *graph_{};
+        AVFilterContext *src_{};
+        AVFilterContext *sink_{};
+        int width_{};
+        int height_{};
+        int format_{-1};
+        std::string description_;
+        uint64_t frames_{};
+        double lastMs_{};
+        double totalMs_{};
+        double maxMs_{};
+    };
+
+    // 重采样一帧，PCM 留在 swrResample->OutputData() 由调用方输出，
+    // 返回字节数。output 只在第一次调用时用于 open
+    static int resampleAudio(SwrResample *&swrResample, AVFrame *frame,
+                             AVCodecContext *audioCodecCtx,
+                             AudioSink *output) {
         if (!swrResample) {
             swrResample = new SwrResample{};
+            swrResample->SetOutput(output);
 
             int src_ch_layout = audioCodecCtx->channel_layout;
             int src_rate = audioCodecCtx->sample_rate;
@@ -467,8 +727,6 @@ public:
         }
 
         swrResample->WriteInput(frame);
-
-        swrResample->SwrConvert();
-        return NoError;
+        return swrResample->Convert();
     }
 };
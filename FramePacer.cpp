@@ -0,0 +1,135 @@
+#include "FramePacer.h"
+#include <algorithm>
+#include <cmath>
+#include <spdlog/fmt/fmt.h>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace {
+// 帧间隔的合理上限，超过视为不连续（seek、暂停后）
+constexpr std::chrono::seconds kMaxInterval{1};
+}
+
+std::chrono::milliseconds FramePacer::leadFor(double frameIntervalMs) {
+    if (frameIntervalMs <= 0.0) {
+        return kLead;
+    }
+    return std::chrono::milliseconds(
+               static_cast<int64_t>(std::ceil(frameIntervalMs))) +
+           kVsyncAllowance;
+}
+
+FramePacer::~FramePacer() {
+    reset();
+}
+
+void FramePacer::push(AVFrame *frame, Clock::time_point due) {
+    std::lock_guard lock(mMtx);
+    // 预定时间倒退说明发生了 seek，旧帧全部作废，节拍重新开始
+    if (mLastDue != Clock::time_point{} && due <= mLastDue) {
+        while (!mQueue.empty() && mQueue.back().due >= due) {
+            av_frame_free(&mQueue.back().frame);
+            mQueue.pop_back();
+            ++mStats.dropped;
+        }
+        restartCadenceLocked();
+    } else if (mLastDue != Clock::time_point{} &&
+               due - mLastDue < kMaxInterval) {
+        mInterval = due - mLastDue;
+    }
+    mLastDue = due;
+    mQueue.push_back({frame, due});
+}
+
+AVFrame *FramePacer::onVsync(Clock::time_point now,
+                             std::chrono::nanoseconds period) {
+    std::lock_guard lock(mMtx);
+    ++mVsyncs;
+    // 本次绘制会在下一次 vsync 上屏，选预定时间落在它前后半个周期内的最新一帧
+    const Clock::time_point display = now + period;
+    const Clock::time_point limit = display + period / 2;
+    AVFrame *picked = nullptr;
+    while (!mQueue.empty() && mQueue.front().due <= limit) {
+        if (picked) {
+            av_frame_free(&picked);
+            ++mStats.dropped;
+        }
+        picked = mQueue.front().frame;
+        mQueue.pop_front();
+    }
+    if (picked) {
+        recordLocked(display);
+    } else if (mQueue.empty() && mLastPresent != Clock::time_point{} &&
+               (mInterval == Clock::duration{} ||
+                display - mLastPresent > mInterval + period)) {
+        // 超过一个帧间隔没有新帧：暂停或卡顿，这段等待不计入节拍
+        restartCadenceLocked();
+    }
+    return picked;
+}
+
+void FramePacer::recordLocked(Clock::time_point now) {
+    if (mLastPresent != Clock::time_point{}) {
+        const double ms = std::chrono::duration<double, std::milli>(
+            now - mLastPresent).count();
+        ++mStats.vsyncHistogram[std::min(mVsyncs, kBuckets)];
+        ++mStats.presented;
+        mSumMs += ms;
+        mSumSqMs += ms * ms;
+        const double n = static_cast<double>(mStats.presented);
+        mStats.meanMs = mSumMs / n;
+        mStats.stddevMs = std::sqrt(
+            std::max(0.0, mSumSqMs / n - mStats.meanMs * mStats.meanMs));
+    }
+    mLastPresent = now;
+    mVsyncs = 0;
+}
+
+void FramePacer::restartCadenceLocked() {
+    mLastPresent = {};
+    mVsyncs = 0;
+    mInterval = {};
+}
+
+bool FramePacer::active() const {
+    std::lock_guard lock(mMtx);
+    return !mQueue.empty() || mLastPresent != Clock::time_point{};
+}
+
+void FramePacer::reset() {
+    std::lock_guard lock(mMtx);
+    for (Entry &entry: mQueue) {
+        av_frame_free(&entry.frame);
+    }
+    mQueue.clear();
+    mLastDue = {};
+    restartCadenceLocked();
+}
+
+FramePacer::Stats FramePacer::stats() const {
+    std::lock_guard lock(mMtx);
+    return mStats;
+}
+
+void FramePacer::clearStats() {
+    std::lock_guard lock(mMtx);
+    mStats = {};
+    mSumMs = 0.0;
+    mSumSqMs = 0.0;
+}
+
+std::string FramePacer::report() const {
+    const Stats s = stats();
+    std::string text = fmt::format(
+        "presented:{} dropped:{} mean:{:.2f}ms stddev:{:.2f}ms vsyncs:",
+        s.presented, s.dropped, s.meanMs, s.stddevMs);
+    for (int i = 1; i <= kBuckets; ++i) {
+        if (s.vsyncHistogram[i]) {
+            text += fmt::format(" {}{}={}", i, i == kBuckets ? "+" : "",
+                                s.vsyncHistogram[i]);
+        }
+    }
+    return text;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+
+struct AVFrame;
+
+// 按显示刷新节拍挑选要呈现的帧。
+// 解码线程提前 leadFor() 把帧连同预定呈现时间 push 进来；每次 vsync
+// 调用 onVsync()，取预定时间最接近下一次 vsync 的帧，更早的帧丢弃。
+// 同时统计每帧实际停留的 vsync 数，用于衡量抖动（如 24fps@60Hz 的 3:2）。
+// 帧与帧之间队列短暂为空不中断节拍，超过一个帧间隔没有新帧
+// （暂停、卡顿）或预定时间倒退（seek）时才重新开始计数。
+class FramePacer {
+public:
+    using Clock = std::chrono::system_clock;
+
+    // 帧率未知时解码线程提前多久交付帧：24fps 的一个帧间隔加 60Hz 的一个 vsync
+    static constexpr std::chrono::milliseconds kLead{60};
+    // 按 60Hz 计的一个 vsync
+    static constexpr std::chrono::milliseconds kVsyncAllowance{17};
+    // 直方图桶数，最后一桶累计 >= kBuckets 个 vsync
+    static constexpr int kBuckets = 8;
+
+    struct Stats {
+        std::array<uint64_t, kBuckets + 1> vsyncHistogram{};
+        uint64_t presented = 0;
+        uint64_t dropped = 0;
+        double meanMs = 0.0;
+        double stddevMs = 0.0;
+    };
+
+    // 提前量至少为一个帧间隔加一个 vsync，下一帧到达之前队列里总有帧。
+    // frameIntervalMs <= 0（帧率未知）时为 kLead
+    static std::chrono::milliseconds leadFor(double frameIntervalMs);
+
+    FramePacer() = default;
+    ~FramePacer();
+
+    FramePacer(const FramePacer &) = delete;
+    FramePacer &operator=(const FramePacer &) = delete;
+
+    // 线程安全，frame 的引用归 FramePacer 所有
+    void push(AVFrame *frame, Clock::time_point due);
+
+    // 在 vsync 时调用（GUI 线程）。period 为刷新周期。
+    // 有新帧要呈现时返回（调用方负责 av_frame_free），否则返回 nullptr
+    AVFrame *onVsync(Clock::time_point now, std::chrono::nanoseconds period);
+
+    // 队列中有待呈现的帧，或节拍还在进行（需要继续按 vsync 调用 onVsync）
+    bool active() const;
+
+    // 丢弃队列，下一帧重新开始计节拍（控件隐藏、关闭节拍时）
+    void reset();
+
+    Stats stats() const;
+
+    void clearStats();
+
+    // 直方图的单行文本，输出到日志
+    std::string report() const;
+
+private:
+    struct Entry {
+        AVFrame *frame;
+        Clock::time_point due;
+    };
+
+    void recordLocked(Clock::time_point now);
+    void restartCadenceLocked();
+
+    mutable std::mutex mMtx;
+    std::deque<Entry> mQueue;
+    Stats mStats;
+    double mSumMs = 0.0;
+    double mSumSqMs = 0.0;
+    int mVsyncs = 0;               // 当前帧已停留的 vsync 数
+    Clock::time_point mLastPresent{}; // 上一次换帧的时间，空表示节拍未开始
+    Clock::time_point mLastDue{};     // 最近 push 的帧的预定时间
+    Clock::duration mInterval{};      // 相邻两帧预定时间之差，空表示未知
+};
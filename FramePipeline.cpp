@@ -0,0 +1,119 @@
+#include "FramePipeline.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+
+#define PREFIX  "[FramePipeline]"
+
+bool SinkList::add(VideoSink *sink) {
+    std::lock_guard lock(mMtx);
+    if (!sink || std::find(mSinks.begin(), mSinks.end(), sink) !=
+                 mSinks.end()) {
+        return false;
+    }
+    mSinks.push_back(sink);
+    if (sink->alwaysActive()) {
+        ++mAlwaysActive;
+    }
+    return true;
+}
+
+bool SinkList::remove(VideoSink *sink) {
+    std::lock_guard lock(mMtx);
+    auto it = std::find(mSinks.begin(), mSinks.end(), sink);
+    if (it == mSinks.end()) {
+        return false;
+    }
+    mSinks.erase(it);
+    if (sink->alwaysActive()) {
+        --mAlwaysActive;
+    }
+    return true;
+}
+
+void SinkList::clear() {
+    std::lock_guard lock(mMtx);
+    mSinks.clear();
+    mAlwaysActive = 0;
+}
+
+namespace {
+struct CountingVideoSink final : VideoSink {
+    uint64_t frames = 0;
+    int64_t lastDueUs = 0;
+
+    void onVideoFrame(const FrameRef &frame) override {
+        frames += frame->width > 0;
+    }
+
+    void onVideoFrameScheduled(const FrameRef &frame, qint64 dueUs) override {
+        lastDueUs = dueUs;
+        onVideoFrame(frame);
+    }
+
+    bool alwaysActive() const override {
+        return true;
+    }
+};
+
+struct CountingAudioSink final : AudioSink {
+    int64_t bytes = 0;
+
+    void open(int, int, int) override {}
+
+    void write(const char *data, qint64 size) override {
+        (void)data;
+        bytes += size;
+    }
+};
+
+// 与呈现阶段相同的每帧步骤，时钟起点在很久以前，不会真的等待
+template<class Pipeline>
+double runFrames(Pipeline &pipeline, const FrameRef &frame,
+                 const std::vector<char> &pcm, int frames) {
+    using Clock = std::chrono::steady_clock;
+    const auto begin = Clock::now();
+    for (int i = 0; i < frames; ++i) {
+        const int64_t mediaMs = i * int64_t{40};
+        if (!pipeline.videoAlwaysActive() ||
+            pipeline.wait(mediaMs) > std::chrono::system_clock::duration{}) {
+            continue;
+        }
+        // 一半帧按垂直同步节拍交付
+        pipeline.present(frame, mediaMs, i & 1);
+        pipeline.writeAudio(pcm.data(), static_cast<qint64>(pcm.size()));
+    }
+    return std::chrono::duration<double, std::nano>(
+               Clock::now() - begin).count() / frames;
+}
+}
+
+void benchmarkFramePipeline(int frames) {
+    frames = std::max(frames, 1);
+    const FrameRef frame{av_frame_alloc()};
+    frame->width = 1920;
+    frame->height = 1080;
+    // 48kHz 立体声 16 位 20ms
+    const std::vector<char> pcm(3840);
+    PlaybackClock clock;
+    clock.start = std::chrono::system_clock::now() - std::chrono::seconds(1) -
+                  std::chrono::milliseconds(frames * int64_t{40});
+
+    CountingVideoSink runtimeVideo;
+    CountingAudioSink runtimeAudio;
+    RuntimeFramePipeline runtime{clock, &runtimeAudio};
+    runtime.sinks().add(&runtimeVideo);
+    const double runtimeNs = runFrames(runtime, frame, pcm, frames);
+
+    CountingVideoSink staticVideo;
+    CountingAudioSink staticAudio;
+    FramePipeline<StaticSink<CountingVideoSink>, FixedClock,
+                  StaticAudio<CountingAudioSink>> fixed{
+        clock, staticAudio, staticVideo
+    };
+    const double staticNs = runFrames(fixed, frame, pcm, frames);
+
+    spdlog::info(PREFIX "{} frames: runtime {:.1f}ns/frame ({} frames, {} "
+                 "bytes), static {:.1f}ns/frame ({} frames, {} bytes)",
+                 frames, runtimeNs, runtimeVideo.frames, runtimeAudio.bytes,
+                 staticNs, staticVideo.frames, staticAudio.bytes);
+}
@@ -0,0 +1,262 @@
+#pragma once
+
+#include "AudioSink.h"
+#include "VideoSink.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// 播放时钟：起点和暂停累计（暂停、seek 时调整）。
+// 媒体时间 t 的呈现时刻为 start + pauseTime + t。
+// 对比播放时由主播放器写、跟随者的呈现阶段读，两者都是原子量
+struct PlaybackClock {
+    std::atomic<std::chrono::system_clock::time_point> start{};
+    std::atomic<std::chrono::milliseconds> pauseTime{};
+
+    std::chrono::system_clock::time_point origin() const {
+        return start.load() + pauseTime.load();
+    }
+};
+
+// ---- 视频接收端策略：alwaysActive()、deliver(frame, scheduled, dueUs)、
+// rotate(rotation) ----
+
+// 运行时可增删的 VideoSink 列表，视频线程持锁按注册顺序虚调用
+class SinkList {
+public:
+    // 重复添加或空指针返回 false
+    bool add(VideoSink *sink);
+    bool remove(VideoSink *sink);
+    void clear();
+
+    // 是否有隐藏时仍需要每一帧的接收端
+    bool alwaysActive() const {
+        return mAlwaysActive > 0;
+    }
+
+    void deliver(const FrameRef &frame, bool scheduled, qint64 dueUs) {
+        std::lock_guard lock(mMtx);
+        for (VideoSink *sink: mSinks) {
+            if (scheduled) {
+                sink->onVideoFrameScheduled(frame, dueUs);
+            } else {
+                sink->onVideoFrame(frame);
+            }
+        }
+    }
+
+    void rotate(int rotation) {
+        forEach([rotation](VideoSink *sink) {
+            sink->onVideoRotation(rotation);
+        });
+    }
+
+    template<class F>
+    void forEach(F &&f) {
+        std::lock_guard lock(mMtx);
+        for (VideoSink *sink: mSinks) {
+            f(sink);
+        }
+    }
+
+private:
+    std::mutex mMtx;
+    std::vector<VideoSink *> mSinks;
+    std::atomic_int mAlwaysActive = 0;
+};
+
+// 编译期确定的单个接收端：按限定名调用，不经虚表和锁，可以内联
+template<class Sink>
+class StaticSink {
+public:
+    explicit StaticSink(Sink &sink): mSink(sink) {}
+
+    bool alwaysActive() const {
+        return mSink.Sink::alwaysActive();
+    }
+
+    void deliver(const FrameRef &frame, bool scheduled, qint64 dueUs) {
+        if (scheduled) {
+            mSink.Sink::onVideoFrameScheduled(frame, dueUs);
+        } else {
+            mSink.Sink::onVideoFrame(frame);
+        }
+    }
+
+    void rotate(int rotation) {
+        mSink.Sink::onVideoRotation(rotation);
+    }
+
+private:
+    Sink &mSink;
+};
+
+// ---- 时钟策略：origin() 为媒体时间 0 的呈现时刻 ----
+
+// 用自己的时钟，或跟随另一个播放器的（对比播放），可随时切换
+class FollowingClock {
+public:
+    explicit FollowingClock(const PlaybackClock &own): mOwn(&own) {}
+
+    // nullptr 恢复用自己的
+    void follow(const PlaybackClock *master) {
+        mMaster = master;
+    }
+
+    const PlaybackClock &current() const {
+        const PlaybackClock *master = mMaster;
+        return master ? *master : *mOwn;
+    }
+
+    std::chrono::system_clock::time_point origin() const {
+        return current().origin();
+    }
+
+private:
+    const PlaybackClock *mOwn;
+    std::atomic<const PlaybackClock *> mMaster{};
+};
+
+// 固定用一个时钟
+class FixedClock {
+public:
+    explicit FixedClock(const PlaybackClock &clock): mClock(clock) {}
+
+    const PlaybackClock &current() const {
+        return mClock;
+    }
+
+    std::chrono::system_clock::time_point origin() const {
+        return mClock.origin();
+    }
+
+private:
+    const PlaybackClock &mClock;
+};
+
+// ---- 音频输出策略：sink() 交给重采样，write(data, bytes) ----
+
+// 运行时可替换的 AudioSink，写之前需已设置
+class AudioSinkRef {
+public:
+    using Target = AudioSink *;
+
+    explicit AudioSinkRef(AudioSink *sink = nullptr): mSink(sink) {}
+
+    void set(AudioSink *sink) {
+        mSink = sink;
+    }
+
+    AudioSink *sink() const {
+        return mSink;
+    }
+
+    void write(const char *data, qint64 bytes) {
+        mSink.load()->write(data, bytes);
+    }
+
+private:
+    std::atomic<AudioSink *> mSink;
+};
+
+// 编译期确定的 AudioSink，按限定名调用
+template<class Sink>
+class StaticAudio {
+public:
+    using Target = Sink &;
+
+    explicit StaticAudio(Sink &sink): mSink(sink) {}
+
+    AudioSink *sink() const {
+        return &mSink;
+    }
+
+    void write(const char *data, qint64 bytes) {
+        mSink.Sink::write(data, bytes);
+    }
+
+private:
+    Sink &mSink;
+};
+
+// 每帧的呈现路径：媒体时间 → 呈现时刻 → 还要等多久 → 交给接收端，
+// 以及 PCM 的输出。按接收端、时钟、音频输出三个策略参数化：
+// 桌面程序用 RuntimeFramePipeline（接收端可增删、可跟随别的时钟）；
+// 接收端和时钟固定的嵌入场景用 StaticSink/FixedClock/StaticAudio，
+// 每帧路径没有虚调用和锁，可整体内联。播放器用哪种在构建时选
+// （PlayerPipeline.h），benchmarkFramePipeline 对比两者
+template<class Sinks, class Clock, class Audio>
+class FramePipeline {
+public:
+    template<class... SinkArgs>
+    FramePipeline(const PlaybackClock &clock, typename Audio::Target audio,
+                  SinkArgs &&... sinkArgs)
+        : mSinks(std::forward<SinkArgs>(sinkArgs)...), mClock(clock),
+          mAudio(audio) {}
+
+    Sinks &sinks() {
+        return mSinks;
+    }
+
+    Clock &clock() {
+        return mClock;
+    }
+
+    const Clock &clock() const {
+        return mClock;
+    }
+
+    Audio &audio() {
+        return mAudio;
+    }
+
+    // 媒体时间 mediaMs（相对流起点）的呈现时刻
+    std::chrono::system_clock::time_point deadline(int64_t mediaMs) const {
+        return mClock.origin() + std::chrono::milliseconds(mediaMs);
+    }
+
+    // 离交付还要等多久（提前 lead 交付），不大于 0 时应立即交付
+    std::chrono::system_clock::duration wait(
+        int64_t mediaMs, std::chrono::system_clock::duration lead = {}) const {
+        return deadline(mediaMs) - lead - std::chrono::system_clock::now();
+    }
+
+    // 预定呈现时间，system_clock 微秒
+    qint64 dueUs(int64_t mediaMs) const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(
+            deadline(mediaMs).time_since_epoch()).count();
+    }
+
+    bool videoAlwaysActive() const {
+        return mSinks.alwaysActive();
+    }
+
+    // 顺时针 0/90/180/270，打开文件后通知接收端
+    void rotate(int rotation) {
+        mSinks.rotate(rotation);
+    }
+
+    // scheduled 时带上预定呈现时间（垂直同步节拍）
+    void present(const FrameRef &frame, int64_t mediaMs, bool scheduled) {
+        mSinks.deliver(frame, scheduled, scheduled ? dueUs(mediaMs) : 0);
+    }
+
+    void writeAudio(const char *data, qint64 bytes) {
+        mAudio.write(data, bytes);
+    }
+
+private:
+    Sinks mSinks;
+    Clock mClock;
+    Audio mAudio;
+};
+
+using RuntimeFramePipeline = FramePipeline<SinkList, FollowingClock,
+                                           AudioSinkRef>;
+
+// 同样的接收端分别经 RuntimeFramePipeline 和静态配置，
+// 测每帧（等待计算 + 交付一帧 + 写一块 PCM）的开销
+void benchmarkFramePipeline(int frames = 1000000);
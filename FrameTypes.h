@@ -0,0 +1,7 @@
+#pragma once
+
+#include <vector>
+
+struct AVFrame;
+using VideoFrame = AVFrame *;
+using AudioFrame = std::vector<const char *>;
@@ -0,0 +1,152 @@
+#include "HeadlessSinks.h"
+#include <QtEndian>
+#include <algorithm>
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/fmt.h>
+
+#define PREFIX  "[HeadlessSinks]"
+
+namespace {
+constexpr int kWavHeaderSize = 44;
+
+double msSince(HeadlessVideoSink::Clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(
+        HeadlessVideoSink::Clock::now() - begin).count();
+}
+}
+
+HeadlessVideoSink::HeadlessVideoSink(Mode mode): mMode(mode) {}
+
+void HeadlessVideoSink::onVideoFrame(const FrameRef &frame) {
+    const auto begin = Clock::now();
+    if (mMode == Mode::Memory && frame && YuvConverter::isSupported(
+            frame->format)) {
+        const int stride = frame->width * 4;
+        mBuffer.resize(static_cast<size_t>(stride) * frame->height);
+        mConverter.convert(frame.get(), mBuffer.data(), stride);
+    }
+    const double ms = msSince(begin);
+
+    std::lock_guard lock(mMtx);
+    if (mFrames++ == 0) {
+        mFirst = begin;
+    }
+    mLast = Clock::now();
+    mTotalMs += ms;
+    mMaxMs = std::max(mMaxMs, ms);
+}
+
+HeadlessVideoSink::Clock::time_point HeadlessVideoSink::lastFrameTime() const {
+    std::lock_guard lock(mMtx);
+    return mLast;
+}
+
+std::string HeadlessVideoSink::report() const {
+    std::lock_guard lock(mMtx);
+    const int64_t frames = mFrames;
+    const double seconds = std::chrono::duration<double>(mLast - mFirst).
+        count();
+    return fmt::format(
+        "video[{}] frames={} fps={:.1f} callback avg={:.3f}ms max={:.3f}ms",
+        mMode == Mode::Memory ? "memory" : "null", frames,
+        frames > 1 && seconds > 0 ? (frames - 1) / seconds : 0.0,
+        frames ? mTotalMs / frames : 0.0, mMaxMs);
+}
+
+HeadlessAudioSink::HeadlessAudioSink(const QString &wavPath) {
+    if (wavPath.isEmpty()) {
+        return;
+    }
+    mFile.setFileName(wavPath);
+    if (!mFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        spdlog::error(PREFIX "cannot open {}", wavPath.toStdString());
+        return;
+    }
+    // 占位，格式确定后（open/close）再补写
+    mFile.write(QByteArray(kWavHeaderSize, 0));
+}
+
+HeadlessAudioSink::~HeadlessAudioSink() {
+    close();
+}
+
+void HeadlessAudioSink::open(int sampleRate, int channels, int bitsPerSample) {
+    std::lock_guard lock(mMtx);
+    if (mFile.isOpen() && mBytes > 0 && (
+            sampleRate != mSampleRate || channels != mChannels ||
+            bitsPerSample != mBitsPerSample)) {
+        // WAV 只能有一种格式，中途变化的部分按原格式写入
+        spdlog::warn(PREFIX "format changed mid-stream, keep {}Hz/{}ch/{}bit",
+                     mSampleRate, mChannels, mBitsPerSample);
+        return;
+    }
+    mSampleRate = sampleRate;
+    mChannels = channels;
+    mBitsPerSample = bitsPerSample;
+    if (mFile.isOpen() && mBytes == 0) {
+        writeHeader();
+    }
+}
+
+void HeadlessAudioSink::write(const char *data, qint64 bytes) {
+    const auto begin = Clock::now();
+    std::lock_guard lock(mMtx);
+    if (mFile.isOpen()) {
+        mFile.write(data, bytes);
+    }
+    mBytes += bytes;
+    ++mWrites;
+    mTotalMs += std::chrono::duration<double, std::milli>(
+        Clock::now() - begin).count();
+}
+
+void HeadlessAudioSink::close() {
+    std::lock_guard lock(mMtx);
+    if (!mFile.isOpen()) {
+        return;
+    }
+    writeHeader();
+    mFile.close();
+}
+
+// 调用方持有 mMtx
+void HeadlessAudioSink::writeHeader() {
+    const qint64 pos = mFile.pos();
+    const auto dataBytes = static_cast<quint32>(std::min<int64_t>(
+        mBytes, UINT32_MAX - kWavHeaderSize));
+    const quint16 blockAlign = mChannels * mBitsPerSample / 8;
+
+    char header[kWavHeaderSize];
+    auto put32 = [&](int offset, quint32 v) {
+        qToLittleEndian(v, header + offset);
+    };
+    auto put16 = [&](int offset, quint16 v) {
+        qToLittleEndian(v, header + offset);
+    };
+    std::copy_n("RIFF", 4, header);
+    put32(4, kWavHeaderSize - 8 + dataBytes);
+    std::copy_n("WAVEfmt ", 8, header + 8);
+    put32(16, 16);
+    put16(20, 1); // PCM
+    put16(22, mChannels);
+    put32(24, mSampleRate);
+    put32(28, mSampleRate * blockAlign);
+    put16(32, blockAlign);
+    put16(34, mBitsPerSample);
+    std::copy_n("data", 4, header + 36);
+    put32(40, dataBytes);
+
+    mFile.seek(0);
+    mFile.write(header, kWavHeaderSize);
+    mFile.seek(std::max<qint64>(pos, kWavHeaderSize));
+}
+
+std::string HeadlessAudioSink::report() const {
+    std::lock_guard lock(mMtx);
+    const int bytesPerSecond = mSampleRate * mChannels * mBitsPerSample / 8;
+    return fmt::format(
+        "audio[{}] bytes={} duration={:.2f}s writes={} write avg={:.3f}ms",
+        mFile.fileName().isEmpty() ? "null" : "wav", mBytes,
+        bytesPerSecond ? static_cast<double>(mBytes) / bytesPerSecond : 0.0,
+        mWrites, mWrites ? mTotalMs / mWrites : 0.0);
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "AudioSink.h"
+#include "VideoSink.h"
+#include "YuvConverter.h"
+#include <QFile>
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// 无显示的视频接收端，用于基准测试和 CI：
+// Null 直接丢弃帧，只统计；Memory 额外转换成 RGB32 写进内存缓冲，
+// 计入和 PlayerWidget 相同的像素转换开销。
+class HeadlessVideoSink : public VideoSink {
+public:
+    enum class Mode {
+        Null,
+        Memory,
+    };
+
+    using Clock = std::chrono::steady_clock;
+
+    explicit HeadlessVideoSink(Mode mode = Mode::Null);
+
+    void onVideoFrame(const FrameRef &frame) override;
+
+    // 没有控件可见性，控制器不能因为“不可见”跳过解码
+    bool alwaysActive() const override {
+        return true;
+    }
+
+    int64_t frames() const {
+        return mFrames;
+    }
+
+    // 最近一帧到达的时间，未收到过帧时为 epoch
+    Clock::time_point lastFrameTime() const;
+
+    // 帧数、平均帧率、回调耗时（平均/最大）
+    std::string report() const;
+
+private:
+    Mode mMode;
+    YuvConverter mConverter;
+    std::vector<uint8_t> mBuffer;
+    std::atomic<int64_t> mFrames{0};
+
+    mutable std::mutex mMtx;
+    Clock::time_point mFirst{};
+    Clock::time_point mLast{};
+    double mTotalMs{};
+    double mMaxMs{};
+};
+
+// 无声卡的音频接收端：丢弃 PCM 或写成 WAV 文件（path 非空时），统计吞吐
+class HeadlessAudioSink : public AudioSink {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit HeadlessAudioSink(const QString &wavPath = {});
+    ~HeadlessAudioSink() override;
+
+    void open(int sampleRate, int channels, int bitsPerSample) override;
+
+    void write(const char *data, qint64 bytes) override;
+
+    // 补写 WAV 头中的长度并关闭文件
+    void close();
+
+    int64_t writes() const {
+        std::lock_guard lock(mMtx);
+        return mWrites;
+    }
+
+    // 字节数、折合的音频时长、写入耗时
+    std::string report() const;
+
+private:
+    void writeHeader();
+
+    QFile mFile;
+    mutable std::mutex mMtx;
+    int mSampleRate{};
+    int mChannels{};
+    int mBitsPerSample{};
+    int64_t mBytes{};
+    int64_t mWrites{};
+    double mTotalMs{};
+};
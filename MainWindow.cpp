@@ -2,8 +2,9 @@
 #include <QSplitter>
 #include <QDebug>
 #include <QMenuBar>
-#include "PlayerWidget.h"
+#include "OpenglPlayWidget.h"
 #include "PlayerController.h"
+#include "RendererProbe.h"
 #include <qcoreapplication.h>
 #include <qevent.h>
 #include <QFileDialog>
@@ -19,6 +20,42 @@
 #include <QStandardItemModel>
 #include <QStandardPaths>
 #include <QDateTime>
+#include <QGuiApplication>
+#include <QScreen>
+
+namespace {
+// 连拍张数
+constexpr int kBurstFrames = 10;
+
+// --renderer=cpu|gl|probe 选择显示后端，默认 cpu。
+// probe 在启动时测量两种后端处理一帧的耗时，片源尺寸默认取屏幕分辨率，
+// 可用 --probe-size=WxH 指定
+VideoRenderer::Kind selectRenderer() {
+    VideoRenderer::Kind kind = VideoRenderer::Kind::Cpu;
+    const QScreen *screen = QGuiApplication::primaryScreen();
+    QSize video = screen ? screen->size() * screen->devicePixelRatio()
+                         : QSize{1920, 1080};
+    QString renderer;
+    for (const QString &arg: QCoreApplication::arguments()) {
+        if (arg.startsWith("--renderer=")) {
+            renderer = arg.section('=', 1);
+        } else if (arg.startsWith("--probe-size=")) {
+            const QStringList size = arg.section('=', 1).split('x');
+            if (size.size() == 2) {
+                video = {size[0].toInt(), size[1].toInt()};
+            }
+        }
+    }
+    if (renderer == "probe") {
+        const QSize view = screen ? screen->availableSize() : video;
+        return RendererProbe::run(video, view).best;
+    }
+    if (!renderer.isEmpty() && !VideoRenderer::fromName(renderer, kind)) {
+        spdlog::warn("unknown renderer:{}", renderer.toStdString());
+    }
+    return kind;
+}
+}
 
 MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     this->resize({800, 600});
@@ -50,11 +87,8 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
     widget->setStyleSheet(qss.readAll());
     setCentralWidget(widget);
     auto layout = new QVBoxLayout(widget);
-#ifdef useglwidget
-    mRender =new  OpenglPlayWidget{};
-#else
-    mRender = new PlayerWidget{};
-#endif
+    mRender = VideoRenderer::create(selectRenderer());
+    spdlog::info("renderer:{}", VideoRenderer::name(mRender->kind()));
     {
         // 创建 QListView 和 Model
         mListView = new QListView{};
@@ -69,7 +103,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
         // 使用 QSplitter 实现可拖动布局
         auto *splitter = new QSplitter(Qt::Horizontal);
         splitter->addWidget(mListView);
-        splitter->addWidget(mRender);
+        splitter->addWidget(mRender->widget());
 
         // 设置默认比例
         splitter->setStretchFactor(0, 2);
@@ -78,15 +112,25 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
 
         // 设置最小宽度
         mListView->setMinimumWidth(100);
-        mRender->setMinimumWidth(450);
+        mRender->widget()->setMinimumWidth(450);
         layout->addWidget(splitter);
 
         // 工具栏按钮控制展开/收缩
         auto *toolBar = addToolBar("控制");
         QAction *toggleListAction = new QAction("隐藏列表", this);
         QAction *takeScreenshotAction = new QAction("截图", this);
+        QAction *burstAction = new QAction("连拍", this);
         toolBar->addAction(toggleListAction);
         toolBar->addAction(takeScreenshotAction);
+        toolBar->addAction(burstAction);
+        // 按 vsync 选帧，退出节拍模式时在日志输出抖动直方图
+        if (auto *gl = qobject_cast<OpenglPlayWidget *>(mRender->widget())) {
+            QAction *vsyncPacingAction = new QAction("垂直同步", this);
+            vsyncPacingAction->setCheckable(true);
+            toolBar->addAction(vsyncPacingAction);
+            connect(vsyncPacingAction, &QAction::toggled, gl,
+                    &OpenglPlayWidget::setVsyncPacing);
+        }
 
         connect(takeScreenshotAction, &QAction::triggered, this, [=]() {
             QString picturesDir = QStandardPaths::writableLocation(
@@ -97,13 +141,22 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
                 "screenshot_yyyyMMdd_HHmmss.png");
             QString filePath = picturesDir + "/" + fileName;
 
-            // 保存截图
-            if (mRender && mRender->grab().save(filePath)) {
-                spdlog::info("截图成功：{}", filePath.toStdString());
-            } else {
+            // 从解码帧按原始分辨率截图，编码在后台线程完成
+            if (!mController || !mController->Screenshot(filePath)) {
                 spdlog::error("截图失败");
             }
         });
+        connect(burstAction, &QAction::triggered, this, [=]() {
+            if (!mController) {
+                return;
+            }
+            QString picturesDir = QStandardPaths::writableLocation(
+                QStandardPaths::PicturesLocation);
+            QString baseName = QDateTime::currentDateTime().toString(
+                "burst_yyyyMMdd_HHmmss");
+            mController->ScreenshotBurst(picturesDir + "/" + baseName,
+                                         kBurstFrames);
+        });
         // 保存初始展开尺寸
         int savedListWidth = mListView->width(); // 用于恢复时使用
         connect(toggleListAction, &QAction::triggered, this, [=]() mutable {
@@ -181,7 +234,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
                         return;
                     if (mController->state() != PlayerState::Idle) {
                         delete mController;
-                        mController = new PlayerController{mRender};
+                        mController = mRender->attach(new PlayerController);
                     }
                     QString filePath = model->itemFromIndex(index)->data(
                         Qt::UserRole).toString();
@@ -194,7 +247,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
                 });
     }
 
-    mController = new PlayerController{mRender};
+    mController = mRender->attach(new PlayerController);
 
     auto buttom = new QHBoxLayout{};
 
@@ -326,7 +379,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
         try {
             if (mController->state() != PlayerState::Idle) {
                 delete mController;
-                mController = new PlayerController{mRender};
+                mController = mRender->attach(new PlayerController);
             }
             mController->Open(filePath.toStdString());
             connect(mController, &PlayerController::StateChanged, this,
@@ -350,7 +403,7 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
             try {
                 if (mController->state() != PlayerState::Idle) {
                     delete mController;
-                    mController = new PlayerController{mRender};
+                    mController = mRender->attach(new PlayerController);
                 }
                 mController->Open(url.toStdString());
                 connect(mController, &PlayerController::StateChanged, this,
@@ -369,12 +422,13 @@ MainWindow::MainWindow(QWidget *parent) : QMainWindow(parent) {
 }
 
 MainWindow::~MainWindow() {
-    if (mRender) {
-        delete mRender;
-    }
+    // 控制器的视频线程仍在调用 mRender，先停控制器
     if (mController) {
         delete mController;
     }
+    if (mRender) {
+        delete mRender;
+    }
     if (mProgressTimer) {
         delete mProgressTimer;
     }
@@ -8,8 +8,7 @@ class QSlider;
 class QListView;
 class QPushButton;
 class QTimer;
-class OpenglPlayWidget;
-// #define useglwidget
+class VideoRenderer;
 class MainWindow final : public QMainWindow {
     Q_OBJECT
 
@@ -23,11 +22,7 @@ public Q_SLOTS:
     void OnSliderValueReleased() const;
 
 private:
-#ifdef useglwidget
-    OpenglPlayWidget *mRender{};
-#else
-    PlayerWidget *mRender{};
-#endif
+    VideoRenderer *mRender{};
     PlayerController *mController{};
     QTimer *mProgressTimer{};
     int64_t mCurrentPos;
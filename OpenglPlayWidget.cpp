@@ -1,18 +1,152 @@
 #include "OpenglPlayWidget.h"
 
-#include <libyuv/convert_argb.h>
+#include "YuvConverter.h"
+#include "ToneMapper.h"
+#include "ViewZoom.h"
+#include "RepaintCoalescer.h"
+#include "FramePacer.h"
+#include <QMouseEvent>
+#include <QWheelEvent>
+#include <QOpenGLShaderProgram>
+#include <QScreen>
+#include <QWindow>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+#include <spdlog/spdlog.h>
 
 extern "C" {
 #include <libavutil/frame.h>
 }
 
+#define PREFIX  "[OpenglPlayWidget]"
+
 
 struct OpenglPlayWidget::Impl {
+    std::mutex mtx;
     std::vector<uint8_t> g_rgbaData;
     int g_width = 0;
     int g_height = 0;
     int g_stride = 0;
     unsigned int textureId = 0;
+    // g_rgbaData 中是 AR30（未做色调映射），由 hdrProgram 在 GPU 上映射
+    bool g_isAR30 = false;
+    ToneMapper::HdrInfo g_hdrInfo{};
+    // 保留最近一帧的引用，暂停时变焦/平移也能重新转换
+    AVFrame *g_lastFrame{};
+    ViewZoom zoom;
+    QPoint dragPos;
+    // 隐藏时只保留帧引用，不转换也不重绘
+    std::atomic_bool visible{false};
+    int rotation = 0; // 顺时针
+    QOpenGLShaderProgram *hdrProgram{};
+    std::atomic_bool hdrShaderReady{false};
+    // 内容未变的帧跳过转换；纹理只在 g_rgbaData 更新后重新上传
+    FrameChangeDetector changeDetector;
+    bool g_textureDirty = false;
+    std::unique_ptr<RepaintCoalescer> repaint;
+    // 垂直同步节拍模式
+    std::atomic_bool pacing{false};
+    FramePacer pacer;
+
+    static constexpr const char *kHdrVertex = R"(
+#version 120
+varying vec2 vTex;
+void main() {
+    vTex = gl_MultiTexCoord0.st;
+    gl_Position = gl_Vertex;
+}
+)";
+
+    // 与 ToneMapper 的 CPU 路径一致：EOTF -> BT.2020 转 BT.709 -> Hable -> gamma
+    static constexpr const char *kHdrFragment = R"(
+#version 120
+uniform sampler2D tex;
+uniform int transfer;
+uniform float peakNits;
+varying vec2 vTex;
+
+vec3 hable(vec3 x) {
+    const float A = 0.15;
+    const float B = 0.50;
+    const float C = 0.10;
+    const float D = 0.20;
+    const float E = 0.02;
+    const float F = 0.30;
+    return (x * (A * x + C * B) + D * E) / (x * (A * x + B) + D * F) - E / F;
+}
+
+vec3 pqToNits(vec3 e) {
+    const float m1 = 2610.0 / 16384.0;
+    const float m2 = 2523.0 / 4096.0 * 128.0;
+    const float c1 = 3424.0 / 4096.0;
+    const float c2 = 2413.0 / 4096.0 * 32.0;
+    const float c3 = 2392.0 / 4096.0 * 32.0;
+    vec3 p = pow(e, vec3(1.0 / m2));
+    return pow(max(p - c1, 0.0) / (c2 - c3 * p), vec3(1.0 / m1)) * 10000.0;
+}
+
+vec3 hlgToNits(vec3 e) {
+    const float a = 0.17883277;
+    const float b = 0.28466892;
+    const float c = 0.55991073;
+    vec3 low = e * e / 3.0;
+    vec3 high = (exp((e - c) / a) + b) / 12.0;
+    vec3 scene = mix(low, high, step(0.5, e));
+    return peakNits * pow(scene, vec3(1.2));
+}
+
+void main() {
+    vec3 e = texture2D(tex, vTex).rgb;
+    vec3 nits = transfer == 1 ? pqToNits(e) : hlgToNits(e);
+    const mat3 gamut = mat3(1.6605, -0.1246, -0.0182,
+                            -0.5876, 1.1329, -0.1006,
+                            -0.0728, -0.0083, 1.1187);
+    vec3 lin = max(gamut * (nits / 203.0), 0.0);
+    vec3 y = clamp(hable(lin) / hable(vec3(peakNits / 203.0)), 0.0, 1.0);
+    gl_FragColor = vec4(pow(y, vec3(1.0 / 2.2)), 1.0);
+}
+)";
+
+    ~Impl() {
+        av_frame_free(&g_lastFrame);
+    }
+
+    // 需持有 mtx。只转换可见区域，缩放交给纹理采样
+    void renderLocked() {
+        if (!g_lastFrame) {
+            return;
+        }
+        AVFrame *view = nullptr;
+        if (zoom.active()) {
+            const QRect roi = zoom.sourceRect(g_lastFrame->width,
+                                              g_lastFrame->height);
+            view = YuvConverter::cropView(g_lastFrame, roi.x(), roi.y(),
+                                          roi.width(), roi.height());
+        }
+        const AVFrame *frame = view ? view : g_lastFrame;
+        g_width = frame->width;
+        g_height = frame->height;
+        g_stride = g_width * 4;
+        g_rgbaData.resize(static_cast<size_t>(g_stride) * g_height);
+
+        // HDR 帧只转到 AR30，色调映射交给着色器
+        const auto hdrInfo = ToneMapper::probe(frame);
+        g_isAR30 = hdrInfo.transfer != ToneMapper::Transfer::Sdr &&
+                   hdrShaderReady &&
+                   YuvConverter::instance().convertAR30(
+                       frame, g_rgbaData.data(), g_stride);
+        g_hdrInfo = hdrInfo;
+        if (!g_isAR30) {
+            // 调用转换
+            YuvConverter::instance().convert(
+                frame, g_rgbaData.data(), g_stride);
+        }
+        g_textureDirty = true;
+        av_frame_free(&view);
+    }
 
     QRect
     static scaleKeepAspectRatio(const QRect &outer, int inner_w, int inner_h) {
@@ -41,7 +175,68 @@ struct OpenglPlayWidget::Impl {
 };
 
 OpenglPlayWidget::OpenglPlayWidget(QWidget *parent): QOpenGLWidget(parent),
-    mImpl(new Impl{}) {}
+    mImpl(new Impl{}) {
+    mImpl->repaint = std::make_unique<RepaintCoalescer>(this);
+    // 交换阻塞到 vsync，frameSwapped 即为节拍
+    QSurfaceFormat fmt = format();
+    fmt.setSwapInterval(1);
+    setFormat(fmt);
+    connect(this, &QOpenGLWidget::frameSwapped, this, [this] {
+        if (!mImpl->pacing || !mImpl->visible) {
+            return;
+        }
+        const QWindow *window = this->window()->windowHandle();
+        const qreal rate = window && window->screen()
+                               ? window->screen()->refreshRate()
+                               : 60.0;
+        const auto period = std::chrono::nanoseconds(
+            static_cast<int64_t>(1e9 / std::max<qreal>(rate, 1.0)));
+        if (AVFrame *frame = mImpl->pacer.onVsync(
+            FramePacer::Clock::now(), period)) {
+            {
+                std::lock_guard lock(mImpl->mtx);
+                av_frame_free(&mImpl->g_lastFrame);
+                mImpl->g_lastFrame = frame;
+                if (mImpl->changeDetector.changed(frame)) {
+                    mImpl->renderLocked();
+                }
+            }
+            update();
+        } else if (mImpl->pacer.active()) {
+            // 下一帧还没到时间或还没送到，继续按 vsync 计数；
+            // 超过一个帧间隔没有新帧时 pacer 自己结束节拍
+            update();
+        }
+    });
+}
+
+OpenglPlayWidget::~OpenglPlayWidget() {
+    if (mImpl->pacer.stats().presented) {
+        spdlog::info(PREFIX "pacing {}", mImpl->pacer.report());
+    }
+    delete mImpl;
+}
+
+void OpenglPlayWidget::setVsyncPacing(bool enable) {
+    if (enable == mImpl->pacing) {
+        return;
+    }
+    mImpl->pacing = enable;
+    if (!enable) {
+        spdlog::info(PREFIX "pacing {}", mImpl->pacer.report());
+        mImpl->pacer.reset();
+        mImpl->pacer.clearStats();
+    }
+    emit vsyncPacingChanged(enable);
+}
+
+bool OpenglPlayWidget::vsyncPacing() const {
+    return mImpl->pacing;
+}
+
+std::string OpenglPlayWidget::pacingReport() const {
+    return mImpl->pacer.report();
+}
 
 QSize OpenglPlayWidget::sizeHint() const {
     return QOpenGLWidget::sizeHint();
@@ -65,6 +260,25 @@ void OpenglPlayWidget::initializeGL() {
 
     // 解绑纹理
     glBindTexture(GL_TEXTURE_2D, 0);
+    // 上下文重建后纹理为空，需要重新上传
+    {
+        std::lock_guard lock(mImpl->mtx);
+        mImpl->g_textureDirty = true;
+    }
+
+    // HDR 着色器，编译失败时回退到 CPU 色调映射
+    mImpl->hdrProgram = new QOpenGLShaderProgram(this);
+    const bool ok =
+        mImpl->hdrProgram->addShaderFromSourceCode(
+            QOpenGLShader::Vertex, Impl::kHdrVertex) &&
+        mImpl->hdrProgram->addShaderFromSourceCode(
+            QOpenGLShader::Fragment, Impl::kHdrFragment) &&
+        mImpl->hdrProgram->link();
+    if (!ok) {
+        spdlog::warn("hdr shader unavailable: {}",
+                     mImpl->hdrProgram->log().toStdString());
+    }
+    mImpl->hdrShaderReady = ok;
 }
 
 void OpenglPlayWidget::resizeGL(int w, int h) {
@@ -72,56 +286,188 @@ void OpenglPlayWidget::resizeGL(int w, int h) {
 }
 
 void OpenglPlayWidget::paintGL() {
+    std::lock_guard lock(mImpl->mtx);
     if (mImpl->g_rgbaData.empty())
         return;
 
     glClear(GL_COLOR_BUFFER_BIT);
 
     glBindTexture(GL_TEXTURE_2D, mImpl->textureId);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_BGRA,
-                 mImpl->g_width, mImpl->g_height,
-                 0, GL_BGRA, GL_UNSIGNED_BYTE,
-                 mImpl->g_rgbaData.data());
+    if (mImpl->g_textureDirty) {
+        if (mImpl->g_isAR30) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB10_A2,
+                         mImpl->g_width, mImpl->g_height,
+                         0, GL_BGRA, GL_UNSIGNED_INT_2_10_10_10_REV,
+                         mImpl->g_rgbaData.data());
+        } else {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_BGRA,
+                         mImpl->g_width, mImpl->g_height,
+                         0, GL_BGRA, GL_UNSIGNED_BYTE,
+                         mImpl->g_rgbaData.data());
+        }
+        mImpl->g_textureDirty = false;
+    }
+    if (mImpl->g_isAR30) {
+        mImpl->hdrProgram->bind();
+        mImpl->hdrProgram->setUniformValue("tex", 0);
+        mImpl->hdrProgram->setUniformValue(
+            "transfer",
+            mImpl->g_hdrInfo.transfer == ToneMapper::Transfer::Pq ? 1 : 2);
+        mImpl->hdrProgram->setUniformValue(
+            "peakNits", std::max(mImpl->g_hdrInfo.peakNits,
+                                 ToneMapper::kSdrWhiteNits));
+    }
 
     // 设置纹理参数（仅需一次，建议放 initializeGL 中）
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    // 直接绘制纹理四边形
+    // 直接绘制纹理四边形，旋转时纹理坐标按顺时针轮换
+    static constexpr float kTexCoords[4][2] = {
+        {0.0f, 1.0f}, {1.0f, 1.0f}, {1.0f, 0.0f}, {0.0f, 0.0f}
+    };
+    static constexpr float kVertices[4][2] = {
+        {-1.0f, -1.0f}, // 左下
+        {1.0f, -1.0f},  // 右下
+        {1.0f, 1.0f},   // 右上
+        {-1.0f, 1.0f},  // 左上
+    };
+    const int shift = mImpl->rotation / 90;
     glEnable(GL_TEXTURE_2D);
     glBegin(GL_QUADS);
-    glTexCoord2f(0.0f, 1.0f); glVertex2f(-1.0f, -1.0f); // 左下
-    glTexCoord2f(1.0f, 1.0f); glVertex2f(1.0f, -1.0f);  // 右下
-    glTexCoord2f(1.0f, 0.0f); glVertex2f(1.0f, 1.0f);   // 右上
-    glTexCoord2f(0.0f, 0.0f); glVertex2f(-1.0f, 1.0f);  // 左上
+    for (int i = 0; i < 4; ++i) {
+        const float *tex = kTexCoords[(i + shift) % 4];
+        glTexCoord2f(tex[0], tex[1]);
+        glVertex2f(kVertices[i][0], kVertices[i][1]);
+    }
     glEnd();
 
+    if (mImpl->g_isAR30) {
+        mImpl->hdrProgram->release();
+    }
     glBindTexture(GL_TEXTURE_2D, 0);
 }
 
 void OpenglPlayWidget::onFrameChanged(VideoFrame frame) {
-    const uint8_t *src_y = frame->data[0];
-    const uint8_t *src_u = frame->data[1];
-    const uint8_t *src_v = frame->data[2];
-
-    int src_stride_y = frame->linesize[0];
-    int src_stride_u = frame->linesize[1];
-    int src_stride_v = frame->linesize[2];
-    // spdlog::warn("onFrameChanged: VideoFrame2");
-    mImpl->g_width = frame->width;
-    mImpl->g_height = frame->height;
-
-    mImpl->g_rgbaData = std::vector<uint8_t>(
-        mImpl->g_width * mImpl->g_height * 4);
-    mImpl->g_stride = mImpl->g_width * 4;
-
-    // 调用转换
-    libyuv::I420ToARGB(
-        src_y, src_stride_y,
-        src_u, src_stride_u,
-        src_v, src_stride_v,
-        mImpl->g_rgbaData.data(), mImpl->g_stride,
-        mImpl->g_width, mImpl->g_height
-        );
-    this->update();
+    {
+        std::lock_guard lock(mImpl->mtx);
+        av_frame_free(&mImpl->g_lastFrame);
+        mImpl->g_lastFrame = av_frame_clone(frame);
+        if (!mImpl->visible || !mImpl->changeDetector.changed(frame)) {
+            return;
+        }
+        mImpl->renderLocked();
+    }
+    // 解码线程不直接 update()，由刷新节拍合并
+    mImpl->repaint->markDirty();
+}
+
+void OpenglPlayWidget::onFrameScheduled(VideoFrame frame, qint64 dueUs) {
+    AVFrame *ref = mImpl->visible ? av_frame_clone(frame) : nullptr;
+    if (!ref) {
+        return;
+    }
+    mImpl->pacer.push(ref,
+                      FramePacer::Clock::time_point(
+                          std::chrono::microseconds(dueUs)));
+    // 节拍中断时由一次普通重绘重新拉起 frameSwapped
+    mImpl->repaint->markDirty();
+}
+
+void OpenglPlayWidget::setRotation(int rotation) {
+    {
+        std::lock_guard lock(mImpl->mtx);
+        mImpl->rotation = rotation;
+        mImpl->zoom.reset();
+        mImpl->renderLocked();
+    }
+    update();
+}
+
+QMetaObject::Connection OpenglPlayWidget::connectVisibility(
+    QObject *receiver, std::function<void(bool)> callback) {
+    return connect(this, &OpenglPlayWidget::visibilityChanged, receiver,
+                   std::move(callback));
+}
+
+QMetaObject::Connection OpenglPlayWidget::connectVsyncPacing(
+    QObject *receiver, std::function<void(bool)> callback) {
+    return connect(this, &OpenglPlayWidget::vsyncPacingChanged, receiver,
+                   std::move(callback));
+}
+
+void OpenglPlayWidget::showEvent(QShowEvent *event) {
+    {
+        std::lock_guard lock(mImpl->mtx);
+        mImpl->visible = true;
+        // 隐藏期间的帧没有经过检测
+        mImpl->changeDetector.reset();
+        mImpl->renderLocked();
+    }
+    mImpl->repaint->start();
+    QOpenGLWidget::showEvent(event);
+    emit visibilityChanged(true);
+}
+
+void OpenglPlayWidget::hideEvent(QHideEvent *event) {
+    mImpl->visible = false;
+    mImpl->repaint->stop();
+    mImpl->pacer.reset();
+    QOpenGLWidget::hideEvent(event);
+    emit visibilityChanged(false);
+}
+
+void OpenglPlayWidget::wheelEvent(QWheelEvent *event) {
+    {
+        std::lock_guard lock(mImpl->mtx);
+        const double factor = event->angleDelta().y() > 0
+                                  ? ViewZoom::kWheelStep
+                                  : 1.0 / ViewZoom::kWheelStep;
+        const QPointF anchor{
+            event->position().x() / std::max(1, width()),
+            event->position().y() / std::max(1, height())
+        };
+        mImpl->zoom.zoomAt(ViewZoom::toSource(anchor, mImpl->rotation),
+                           factor);
+        mImpl->renderLocked();
+    }
+    event->accept();
+    update();
+}
+
+void OpenglPlayWidget::mousePressEvent(QMouseEvent *event) {
+    mImpl->dragPos = event->pos();
+    QOpenGLWidget::mousePressEvent(event);
+}
+
+void OpenglPlayWidget::mouseMoveEvent(QMouseEvent *event) {
+    if (!(event->buttons() & Qt::LeftButton)) {
+        return;
+    }
+    {
+        std::lock_guard lock(mImpl->mtx);
+        if (!mImpl->zoom.active()) {
+            return;
+        }
+        const QPoint delta = event->pos() - mImpl->dragPos;
+        mImpl->dragPos = event->pos();
+        const QPointF normalized{
+            static_cast<double>(delta.x()) / std::max(1, width()),
+            static_cast<double>(delta.y()) / std::max(1, height())
+        };
+        mImpl->zoom.panBy(
+            ViewZoom::toSourceDelta(normalized, mImpl->rotation));
+        mImpl->renderLocked();
+    }
+    update();
+}
+
+void OpenglPlayWidget::mouseDoubleClickEvent(QMouseEvent *event) {
+    {
+        std::lock_guard lock(mImpl->mtx);
+        mImpl->zoom.reset();
+        mImpl->renderLocked();
+    }
+    update();
+    QOpenGLWidget::mouseDoubleClickEvent(event);
 }
@@ -1,16 +1,55 @@
 #pragma once
 
 #include "CommonDef.h"
+#include "VideoRenderer.h"
 #include <QOpenGLWidget>
 #include <QOpenGLFunctions>
+#include <string>
 
-class OpenglPlayWidget : public QOpenGLWidget , protected QOpenGLFunctions{
+class OpenglPlayWidget : public QOpenGLWidget , protected QOpenGLFunctions,
+                         public VideoRenderer {
     Q_OBJECT
 
 public:
     explicit OpenglPlayWidget(QWidget *parent = nullptr);
+    ~OpenglPlayWidget() override;
 
     QSize sizeHint() const override;
+
+    // 垂直同步节拍模式：帧由 frameSwapped 驱动，每次 vsync 选出与时钟最匹配的帧
+    void setVsyncPacing(bool enable);
+
+    bool vsyncPacing() const override;
+
+    // 呈现时长直方图（以 vsync 计），用于衡量抖动
+    std::string pacingReport() const;
+
+    QWidget *widget() override {
+        return this;
+    }
+
+    // VideoSink
+    void onVideoFrame(const FrameRef &frame) override {
+        onFrameChanged(frame.get());
+    }
+
+    void onVideoFrameScheduled(const FrameRef &frame, qint64 dueUs) override {
+        onFrameScheduled(frame.get(), dueUs);
+    }
+
+    void onVideoRotation(int rotation) override {
+        setRotation(rotation);
+    }
+
+    Kind kind() const override {
+        return Kind::OpenGL;
+    }
+
+    QMetaObject::Connection connectVisibility(
+        QObject *receiver, std::function<void(bool)> callback) override;
+
+    QMetaObject::Connection connectVsyncPacing(
+        QObject *receiver, std::function<void(bool)> callback) override;
 protected:
     void initializeGL() override;
 
@@ -18,8 +57,30 @@ protected:
 
     void paintGL() override;
 
+    // 滚轮变焦，左键拖动平移，双击复位
+    void wheelEvent(QWheelEvent *event) override;
+
+    void mousePressEvent(QMouseEvent *event) override;
+
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+    void showEvent(QShowEvent *event) override;
+
+    void hideEvent(QHideEvent *event) override;
+
+Q_SIGNALS:
+    // 显示/隐藏（包括窗口最小化）时发出
+    void visibilityChanged(bool visible);
+    void vsyncPacingChanged(bool enable);
+
 public Q_SLOTS:
-    void onFrameChanged(VideoFrame);
+    void onFrameChanged(VideoFrame frame);
+    // 节拍模式下提前送达的帧，dueUs 为预定呈现时间（system_clock 微秒）
+    void onFrameScheduled(VideoFrame frame, qint64 dueUs);
+    // 顺时针 0/90/180/270，通过纹理坐标实现，不额外处理像素
+    void setRotation(int rotation);
 
 private:
     struct Impl;
@@ -1,8 +1,13 @@
 #include "PlayerController.h"
 #include <spdlog/spdlog.h>
+#include "CommandQueue.h"
 #include "FFmpegWrapper.h"
-#include "PlayerWidget.h"
-#include <boost/lockfree/spsc_queue.hpp>
+#include "FramePacer.h"
+#include "PlayerPipeline.h"
+#include "ScreenshotWriter.h"
+#include "StageCoroutine.h"
+#include "VideoFilterStage.h"
+#include <algorithm>
 #include <future>
 Q_DECLARE_METATYPE(VideoFrame);
 
@@ -10,443 +15,1015 @@ Q_DECLARE_METATYPE(VideoFrame);
 using namespace std::literals;
 
 namespace {
-AVFormatContext *g_format_context;
-AVCodecContext *videoCodecContext;
-AVCodecContext *audioCodecContext;
-int g_videoStream;
-int g_audioStream;
-std::chrono::time_point<std::chrono::system_clock> g_start_time;
-std::chrono::milliseconds g_total_video_time;
-
-std::mutex g_mtx_pause;
-std::condition_variable g_cv_pause;
-std::atomic<std::chrono::milliseconds> g_pause_time;
-
-std::atomic_bool g_is_paused = false;
-std::atomic_bool g_is_seeking = false;
-std::atomic_bool g_is_speeding = false;
-std::atomic_int g_seek_pos_ms = 0;
-int64_t g_audio_pts_begin;
-int64_t g_video_pts_begin;
-
-boost::lockfree::spsc_queue<AVPacket *, boost::lockfree::capacity<128>>
-g_buffer_video;
-boost::lockfree::spsc_queue<AVPacket *, boost::lockfree::capacity<1024>>
-g_buffer_audio;
-FFmpeg::SwrResample *g_swr{};
-AVRational g_audio_pts_base;
-std::atomic<std::chrono::time_point<std::chrono::system_clock>>
-g_last_pause_point;
-
-
-void doSeek(int64_t seek_pos_ms) {
-    AVStream *audio_stream = g_format_context->streams[g_audioStream];
-    double time_base = av_q2d(audio_stream->time_base) * 1000;
+constexpr uint64_t kFilterLogInterval = 300;
+// seek 进行中、读包出错时多久后再试
+constexpr auto kRetry = 1ms;
+constexpr auto kPausePoll = 10ms;
+// 等待呈现时间时最长挂起多久，以便及时响应暂停、seek 和变速
+constexpr auto kMaxWait = 20ms;
+// 阶段之间的通道容量
+constexpr size_t kVideoPackets = 128;
+constexpr size_t kAudioPackets = 1024;
+constexpr size_t kDecodedFrames = 8;
+
+void freeFrames(std::vector<AVFrame *> &frames) {
+    for (AVFrame *frame: frames) {
+        av_frame_free(&frame);
+    }
+    frames.clear();
+}
+
+struct PacketFree {
+    void operator()(AVPacket *packet) const {
+        av_packet_free(&packet);
+    }
+};
+
+// 通道中的包，epoch 为读取时的 seek 代数
+struct Packet {
+    std::unique_ptr<AVPacket, PacketFree> packet;
+    int epoch;
+};
+}
+
+// 一个播放会话的全部状态。每个 PlayerController 各有一份，
+// 同一进程内可以同时运行多个互不影响的播放器
+struct PlayerController::Impl {
+    explicit Impl(PlayerController *owner): mController(owner) {}
+
+    PlayerController *mController;
+    AVFormatContext *mFormatContext{};
+    AVCodecContext *mVideoCodecContext{};
+    AVCodecContext *mAudioCodecContext{};
+    int mVideoStream = -1;
+    int mAudioStream = -1;
+    // 起点和暂停累计
+    PlaybackClock mClock;
+    std::chrono::milliseconds mTotalVideoTime{};
+
+    std::atomic_bool mIsPaused = false;
+    std::atomic_bool mIsSeeking = false;
+    // SeekTo 已入队、还没被 applyCommands 取走的 seek 数
+    std::atomic_int mPendingSeeks = 0;
+    std::atomic_bool mIsSpeeding = false;
+    // 渲染控件不可见时不再提交视频帧；mSkipHiddenVideo 时按呈现时间取包、
+    // 只解码关键帧，重新可见后丢弃非关键帧直到下一个关键帧
+    std::atomic_bool mVideoVisible = true;
+    // 没有设置音频输出端时用的声卡
+    FFmpeg::AudioPlayer mSoundCard;
+    // 每帧呈现路径：视频接收端、呈现时钟（自己的或跟随的）和音频输出，
+    // 呈现和音频阶段的输出都经过它。类型在构建时选（PlayerPipeline.h）
+    PlayerPipeline mPipeline = makePlayerPipeline(mClock, &mSoundCard);
+    // 连接到 VideoFrameReady 信号的接收者数量，为 0 时不发信号
+    std::atomic_int mFrameSignalReceivers = 0;
+    std::atomic_bool mSkipHiddenVideo = true;
+    std::atomic_bool mVideoWaitKeyframe = false;
+    // 垂直同步节拍：视频帧提前交付，由渲染控件决定在哪次 vsync 呈现
+    std::atomic_bool mVsyncPacing = false;
+    // 最近一次交给渲染控件的帧（引用），截图从这里取原始分辨率图像
+    std::mutex mMtxPresented;
+    FrameRef mPresentedFrame;
+    std::atomic_int mVideoRotation = 0;
+    // 连拍：接下来 mBurstRemaining 帧依次交给截图线程
+    std::atomic_int mBurstRemaining = 0;
+    int mBurstIndex = 0;
+    QString mBurstBase;
+    QString mBurstSuffix;
+    std::unique_ptr<ScreenshotWriter> mScreenshotWriter;
+    // 去隔行滤镜图，只在视频线程中使用
+    std::atomic<DeinterlaceMode> mDeinterlaceMode = DeinterlaceMode::Auto;
+    std::atomic_bool mDeinterlaceBwdif = true;
+    FFmpeg::FilterGraph mDeinterlacer;
+    // 通用滤镜阶段（独立线程），滤镜描述为空且没有在途帧时旁路
+    mutable std::mutex mMtxFilters;
+    std::string mVideoFilters;
+    std::unique_ptr<VideoFilterStage> mFilterStage;
+    std::atomic_int mSeekPosMs = 0;
+    // 跟随的时钟（对比播放），为空时用自己的
+    const Impl *mClockMaster{};
+    // 精确 seek：呈现/输出前丢弃时间戳早于目标位置的帧，-1 表示不丢
+    std::atomic_bool mAccurateSeek = false;
+    std::atomic<int64_t> mVideoSeekFloorMs = -1;
+    std::atomic<int64_t> mAudioSeekFloorMs = -1;
+    // 显示尺寸提示，解码器支持 lowres 时按此降采样解码（视频墙的小格子）。
+    // 播放中改变时，解码阶段在下一个关键帧处按新尺寸重新打开解码器
+    std::atomic_int mDecodeWidth = 0;
+    std::atomic_int mDecodeHeight = 0;
+    std::atomic_bool mDecodeSizeChanged = false;
+    int64_t mAudioPtsBegin = 0;
+    int64_t mVideoPtsBegin = 0;
+
+    // 读包 → 解码 → 呈现、读包 → 音频，阶段之间是有界通道：
+    // 满了发送方挂起，空了接收方挂起，由对端唤醒
+    StageChannel<Packet> mVideoPackets{kVideoPackets};
+    StageChannel<Packet> mAudioPackets{kAudioPackets};
+    // 解码后待呈现的视频帧，epoch 为解码时的 seek 代数
+    struct DecodedFrame {
+        FrameRef frame;
+        int epoch;
+    };
+
+    StageChannel<DecodedFrame> mDecodedVideo{kDecodedFrames};
+    // 流水线的四个阶段是协程，在所有播放器共用的 StagePool 上调度
+    StageCoroutine::Handle mReadTask;
+    StageCoroutine::Handle mDecodeTask;
+    StageCoroutine::Handle mFilterTask;
+    StageCoroutine::Handle mPresentTask;
+    StageCoroutine::Handle mAudioTask;
+    // 每次 seek 加一。包和帧带着产生时的代数，旧代数的在下游丢弃；
+    // 解码/音频阶段遇到新代数时清空解码器
+    std::atomic_int mSeekEpoch = 0;
+    int mReadEpoch = 0;
+    int mDecodeEpoch = 0;
+    int mAudioEpoch = 0;
+    bool mReadEof = false;
+    // 播放控制命令：界面线程只入队，流水线各阶段在检查点取出应用。
+    // mMtxConsumer 保证同一时刻只有一个阶段在取命令或执行 seek，
+    // 拿不到锁的阶段直接跳过，不等待
+    CommandQueue mCommands;
+    std::mutex mMtxConsumer;
+    mutable std::mutex mMtxCommandTimings;
+    CommandTimings mCommandTimings;
+    // 等待第一帧的 seek 代数（-1 为没有）和它的发出时间，
+    // 由 mMtxCommandTimings 保护
+    std::atomic_int mEffectEpoch = -1;
+    std::chrono::steady_clock::time_point mEffectIssued;
+    // 各阶段手上还没送出的帧，只由所属阶段访问，停止后由 clearPipeline 释放
+    std::vector<AVFrame *> mPendingVideo; // 从尾部取
+    std::vector<AVFrame *> mPendingAudio; // 从尾部取
+    FFmpeg::SwrResample *mSwr{};
+    // 不按时间戳等待，解码多快就交付多快（基准测试）
+    std::atomic_bool mUnthrottled = false;
+    std::atomic<std::chrono::time_point<std::chrono::system_clock>>
+    mLastPausePoint;
+    // calDuration/calAudioFrameDurationMs 的缓存，按格式上下文和流编号失效
+    const AVFormatContext *mDurationFormatContext{};
+    int mDurationVideoStream = -1;
+    double mFrameIntervalMs = 0.0;
+    const AVFormatContext *mAudioDurationFormatContext{};
+    int mDurationAudioStream = -1;
+    double mAudioFrameDurationMs = 0.0;
+
+    bool videoActive() const;
+    // 跟随 master 时等 master 的 seek 完成再呈现
+    const Impl &clock() const {
+        return mClockMaster ? *mClockMaster : *this;
+    }
+    // SeekTo 返回后即为 true，直到 seek 执行完
+    bool seekPending() const {
+        return mIsSeeking || mPendingSeeks > 0;
+    }
+    void dispatchVideoFrame(const FrameRef &frame, int64_t mediaMs,
+                            bool scheduled);
+    void doSeek(int64_t seek_pos_ms);
+    uint64_t calDuration();
+    uint64_t calAudioFrameDurationMs();
+    void deinterlace(std::vector<AVFrame *> &frames);
+    void applyDecodeSize();
+    void applyCommands();
+    void pollCommands();
+    void noteSeekEffect(int epoch);
+    void seekInput();
+    // 流水线阶段
+    StageCoroutine readLoop(std::stop_token token);
+    StageCoroutine decodeLoop(std::stop_token token);
+    StageCoroutine filterLoop(std::stop_token token);
+    StageCoroutine presentLoop(std::stop_token token);
+    StageCoroutine audioLoop(std::stop_token token);
+    // 释放各阶段暂存和通道中的数据，阶段停止后调用
+    void clearPipeline();
+};
+
+// 是否还有接收端需要视频帧
+bool PlayerController::Impl::videoActive() const {
+    return mVideoVisible || mPipeline.videoAlwaysActive();
+}
+
+void PlayerController::Impl::dispatchVideoFrame(const FrameRef &frame,
+                                                int64_t mediaMs,
+                                                bool scheduled) {
+    mPipeline.present(frame, mediaMs, scheduled);
+    // 兼容按信号接收帧的 QObject
+    if (mFrameSignalReceivers > 0) {
+        emit mController->VideoFrameReady(frame.get());
+    }
+}
+
+void PlayerController::Impl::doSeek(int64_t seek_pos_ms) {
+    // 没有音频流时按视频流定位
+    const int index = mAudioStream >= 0 ? mAudioStream : mVideoStream;
+    AVStream *seek_stream = mFormatContext->streams[index];
+    double time_base = av_q2d(seek_stream->time_base) * 1000;
     int64_t target_pts = seek_pos_ms / time_base;
     int seek_flags = AVSEEK_FLAG_FRAME;
-    if (av_seek_frame(g_format_context, g_audioStream, target_pts, seek_flags) <
-        0) {
+    if (av_seek_frame(mFormatContext, index, target_pts, seek_flags) < 0) {
         spdlog::error(PREFIX ".doSeek seek failed");
     }
 }
 
-void startReadPacket(std::stop_token token, PlayerController *controller) {
-    AVPacket *packet{};
-    while (!token.stop_requested()) {
-        if (auto err = FFmpeg::readPaket(g_format_context, packet)) {
-            if (err.errorCode == AVERROR_EOF) {
-                spdlog::warn("EOF detected, restarting...");
-
-                return;
-            }
-
-            spdlog::error("readPaket error");
-            std::this_thread::sleep_for(std::chrono::microseconds(1));
-            continue;
+// 需持有 mMtxConsumer。一批命令中只执行最后一个 seek，之前的计为合并，
+// 不会先后执行两次
+void PlayerController::Impl::applyCommands() {
+    PlayerCommand command;
+    if (!mCommands.pop(command)) {
+        return;
+    }
+    std::vector<PlayerCommand> batch{command};
+    while (mCommands.pop(command)) {
+        batch.push_back(command);
+    }
+    size_t lastSeek = batch.size();
+    for (size_t i = 0; i < batch.size(); ++i) {
+        if (batch[i].type == PlayerCommand::Type::Seek) {
+            lastSeek = i;
         }
-        if (token.stop_requested()) {
-            spdlog::info("stop decode thread");
+    }
+    using namespace std::chrono;
+    uint64_t coalesced = 0;
+    for (size_t i = 0; i < batch.size(); ++i) {
+        const PlayerCommand &cmd = batch[i];
+        switch (cmd.type) {
+        case PlayerCommand::Type::Pause:
+            if (!mIsPaused) {
+                mLastPausePoint = system_clock::now();
+                mIsPaused = true;
+            }
             break;
-        }
-        if (packet->stream_index !=
-            g_audioStream && packet->stream_index != g_videoStream) {
-            spdlog::info("skip packet");
-            continue;
-        }
-        bool isVideo = packet->stream_index == g_videoStream;
-        bool isAudio = packet->stream_index == g_audioStream;
-        // spdlog::info("push packet");
-
-        while (true) {
-            if (token.stop_requested()) {
-                spdlog::info("stop decode thread");
+        case PlayerCommand::Type::Resume:
+            if (mIsPaused) {
+                auto delta = duration_cast<milliseconds>(
+                    system_clock::now() - mLastPausePoint.load());
+                milliseconds current = mClock.pauseTime.load();
+                while (!mClock.pauseTime.compare_exchange_weak(
+                    current, current + delta)) {}
+                mIsPaused = false;
+            }
+            break;
+        case PlayerCommand::Type::Speed:
+            mIsSpeeding = cmd.value != 0;
+            break;
+        case PlayerCommand::Type::Seek:
+            if (i != lastSeek) {
+                --mPendingSeeks;
+                ++coalesced;
                 break;
             }
-            // spdlog::info("g_is_seeking:{}", g_is_seeking.load());
-            if (g_is_seeking.load()) {
-                spdlog::info("trigger seeking");
-                g_buffer_video.consume_all([](auto) {});
-                g_buffer_audio.consume_all([](auto) {});
+            mLastPausePoint = system_clock::now();
+            mIsPaused = false;
+            mSeekPosMs = static_cast<int>(cmd.value);
+            if (mAccurateSeek) {
+                mVideoSeekFloorMs = cmd.value;
+                mAudioSeekFloorMs = cmd.value;
+            }
+            // 之后读到的包和解出的帧带新代数，旧的在各阶段丢弃
+            ++mSeekEpoch;
+            {
+                std::lock_guard lock(mMtxCommandTimings);
+                mEffectEpoch = mSeekEpoch.load();
+                mEffectIssued = cmd.issued;
+            }
+            mIsSeeking = true;
+            // 先置 mIsSeeking 再减，跟随者看到的 seekPending() 不会中断
+            --mPendingSeeks;
+            break;
+        }
+    }
+    const auto now = steady_clock::now();
+    std::lock_guard lock(mMtxCommandTimings);
+    for (const PlayerCommand &cmd: batch) {
+        const double ms = duration<double, std::milli>(now - cmd.issued).
+            count();
+        mCommandTimings.totalApplyMs += ms;
+        mCommandTimings.maxApplyMs = std::max(mCommandTimings.maxApplyMs,
+                                                ms);
+        mCommandTimings.lastSequence = std::max(
+            mCommandTimings.lastSequence, cmd.sequence);
+    }
+    mCommandTimings.commands += batch.size();
+    mCommandTimings.coalesced += coalesced;
+}
 
-                using namespace std::chrono;
+// 取出并应用排队的命令，其他阶段正在取或正在 seek 时跳过
+void PlayerController::Impl::pollCommands() {
+    std::unique_lock consumer(mMtxConsumer, std::try_to_lock);
+    if (consumer) {
+        applyCommands();
+    }
+}
+
+// epoch 的第一帧已送出，记录对应 seek 从发出到生效的耗时
+void PlayerController::Impl::noteSeekEffect(int epoch) {
+    if (mEffectEpoch != epoch) {
+        return;
+    }
+    std::lock_guard lock(mMtxCommandTimings);
+    if (mEffectEpoch != epoch) {
+        return;
+    }
+    mEffectEpoch = -1;
+    const double ms = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - mEffectIssued).count();
+    ++mCommandTimings.seeks;
+    mCommandTimings.totalSeekMs += ms;
+    mCommandTimings.maxSeekMs = std::max(mCommandTimings.maxSeekMs, ms);
+}
+
+// 需持有 mMtxConsumer。丢弃通道中的旧包，跳到目标位置并调整时钟
+void PlayerController::Impl::seekInput() {
+    spdlog::info("trigger seeking");
+    mReadEpoch = mSeekEpoch;
+    mVideoPackets.clear();
+    mAudioPackets.clear();
+
+    using namespace std::chrono;
+    if (mClockMaster) {
+        // 时钟由 master 在它自己的 seek 中调整
+        doSeek(mSeekPosMs);
+        mIsPaused = false;
+        mIsSeeking = false;
+        mReadEof = false;
+        spdlog::warn("seeking success");
+        return;
+    }
 #if 1
-                int64_t current_ms = duration_cast<milliseconds>(
-                    (system_clock::now() - g_pause_time.load() - g_start_time)
+    int64_t current_ms = duration_cast<milliseconds>(
+        (system_clock::now() - mClock.origin())
 
-                    ).count();
+        ).count();
 
-                doSeek(g_seek_pos_ms);
+    doSeek(mSeekPosMs);
 
-                auto now = system_clock::now();
+    auto now = system_clock::now();
 
-                spdlog::info("seekoffset :{}", g_seek_pos_ms - current_ms);
-                {
-                    milliseconds expected = g_pause_time.load();
-                    milliseconds desired;
-                    do {
-                        desired = expected + milliseconds(
-                                      current_ms - g_seek_pos_ms.load());
-                    } while (!g_pause_time.compare_exchange_weak(
-                        expected, desired));
-                }
-                auto delta = std::chrono::duration_cast<milliseconds>(
-                    now - g_last_pause_point.load());
-                milliseconds current = g_pause_time.load();
-                while (!g_pause_time.
-                    compare_exchange_weak(current, current + delta)) {}
+    spdlog::info("seekoffset :{}", mSeekPosMs - current_ms);
+    {
+        milliseconds expected = mClock.pauseTime.load();
+        milliseconds desired;
+        do {
+            desired = expected + milliseconds(
+                          current_ms - mSeekPosMs.load());
+        } while (!mClock.pauseTime.compare_exchange_weak(
+            expected, desired));
+    }
+    auto delta = std::chrono::duration_cast<milliseconds>(
+        now - mLastPausePoint.load());
+    milliseconds current = mClock.pauseTime.load();
+    while (!mClock.pauseTime.
+        compare_exchange_weak(current, current + delta)) {}
 #else
-                int64_t current_ms = duration_cast<milliseconds>(
-                    (system_clock::now() - g_pause_time.load() - g_start_time)
-                    ).count();
-
-                doSeek(g_seek_pos_ms);
-
-                auto now = system_clock::now();
-                auto delta = std::chrono::duration_cast<
-                    std::chrono::milliseconds>(
-                    now - g_last_pause_point.load());
-                spdlog::info("seekoffset :{}", g_seek_pos_ms - current_ms);
-                g_pause_time = -std::chrono::milliseconds(
-                                   g_seek_pos_ms - current_ms) + g_pause_time.
-                               load();
-                std::chrono::milliseconds current = g_pause_time.load();
-                while (!g_pause_time.
-                   compare_exchange_weak(current, current + delta)) {}
+    int64_t current_ms = duration_cast<milliseconds>(
+        (system_clock::now() - mClock.origin())
+        ).count();
+
+    doSeek(mSeekPosMs);
+
+    auto now = system_clock::now();
+    auto delta = std::chrono::duration_cast<
+        std::chrono::milliseconds>(
+        now - mLastPausePoint.load());
+    spdlog::info("seekoffset :{}", mSeekPosMs - current_ms);
+    mClock.pauseTime = -std::chrono::milliseconds(
+                       mSeekPosMs - current_ms) + mClock.pauseTime.
+                   load();
+    std::chrono::milliseconds current = mClock.pauseTime.load();
+    while (!mClock.pauseTime.
+       compare_exchange_weak(current, current + delta)) {}
 #endif
-                g_is_paused = false;
-                g_is_seeking = false;
-                g_cv_pause.notify_all();
-                spdlog::warn("seeking success");
-                break;
-            }
-            if (isVideo && !g_buffer_video.push(packet)) {
-                std::this_thread::sleep_for(std::chrono::microseconds(3));
+    mIsPaused = false;
+    mIsSeeking = false;
+    mReadEof = false;
+    spdlog::warn("seeking success");
+}
+
+StageCoroutine PlayerController::Impl::readLoop(std::stop_token token) {
+    while (!token.stop_requested()) {
+        // 读包阶段每个包前取一次命令。seek 在持有消费者锁时执行，
+        // 期间到达的命令留在队列里，等这次 seek 完成后再应用
+        if (std::unique_lock consumer{mMtxConsumer, std::try_to_lock}) {
+            applyCommands();
+            if (mIsSeeking) {
+                seekInput();
                 continue;
-            } else if (isAudio && !g_buffer_audio.push(packet)) {
-                std::this_thread::sleep_for(std::chrono::microseconds(3));
-                spdlog::info("audio buffer full");
+            }
+        }
+        AVPacket *raw{};
+        if (auto err = FFmpeg::readPaket(mFormatContext, raw)) {
+            av_packet_free(&raw);
+            if (err.errorCode == AVERROR_EOF) {
+                // 读到结尾后继续保持任务，之后的 seek 仍然有效
+                if (!mReadEof) {
+                    spdlog::warn("EOF detected");
+                    mReadEof = true;
+                    // 空包通知解码阶段排空解码器和滤镜
+                    Packet end{nullptr, mReadEpoch};
+                    if (mVideoStream >= 0 &&
+                        !co_await mVideoPackets.send(std::move(end))) {
+                        co_return;
+                    }
+                }
+                if (!co_await StageCoroutine::sleepFor(kPausePoll)) {
+                    co_return;
+                }
                 continue;
             }
-            break;
+            spdlog::error("readPaket error");
+            if (!co_await StageCoroutine::sleepFor(kRetry)) {
+                co_return;
+            }
+            continue;
+        }
+        const int stream = raw->stream_index;
+        Packet packet{std::unique_ptr<AVPacket, PacketFree>{raw}, mReadEpoch};
+        if (stream == mVideoStream) {
+            if (!co_await mVideoPackets.send(std::move(packet))) {
+                co_return;
+            }
+        } else if (stream == mAudioStream) {
+            if (!co_await mAudioPackets.send(std::move(packet))) {
+                co_return;
+            }
+        }
+        // 每个包让出一次线程，和其他阶段、其他会话轮流
+        if (!co_await StageCoroutine::yield()) {
+            co_return;
         }
     }
 }
 
-uint64_t calDuration() {
-    static const AVFormatContext *lastFormatContext = nullptr;
-    static int lastVideoStream = -1;
-    static double cachedFrameIntervalMs = 0.0;
-
-    if (g_format_context == nullptr || g_videoStream < 0) {
+uint64_t PlayerController::Impl::calDuration() {
+    if (mFormatContext == nullptr || mVideoStream < 0) {
         return 0;
     }
 
     // 如果格式或视频流编号变化，重新计算
-    if (g_format_context != lastFormatContext || g_videoStream !=
-        lastVideoStream) {
-        AVStream *stream = g_format_context->streams[g_videoStream];
+    if (mFormatContext != mDurationFormatContext || mVideoStream !=
+        mDurationVideoStream) {
+        AVStream *stream = mFormatContext->streams[mVideoStream];
         AVRational avgRate = stream->avg_frame_rate;
 
         if (avgRate.num != 0 && avgRate.den != 0) {
-            cachedFrameIntervalMs = av_q2d(av_inv_q(avgRate)) * 1000.0;
+            mFrameIntervalMs = av_q2d(av_inv_q(avgRate)) * 1000.0;
         } else {
-            cachedFrameIntervalMs = 0; // 无效帧率
+            mFrameIntervalMs = 0; // 无效帧率
         }
 
         // 更新缓存状态
-        lastFormatContext = g_format_context;
-        lastVideoStream = g_videoStream;
+        mDurationFormatContext = mFormatContext;
+        mDurationVideoStream = mVideoStream;
     }
 
-    return cachedFrameIntervalMs;
+    return mFrameIntervalMs;
 }
 
-uint64_t calAudioFrameDurationMs() {
-    static const AVFormatContext *lastFormatContext = nullptr;
-    static int lastAudioStream = -1;
-    static double cachedAudioFrameDurationMs = 0.0;
-
-    if (!g_format_context || g_audioStream < 0)
+uint64_t PlayerController::Impl::calAudioFrameDurationMs() {
+    if (!mFormatContext || mAudioStream < 0)
         return 0;
 
     // 若音频流或上下文变化，重新计算
-    if (g_format_context != lastFormatContext || g_audioStream !=
-        lastAudioStream) {
-        AVStream *stream = g_format_context->streams[g_audioStream];
+    if (mFormatContext != mAudioDurationFormatContext ||
+        mAudioStream != mDurationAudioStream) {
+        AVStream *stream = mFormatContext->streams[mAudioStream];
         AVCodecParameters *codecpar = stream->codecpar;
 
         if (!codecpar || codecpar->sample_rate == 0) {
-            cachedAudioFrameDurationMs = 0;
+            mAudioFrameDurationMs = 0;
         } else {
             AVRational tb = stream->time_base;
 
             // 默认每帧 duration
             int64_t frame_duration = stream->codecpar->frame_size;
             if (frame_duration > 0) {
-                cachedAudioFrameDurationMs =
+                mAudioFrameDurationMs =
                     (double)frame_duration * 1000.0 / codecpar->sample_rate;
             } else {
                 // 回退用 time_base
                 if (stream->duration > 0 && stream->nb_frames > 0) {
                     double avg_duration =
                         (double)stream->duration / stream->nb_frames;
-                    cachedAudioFrameDurationMs =
+                    mAudioFrameDurationMs =
                         av_q2d(tb) * avg_duration * 1000.0;
                 } else {
-                    cachedAudioFrameDurationMs = 0;
+                    mAudioFrameDurationMs = 0;
                 }
             }
         }
 
-        lastFormatContext = g_format_context;
-        lastAudioStream = g_audioStream;
+        mAudioDurationFormatContext = mFormatContext;
+        mDurationAudioStream = mAudioStream;
     }
 
-    return (uint64_t)cachedAudioFrameDurationMs;
+    return (uint64_t)mAudioFrameDurationMs;
+}
+
+// 把解码帧替换为去隔行滤镜的输出。滤镜按需建立：Auto 模式下直到遇到
+// 第一帧隔行帧才启用，之后 deint=interlaced 让逐行帧原样通过
+void PlayerController::Impl::deinterlace(std::vector<AVFrame *> &frames) {
+    const DeinterlaceMode mode = mDeinterlaceMode;
+    if (mode == DeinterlaceMode::Off) {
+        mDeinterlacer.Close();
+        return;
+    }
+    const std::string description = fmt::format(
+        "{}=mode=send_frame:parity=auto:deint={}",
+        mDeinterlaceBwdif ? "bwdif" : "yadif",
+        mode == DeinterlaceMode::Always ? "all" : "interlaced");
+    std::vector<AVFrame *> filtered;
+    for (AVFrame *frame: frames) {
+        if (!mDeinterlacer.Matches(frame, description)) {
+            if (!mDeinterlacer.IsOpen() && mode == DeinterlaceMode::Auto &&
+                !frame->interlaced_frame) {
+                filtered.push_back(frame);
+                continue;
+            }
+            spdlog::info(PREFIX "deinterlace {} {}x{}", description,
+                         frame->width, frame->height);
+            const AVRational timeBase = mFormatContext->streams[
+                mVideoStream]->time_base;
+            if (mDeinterlacer.Init(frame, timeBase, description) < 0) {
+                spdlog::error(PREFIX "deinterlace unavailable, disabled");
+                mDeinterlaceMode = DeinterlaceMode::Off;
+                filtered.push_back(frame);
+                continue;
+            }
+        }
+        if (mDeinterlacer.Filter(frame, filtered).hasErr()) {
+            filtered.push_back(frame);
+            continue;
+        }
+        av_frame_free(&frame);
+        if (mDeinterlacer.Frames() % kFilterLogInterval == 0) {
+            spdlog::info(PREFIX "deinterlace last:{:.2f}ms avg:{:.2f}ms "
+                         "max:{:.2f}ms", mDeinterlacer.LastMs(),
+                         mDeinterlacer.AverageMs(), mDeinterlacer.MaxMs());
+        }
+    }
+    frames.swap(filtered);
+}
+
+// 按当前尺寸提示选 lowres，和解码器不一致时重新打开，需在关键帧处调用
+void PlayerController::Impl::applyDecodeSize() {
+    const int lowres = FFmpeg::chooseLowres(
+        mFormatContext->streams[mVideoStream], mDecodeWidth, mDecodeHeight);
+    if (lowres == mVideoCodecContext->lowres) {
+        return;
+    }
+    spdlog::info(PREFIX "decode at lowres {} for {}x{}", lowres,
+                 mDecodeWidth.load(), mDecodeHeight.load());
+    avcodec_free_context(&mVideoCodecContext);
+    FFmpeg::openCodec(mVideoCodecContext, mVideoStream, mFormatContext,
+                      lowres);
 }
 
-void startVideoDecode2(std::stop_token token, PlayerController *controller) {
+StageCoroutine PlayerController::Impl::decodeLoop(std::stop_token token) {
+    using namespace std::chrono;
     while (!token.stop_requested()) {
-        AVPacket *packet{};
-        if (g_is_seeking) {
-            spdlog::info(PREFIX "video decode is seeking");
-            avcodec_flush_buffers(videoCodecContext);
-            std::this_thread::sleep_for(std::chrono::microseconds(1));
+        std::optional<Packet> packet = co_await mVideoPackets.receive();
+        if (!packet) {
+            co_return;
+        }
+        pollCommands();
+        // seek 之前读到的包
+        if (packet->epoch != mSeekEpoch) {
             continue;
         }
-        if (!g_buffer_video.pop(packet)) {
-            spdlog::info(PREFIX "video buffer empty");
-            std::this_thread::sleep_for(std::chrono::microseconds(1));
+        if (packet->epoch != mDecodeEpoch) {
+            spdlog::info(PREFIX "video decode flush after seek");
+            avcodec_flush_buffers(mVideoCodecContext);
+            // 滤镜里缓存的参考帧属于 seek 之前
+            mDeinterlacer.Close();
+            if (mFilterStage) {
+                mFilterStage->flush();
+            }
+            mDecodeEpoch = packet->epoch;
+        }
+        AVPacket *raw = packet->packet.get();
+        // 空包：输入结束，依次排空解码器、去隔行和滤镜中缓存的帧
+        const bool end = !raw;
+        // 不可见且只解码关键帧时，包按呈现时间取走，读包阶段由视频通道
+        // 限住。否则读包只受音频通道限制，可见后的关键帧远在时钟之后
+        const int64_t ts = end ? AV_NOPTS_VALUE
+                               : raw->pts != AV_NOPTS_VALUE ? raw->pts
+                                                            : raw->dts;
+        while (ts != AV_NOPTS_VALUE && mSkipHiddenVideo && !mUnthrottled &&
+               !videoActive() && !token.stop_requested()) {
+            pollCommands();
+            if (packet->epoch != mSeekEpoch) {
+                break;
+            }
+            if (mIsSeeking || clock().seekPending() || mIsPaused) {
+                if (!co_await StageCoroutine::sleepFor(kPausePoll)) {
+                    co_return;
+                }
+                continue;
+            }
+            const int64_t mediaMs = static_cast<int64_t>(
+                                        av_q2d(mFormatContext->streams[
+                                                   mVideoStream]->time_base)
+                                        * ts * 1000) - mVideoPtsBegin;
+            const auto wait = mPipeline.wait(mediaMs);
+            if (wait <= 0ms) {
+                break;
+            }
+            if (!co_await StageCoroutine::sleepFor(
+                std::min<StagePool::Clock::duration>(
+                    duration_cast<StagePool::Clock::duration>(wait),
+                    kMaxWait))) {
+                co_return;
+            }
+        }
+        if (packet->epoch != mSeekEpoch) {
             continue;
         }
+        if (!end && (mVideoWaitKeyframe || (!videoActive() &&
+                                               mSkipHiddenVideo)) &&
+            !(raw->flags & AV_PKT_FLAG_KEY)) {
+            continue;
+        }
+        if (!end && mVideoWaitKeyframe && videoActive()) {
+            spdlog::info(PREFIX "video resume at keyframe");
+            avcodec_flush_buffers(mVideoCodecContext);
+            if (mFilterStage) {
+                mFilterStage->flush();
+            }
+            mVideoWaitKeyframe = false;
+        }
+        if (!end && (raw->flags & AV_PKT_FLAG_KEY) &&
+            mDecodeSizeChanged.exchange(false)) {
+            applyDecodeSize();
+        }
         std::vector<AVFrame *> frames;
-        if (FFmpeg::sendPacket2(videoCodecContext, packet, frames).
-            hasErr()) {
+        const bool failed = FFmpeg::sendPacket2(mVideoCodecContext, raw,
+                                                frames).hasErr();
+        packet.reset();
+        if (end) {
+            // 排空后解码器不再接受输入，seek 之后的包重新开始
+            avcodec_flush_buffers(mVideoCodecContext);
+        } else if (failed) {
             spdlog::error(PREFIX "sendPacket2 error");
+            freeFrames(frames);
             continue;
         }
+        if (videoActive()) {
+            deinterlace(frames);
+            if (end) {
+                mDeinterlacer.Drain(frames);
+                // 帧从尾部取，排空得到的多帧反过来放
+                std::reverse(frames.begin(), frames.end());
+            }
+            // 滤镜里还有帧时即使描述已清空也继续经过它，保持帧的顺序。
+            // 输入通道满时挂起到滤镜取走为止，输出由 filterLoop 交给呈现
+            if (mFilterStage && (!mFilterStage->description().empty() ||
+                                   !mFilterStage->drained())) {
+                while (!frames.empty()) {
+                    if (mDecodeEpoch != mSeekEpoch) {
+                        freeFrames(frames);
+                        break;
+                    }
+                    FrameRef frame{frames.back()};
+                    frames.pop_back();
+                    if (!co_await mFilterStage->push(std::move(frame),
+                                                     mDecodeEpoch)) {
+                        freeFrames(frames);
+                        co_return;
+                    }
+                }
+                FrameRef endOfInput;
+                if (end && !co_await mFilterStage->push(std::move(endOfInput),
+                                                        mDecodeEpoch)) {
+                    co_return;
+                }
+            }
+        }
+        if (!frames.empty()) {
+            mPendingVideo = std::move(frames);
+        }
+        // 接收端按 time_base 换算时间戳
+        const AVRational timeBase = mFormatContext->streams[mVideoStream]->
+            time_base;
+        for (AVFrame *frame: mPendingVideo) {
+            frame->time_base = timeBase;
+        }
+        while (!mPendingVideo.empty()) {
+            if (mDecodeEpoch != mSeekEpoch) {
+                // 等待空位期间发生了 seek
+                freeFrames(mPendingVideo);
+                break;
+            }
+            // GCC 12 会错误地析构 co_await 操作数里的花括号临时对象，
+            // 先放进具名变量
+            DecodedFrame decoded{FrameRef{mPendingVideo.back()}, mDecodeEpoch};
+            mPendingVideo.pop_back();
+            if (!co_await mDecodedVideo.send(std::move(decoded))) {
+                co_return;
+            }
+        }
+    }
+}
 
-        while (!token.stop_requested() && !frames.empty() && !g_is_seeking.
-               load()) {
-            AVFrame *frame = frames.back();
-            frames.pop_back();
-
-            uint64_t pts = frame->pts;
+// 把滤镜输出交给呈现阶段，帧带着送入滤镜时的 seek 代数
+StageCoroutine PlayerController::Impl::filterLoop(std::stop_token token) {
+    const AVRational timeBase = mFormatContext->streams[mVideoStream]->
+        time_base;
+    while (!token.stop_requested()) {
+        std::optional<VideoFilterStage::Item> filtered =
+            co_await mFilterStage->pop();
+        if (!filtered) {
+            co_return;
+        }
+        filtered->frame->time_base = timeBase;
+        DecodedFrame decoded{std::move(filtered->frame), filtered->tag};
+        const bool sent = co_await mDecodedVideo.send(std::move(decoded));
+        mFilterStage->release();
+        if (!sent) {
+            co_return;
+        }
+    }
+}
 
+StageCoroutine PlayerController::Impl::presentLoop(std::stop_token token) {
+    using namespace std::chrono;
+    while (!token.stop_requested()) {
+        std::optional<DecodedFrame> decoded = co_await mDecodedVideo.
+            receive();
+        if (!decoded) {
+            co_return;
+        }
+        // 等到呈现时间。seek 之前解出的帧、不可见时的帧直接丢弃
+        // （不等待也不转换，音频照常播放）
+        bool present = false;
+        bool pacing = false;
+        int64_t presentMs = 0;
+        while (!token.stop_requested()) {
+            pollCommands();
+            if (decoded->epoch != mSeekEpoch || !videoActive()) {
+                break;
+            }
+            if (mIsSeeking || clock().seekPending()) {
+                if (!co_await StageCoroutine::sleepFor(kRetry)) {
+                    co_return;
+                }
+                continue;
+            }
+            if (mIsPaused) {
+                if (!co_await StageCoroutine::sleepFor(kPausePoll)) {
+                    co_return;
+                }
+                continue;
+            }
+            uint64_t pts = decoded->frame->pts;
             uint64_t currentPosMillis = av_q2d(
-                                            g_format_context->streams[
-                                                g_videoStream]->
+                                            mFormatContext->streams[
+                                                mVideoStream]->
                                             time_base)
                                         * pts * 1000;
-
-            using namespace std::chrono;
-            // if (g_is_speeding.load()) {
-            //     auto duration = milliseconds(calDuration());
-            //     auto old_val = g_pause_time.load();
-            //     while (!g_pause_time.compare_exchange_weak(
-            //         old_val, old_val - duration)) {}
-            // }
-            auto deadline = g_start_time + milliseconds(
-                                currentPosMillis) - milliseconds(
-                                g_video_pts_begin);
-            spdlog::warn("begin waiting && waiting");
-            while (!g_is_seeking && (
-                       system_clock::now() - g_pause_time.
-                       load())
-                   <
-                   deadline && !token.stop_requested()) {
-                // spdlog::warn(PREFIX "video wait");
-
-                std::this_thread::sleep_for(1ms);
-            }
-            spdlog::warn("end waiting && invokeMethod ");
-            QMetaObject::invokeMethod(controller, "VideoFrameReady",
-                                      Qt::DirectConnection,
-                                      Q_ARG(VideoFrame, frame));
-            {
-                std::unique_lock<std::mutex> lock(g_mtx_pause);
-                while (g_is_paused && !token.stop_requested() && !
-                       g_is_seeking) {
-                    spdlog::info(PREFIX "video pause");
-                    g_cv_pause.wait(lock);
+            if (const int64_t floor = mVideoSeekFloorMs; floor >= 0) {
+                if (static_cast<int64_t>(currentPosMillis) -
+                    mVideoPtsBegin < floor) {
+                    // 精确 seek：关键帧到目标位置之间的帧只解码不呈现
+                    break;
                 }
+                mVideoSeekFloorMs = -1;
             }
-            if (g_is_seeking) {
-                spdlog::info("video break");
-                break;
+            const int64_t mediaMs = static_cast<int64_t>(currentPosMillis)
+                                    - mVideoPtsBegin;
+            pacing = mVsyncPacing;
+            milliseconds lead = 0ms;
+            if (pacing) {
+                // 至少提前一个帧间隔加一个 vsync，下一帧到达之前
+                // 渲染控件的节拍队列不会空
+                calDuration();
+                lead = FramePacer::leadFor(mFrameIntervalMs);
             }
-            if (token.stop_requested()) {
-                spdlog::info(PREFIX "video break return");
-                return;
+            if (!mUnthrottled) {
+                const auto wait = mPipeline.wait(mediaMs, lead);
+                if (wait > 0ms) {
+                    if (!co_await StageCoroutine::sleepFor(
+                        std::min<StagePool::Clock::duration>(
+                            duration_cast<StagePool::Clock::duration>(wait),
+                            kMaxWait))) {
+                        co_return;
+                    }
+                    continue;
+                }
+            }
+            presentMs = mediaMs;
+            present = true;
+            break;
+        }
+        if (!present) {
+            continue;
+        }
+        const FrameRef &frame = decoded->frame;
+        dispatchVideoFrame(frame, presentMs, pacing);
+        noteSeekEffect(decoded->epoch);
+        {
+            // 只增加引用计数，不拷贝像素，不拖慢播放
+            std::lock_guard lock(mMtxPresented);
+            mPresentedFrame = frame;
+            if (mBurstRemaining > 0 && mScreenshotWriter) {
+                --mBurstRemaining;
+                mScreenshotWriter->enqueue(
+                    frame.get(), QString("%1_%2.%3").arg(mBurstBase)
+                                              .arg(++mBurstIndex, 4, 10,
+                                                   QChar('0'))
+                                              .arg(mBurstSuffix),
+                    mVideoRotation);
             }
         }
-        av_packet_free(&packet);
     }
 }
 
-void startAudioDecode(std::stop_token token, PlayerController *controller) {
+StageCoroutine PlayerController::Impl::audioLoop(std::stop_token token) {
+    using namespace std::chrono;
     while (!token.stop_requested()) {
-        AVPacket *packet{};
-        if (g_is_seeking) {
-            avcodec_flush_buffers(audioCodecContext);
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            continue;
+        std::optional<Packet> packet = co_await mAudioPackets.receive();
+        if (!packet) {
+            co_return;
         }
-        if (!g_buffer_audio.pop(packet)) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (packet->epoch != mSeekEpoch) {
             continue;
         }
-        // spdlog::info("sendAudioPacket frame");
-        std::vector<AVFrame *> frames;
-        if (FFmpeg::sendPacket2(audioCodecContext, packet, frames).
-            hasErr()) {
+        if (packet->epoch != mAudioEpoch) {
+            avcodec_flush_buffers(mAudioCodecContext);
+            mAudioEpoch = packet->epoch;
+        }
+        if (FFmpeg::sendPacket2(mAudioCodecContext, packet->packet.get(),
+                                mPendingAudio).hasErr()) {
             spdlog::error("sendPacket2 error");
-            continue;
         }
-        while (!token.stop_requested() && !frames.empty()) {
-            AVFrame *frame = frames.back();
-            frames.pop_back();
-
+        packet.reset();
+        while (!mPendingAudio.empty() && !token.stop_requested()) {
+            pollCommands();
+            if (mAudioEpoch != mSeekEpoch) {
+                // 等待期间发生了 seek，丢弃后继续取包，读包阶段才能执行 seek
+                freeFrames(mPendingAudio);
+                break;
+            }
+            if (mIsSeeking || clock().seekPending()) {
+                if (!co_await StageCoroutine::sleepFor(kRetry)) {
+                    co_return;
+                }
+                continue;
+            }
+            if (mIsPaused) {
+                if (!co_await StageCoroutine::sleepFor(kPausePoll)) {
+                    co_return;
+                }
+                continue;
+            }
+            AVFrame *frame = mPendingAudio.back();
             uint64_t pts = frame->pts;
 
             uint64_t currentPosMillis = av_q2d(
-                                            g_format_context->streams[
-                                                g_audioStream]->
+                                            mFormatContext->streams[
+                                                mAudioStream]->
                                             time_base)
                                         * pts * 1000;
 
-            using namespace std::chrono;
-
-            auto deadline = g_start_time + milliseconds(
-                                currentPosMillis) - milliseconds(
-                                g_audio_pts_begin);
-
-            while (!g_is_seeking &&
-                   (system_clock::now() - g_pause_time.load())
-                   <
-                   deadline && !token.stop_requested()) {
-                std::this_thread::sleep_for(1ms); // 精细等待
-            }
-
-            if (FFmpeg::decodeAudio(g_swr, frame, audioCodecContext,
-                                    g_is_speeding ? 2.0 : 1.0).
-                hasErr()) {
-                spdlog::error("decodeAudio error");
-
-                av_frame_free(&frame);
-                continue;
+            if (const int64_t floor = mAudioSeekFloorMs; floor >= 0) {
+                if (static_cast<int64_t>(currentPosMillis) -
+                    mAudioPtsBegin < floor) {
+                    mPendingAudio.pop_back();
+                    av_frame_free(&frame);
+                    continue;
+                }
+                mAudioSeekFloorMs = -1;
             }
-            {
-                std::unique_lock<std::mutex> lock(g_mtx_pause);
-                while (g_is_paused && !token.stop_requested() && !
-                       g_is_seeking) {
-                    g_cv_pause.wait(lock);
+            const int64_t mediaMs = static_cast<int64_t>(currentPosMillis)
+                                    - mAudioPtsBegin;
+            if (!mUnthrottled) {
+                const auto wait = mPipeline.wait(mediaMs);
+                if (wait > 0ms) {
+                    if (!co_await StageCoroutine::sleepFor(
+                        std::min<StagePool::Clock::duration>(
+                            duration_cast<StagePool::Clock::duration>(wait),
+                            kMaxWait))) {
+                        co_return;
+                    }
+                    continue;
                 }
             }
-
-            if (g_is_seeking) {
-                spdlog::info("audio break");
-                av_frame_free(&frame);
-                break;
+            mPendingAudio.pop_back();
+            const int bytes = FFmpeg::resampleAudio(
+                mSwr, frame, mAudioCodecContext, mPipeline.audio().sink());
+            if (bytes > 0) {
+                mPipeline.writeAudio(mSwr->OutputData(), bytes);
             }
             av_frame_free(&frame);
+            noteSeekEffect(mAudioEpoch);
         }
-        av_packet_free(&packet);
     }
 }
-}
 
-PlayerController::PlayerController(const PlayerWidget *rendererBridge) {
-    qRegisterMetaType<PlayerState>("PlayerState");
-    qRegisterMetaType<VideoFrame>("VideoFrame");
-    connect(this, &PlayerController::VideoFrameReady,
-            rendererBridge,
-            qOverload<VideoFrame>(&PlayerWidget::onFrameChanged),
-            Qt::DirectConnection);
+void PlayerController::Impl::clearPipeline() {
+    freeFrames(mPendingVideo);
+    freeFrames(mPendingAudio);
+    mDecodedVideo.clear();
+    mVideoPackets.clear();
+    mAudioPackets.clear();
+    mSeekEpoch = 0;
+    mReadEpoch = 0;
+    mDecodeEpoch = 0;
+    mAudioEpoch = 0;
+    mReadEof = false;
+    mCommands.clear();
+    mPendingSeeks = 0;
+    mEffectEpoch = -1;
 }
 
-PlayerController::PlayerController(const OpenglPlayWidget *rendererBridge) {
+PlayerController::PlayerController() : mImpl(new Impl(this)) {
     qRegisterMetaType<PlayerState>("PlayerState");
     qRegisterMetaType<VideoFrame>("VideoFrame");
-    connect(this, &PlayerController::VideoFrameReady,
-            rendererBridge,
-            qOverload<VideoFrame>(&OpenglPlayWidget::onFrameChanged),
-            Qt::DirectConnection);
+    mImpl->mScreenshotWriter = std::make_unique<ScreenshotWriter>(
+        [this](const QString &path, bool ok) {
+            emit ScreenshotSaved(path, ok);
+        });
 }
 
 PlayerController::~PlayerController() {
     Close();
+    withRuntimePipeline(mImpl->mPipeline, [](auto &pipeline) {
+        pipeline.sinks().clear();
+    });
+    // 等待排队中的截图写完
+    mImpl->mScreenshotWriter.reset();
+    delete mImpl;
 }
 
-void PlayerController::Open(const std::string &url) {
-    if (mState == PlayerState::Idle) {
-        mState = PlayerState::Ready;
-        mUrl = url;
-        spdlog::info(PREFIX "open url:{}", url);
-        FFmpeg::openFile(g_format_context, url, g_audioStream, g_videoStream);
-        FFmpeg::openCodec(videoCodecContext, g_videoStream, g_format_context);
-        FFmpeg::openCodec(audioCodecContext, g_audioStream, g_format_context);
-        spdlog::warn(PREFIX "coded_width: {}",
-                     videoCodecContext->coded_width);
-
-        AVStream *stream = g_format_context->streams[g_videoStream];
-        AVRational pts_base = stream->time_base;
-        int64_t video_ms = stream->duration * av_q2d(pts_base) * 1000;
-        g_total_video_time = std::chrono::milliseconds(video_ms);
-        spdlog::info(PREFIX "file total len: {}.{}s", video_ms / 1000 / 60,
-                     video_ms / 1000 % 60);
-        g_audio_pts_begin = g_format_context->streams[g_audioStream]->
-            start_time;
-        g_video_pts_begin = g_format_context->streams[g_videoStream]->
-            start_time;
-        spdlog::info(PREFIX "audio pts begin:{}", g_audio_pts_begin);
-        spdlog::info(PREFIX "video pts begin:{}", g_video_pts_begin);
-        emit StateChanged(mState);
-    } else {
+bool PlayerController::Open(const std::string &url) {
+    if (mState != PlayerState::Idle) {
         spdlog::warn(PREFIX "player is not idle");
+        return false;
+    }
+    spdlog::info(PREFIX "open url:{}", url);
+    try {
+        FFmpeg::openFile(mImpl->mFormatContext, url, mImpl->mAudioStream,
+                         mImpl->mVideoStream);
+    } catch (const std::runtime_error &e) {
+        spdlog::error(PREFIX "open {} failed: {}", url, e.what());
+        // 读流信息失败时输入已经打开
+        avformat_close_input(&mImpl->mFormatContext);
+        return false;
+    }
+    if (mImpl->mVideoStream < 0) {
+        spdlog::error(PREFIX "open {} failed: no video stream", url);
+        avformat_close_input(&mImpl->mFormatContext);
+        return false;
+    }
+    mState = PlayerState::Ready;
+    mUrl = url;
+    AVStream *stream = mImpl->mFormatContext->streams[mImpl->mVideoStream];
+    const int lowres = FFmpeg::chooseLowres(stream, mImpl->mDecodeWidth,
+                                            mImpl->mDecodeHeight);
+    if (lowres > 0) {
+        spdlog::info(PREFIX "decode at lowres {}", lowres);
+    }
+    FFmpeg::openCodec(mImpl->mVideoCodecContext, mImpl->mVideoStream,
+                      mImpl->mFormatContext, lowres);
+    spdlog::warn(PREFIX "coded_width: {}",
+                 mImpl->mVideoCodecContext->coded_width);
+    // 没有音频流时不打开音频解码器，读包阶段也不会送出音频包
+    if (mImpl->mAudioStream >= 0) {
+        FFmpeg::openCodec(mImpl->mAudioCodecContext, mImpl->mAudioStream,
+                          mImpl->mFormatContext);
+        mImpl->mAudioPtsBegin =
+            mImpl->mFormatContext->streams[mImpl->mAudioStream]->start_time;
     }
-}
 
+    AVRational pts_base = stream->time_base;
+    int64_t video_ms = stream->duration * av_q2d(pts_base) * 1000;
+    mImpl->mTotalVideoTime = std::chrono::milliseconds(video_ms);
+    spdlog::info(PREFIX "file total len: {}.{}s", video_ms / 1000 / 60,
+                 video_ms / 1000 % 60);
+    mImpl->mVideoPtsBegin = stream->start_time;
+    spdlog::info(PREFIX "audio pts begin:{}", mImpl->mAudioPtsBegin);
+    spdlog::info(PREFIX "video pts begin:{}", mImpl->mVideoPtsBegin);
+    const int rotation = FFmpeg::getRotation(stream);
+    spdlog::info(PREFIX "video rotation:{}", rotation);
+    mImpl->mVideoRotation = rotation;
+    {
+        std::lock_guard lock(mImpl->mMtxFilters);
+        mImpl->mFilterStage = std::make_unique<VideoFilterStage>(
+            stream->time_base);
+        mImpl->mFilterStage->setDescription(mImpl->mVideoFilters);
+    }
+    emit RotationChanged(rotation);
+    mImpl->mPipeline.rotate(rotation);
+    emit StateChanged(mState);
+    return true;
+}
 
 void PlayerController::Play() {
     if (mState == PlayerState::Playing) {
         mState = PlayerState::Paused;
-        g_last_pause_point = std::chrono::system_clock::now();
-        g_is_paused = true;
+        mImpl->mCommands.push(PlayerCommand::Type::Pause);
         emit StateChanged(mState);
         return;
     }
     if (mState == PlayerState::Paused) {
         mState = PlayerState::Playing;
         spdlog::info(PREFIX "start decode thread");
-
-        auto delta = std::chrono::duration_cast<std::chrono::milliseconds>(
-            std::chrono::system_clock::now() - g_last_pause_point.load());
-
-        std::chrono::milliseconds current = g_pause_time.load();
-        while (!g_pause_time.compare_exchange_weak(current, current + delta)) {}
-        g_is_paused = false;
-        g_cv_pause.notify_all();
+        mImpl->mCommands.push(PlayerCommand::Type::Resume);
         emit StateChanged(mState);
         return;
     }
@@ -454,10 +1031,32 @@ void PlayerController::Play() {
         mState = PlayerState::Playing;
         spdlog::info("start decode thread");
 
-        g_start_time = std::chrono::system_clock::now();
-        mReadTask = std::jthread(startReadPacket, this);
-        mVideoTask = std::jthread(startVideoDecode2, this);
-        mAudioTask = std::jthread(startAudioDecode, this);
+        mImpl->mClock.start = std::chrono::system_clock::now();
+        StagePool &pool = StagePool::instance();
+        Impl *impl = mImpl;
+        mImpl->mReadTask = StageCoroutine::spawn(
+            pool, StagePool::Stage::Read, [impl](std::stop_token token) {
+                return impl->readLoop(token);
+            });
+        mImpl->mDecodeTask = StageCoroutine::spawn(
+            pool, StagePool::Stage::Decode, [impl](std::stop_token token) {
+                return impl->decodeLoop(token);
+            });
+        if (mImpl->mFilterStage) {
+            mImpl->mFilterTask = StageCoroutine::spawn(
+                pool, StagePool::Stage::Decode,
+                [impl](std::stop_token token) {
+                    return impl->filterLoop(token);
+                });
+        }
+        mImpl->mPresentTask = StageCoroutine::spawn(
+            pool, StagePool::Stage::Present, [impl](std::stop_token token) {
+                return impl->presentLoop(token);
+            });
+        mImpl->mAudioTask = StageCoroutine::spawn(
+            pool, StagePool::Stage::Audio, [impl](std::stop_token token) {
+                return impl->audioLoop(token);
+            });
 
         emit StateChanged(mState);
     }
@@ -468,51 +1067,55 @@ void PlayerController::Close() {
     if (mState == PlayerState::Playing || mState == PlayerState::Paused ||
         mState == PlayerState::Ready) {
         mState = PlayerState::Idle;
-        if (mReadTask.joinable()) {
-            mReadTask.request_stop();
-            mReadTask.join();
-        }
-        g_cv_pause.notify_all();
-        if (mVideoTask.joinable()) {
-            mVideoTask.request_stop();
-            mVideoTask.join();
-        }
-        if (mAudioTask.joinable()) {
-            mAudioTask.request_stop();
-            mAudioTask.join();
-        }
-        if (g_swr) {
-            delete g_swr;
-            g_swr = nullptr;
-        }
-        if (videoCodecContext) {
-            avcodec_close(videoCodecContext);
-            videoCodecContext = nullptr;
-        }
-        if (audioCodecContext) {
-            avcodec_close(audioCodecContext);
-            audioCodecContext = nullptr;
-        }
-        if (g_format_context) {
-            avformat_close_input(&g_format_context);
-            g_format_context = nullptr;
-        }
-        g_buffer_video.consume_all([](AVPacket *packet
-            ) {
-                av_packet_free(&packet);
-            });
-        g_buffer_audio.consume_all([](AVPacket *packet) {
-            av_packet_free(&packet);
-        });
-        g_pause_time = 0ms;
-        g_total_video_time = 0ms;
-        g_is_paused = false;
-        g_is_seeking = false;
-        g_seek_pos_ms = 0;
-        g_start_time = std::chrono::time_point<std::chrono::system_clock>();
-        g_last_pause_point = std::chrono::system_clock::now();
-        g_video_pts_begin = 0;
-        g_audio_pts_begin = 0;
+        mImpl->mReadTask.stop();
+        mImpl->mDecodeTask.stop();
+        mImpl->mFilterTask.stop();
+        mImpl->mPresentTask.stop();
+        mImpl->mAudioTask.stop();
+        {
+            std::lock_guard lock(mImpl->mMtxCommandTimings);
+            if (mImpl->mCommandTimings.commands > 0) {
+                spdlog::info(PREFIX "{}", mImpl->mCommandTimings.report());
+            }
+            mImpl->mCommandTimings = {};
+        }
+        mImpl->clearPipeline();
+        if (mImpl->mSwr) {
+            delete mImpl->mSwr;
+            mImpl->mSwr = nullptr;
+        }
+        if (mImpl->mVideoCodecContext) {
+            avcodec_close(mImpl->mVideoCodecContext);
+            mImpl->mVideoCodecContext = nullptr;
+        }
+        if (mImpl->mAudioCodecContext) {
+            avcodec_close(mImpl->mAudioCodecContext);
+            mImpl->mAudioCodecContext = nullptr;
+        }
+        if (mImpl->mFormatContext) {
+            avformat_close_input(&mImpl->mFormatContext);
+            mImpl->mFormatContext = nullptr;
+        }
+        mImpl->mClock.pauseTime = 0ms;
+        mImpl->mTotalVideoTime = 0ms;
+        mImpl->mIsPaused = false;
+        mImpl->mIsSeeking = false;
+        mImpl->mSeekPosMs = 0;
+        mImpl->mClock.start = std::chrono::system_clock::time_point{};
+        mImpl->mLastPausePoint = std::chrono::system_clock::now();
+        mImpl->mVideoPtsBegin = 0;
+        mImpl->mAudioPtsBegin = 0;
+        mImpl->mVideoWaitKeyframe = false;
+        mImpl->mBurstRemaining = 0;
+        mImpl->mDeinterlacer.Close();
+        {
+            std::lock_guard lock(mImpl->mMtxFilters);
+            mImpl->mFilterStage.reset();
+        }
+        {
+            std::lock_guard lock(mImpl->mMtxPresented);
+            mImpl->mPresentedFrame = FrameRef{};
+        }
         emit StateChanged(mState);
     } else {
         spdlog::warn(
@@ -529,23 +1132,194 @@ void PlayerController::Speed(bool checked) const {
     }
     if (checked) {
         spdlog::info(PREFIX "speed up");
-        g_is_speeding = true;
-        g_cv_pause.notify_all();
-    } else {
-        g_is_speeding = false;
-        g_cv_pause.notify_all();
     }
+    mImpl->mCommands.push(PlayerCommand::Type::Speed, checked);
+}
+
+void PlayerController::SetVideoVisible(bool visible) {
+    if (visible == mImpl->mVideoVisible) {
+        return;
+    }
+    spdlog::info(PREFIX "video visible:{}", visible);
+    if (visible && mImpl->mSkipHiddenVideo &&
+        !mImpl->mPipeline.videoAlwaysActive()) {
+        mImpl->mVideoWaitKeyframe = true;
+    }
+    mImpl->mVideoVisible = visible;
+}
+
+void PlayerController::AddVideoSink(VideoSink *sink) {
+    if (!withRuntimePipeline(mImpl->mPipeline, [sink](auto &pipeline) {
+            pipeline.sinks().add(sink);
+        })) {
+        spdlog::warn(PREFIX "video sinks are fixed at build time");
+    }
+}
+
+void PlayerController::RemoveVideoSink(VideoSink *sink) {
+    withRuntimePipeline(mImpl->mPipeline, [sink](auto &pipeline) {
+        pipeline.sinks().remove(sink);
+    });
+}
+
+void PlayerController::connectNotify(const QMetaMethod &signal) {
+    QObject::connectNotify(signal);
+    mImpl->mFrameSignalReceivers =
+        receivers(SIGNAL(VideoFrameReady(VideoFrame)));
+}
+
+void PlayerController::disconnectNotify(const QMetaMethod &signal) {
+    // 断开全部连接时 signal 可能无效，直接重新计数
+    QObject::disconnectNotify(signal);
+    mImpl->mFrameSignalReceivers =
+        receivers(SIGNAL(VideoFrameReady(VideoFrame)));
+}
+
+void PlayerController::BenchmarkDispatch(int frames) {
+    struct CountingSink final : VideoSink {
+        uint64_t received = 0;
+
+        void onVideoFrame(const FrameRef &frame) override {
+            received += frame->width > 0;
+        }
+    };
+    using Clock = std::chrono::steady_clock;
+    frames = std::max(frames, 1);
+    // 只用来发信号的独立实例：会话状态都在各自的 Impl 里，
+    // 不影响正在播放的控制器（截图线程、可见性、节拍、接收端）
+    PlayerController controller;
+    const FrameRef frame{av_frame_alloc()};
+    frame->width = 1920;
+    frame->height = 1080;
+
+    // 旧路径：按名字查找信号、封送参数，再经连接调用接收者
+    uint64_t received = 0;
+    const auto connection = connect(
+        &controller, &PlayerController::VideoFrameReady, &controller,
+        [&received](VideoFrame f) {
+            received += f->width > 0;
+        }, Qt::DirectConnection);
+    auto begin = Clock::now();
+    for (int i = 0; i < frames; ++i) {
+        QMetaObject::invokeMethod(&controller, "VideoFrameReady",
+                                  Qt::DirectConnection,
+                                  Q_ARG(VideoFrame, frame.get()));
+    }
+    const double invokeNs = std::chrono::duration<double, std::nano>(
+                                Clock::now() - begin).count() / frames;
+    disconnect(connection);
+
+    // 与 dispatchVideoFrame 相同的接收端列表，不经过任何控制器
+    CountingSink sink;
+    SinkList sinks;
+    sinks.add(&sink);
+    begin = Clock::now();
+    for (int i = 0; i < frames; ++i) {
+        sinks.deliver(frame, false, 0);
+    }
+    const double sinkNs = std::chrono::duration<double, std::nano>(
+                              Clock::now() - begin).count() / frames;
+
+    spdlog::info(PREFIX "dispatch {} frames: invokeMethod {:.1f}ns/frame "
+                 "({}), VideoSink {:.1f}ns/frame ({})", frames, invokeNs,
+                 received, sinkNs, sink.received);
+}
+
+void PlayerController::SetSkipHiddenVideo(bool skip) {
+    mImpl->mSkipHiddenVideo = skip;
+}
+
+void PlayerController::FollowClock(PlayerController *master) {
+    Impl *impl = mImpl;
+    Impl *clockMaster = master && master != this ? master->mImpl : nullptr;
+    if (!withRuntimePipeline(impl->mPipeline, [=](auto &pipeline) {
+            impl->mClockMaster = clockMaster;
+            pipeline.clock().follow(clockMaster ? &clockMaster->mClock
+                                                : nullptr);
+        })) {
+        spdlog::warn(PREFIX "clock is fixed at build time");
+    }
+}
+
+void PlayerController::SetAccurateSeek(bool accurate) {
+    mImpl->mAccurateSeek = accurate;
+}
+
+void PlayerController::SetDecodeSizeHint(int width, int height) {
+    mImpl->mDecodeWidth = width;
+    mImpl->mDecodeHeight = height;
+    mImpl->mDecodeSizeChanged = true;
+}
+
+void PlayerController::SetAudioSink(AudioSink *sink) {
+    AudioSink *output = sink ? sink : &mImpl->mSoundCard;
+    if (!withRuntimePipeline(mImpl->mPipeline, [output](auto &pipeline) {
+            pipeline.audio().set(output);
+        })) {
+        spdlog::warn(PREFIX "audio output is fixed at build time");
+    }
+}
+
+void PlayerController::SetUnthrottled(bool unthrottled) {
+    spdlog::info(PREFIX "unthrottled:{}", unthrottled);
+    mImpl->mUnthrottled = unthrottled;
+}
+
+void PlayerController::SetVsyncPacing(bool enable) {
+    spdlog::info(PREFIX "vsync pacing:{}", enable);
+    mImpl->mVsyncPacing = enable;
+}
+
+bool PlayerController::Screenshot(const QString &path) {
+    std::lock_guard lock(mImpl->mMtxPresented);
+    if (!mImpl->mPresentedFrame || !mImpl->mScreenshotWriter) {
+        spdlog::warn(PREFIX "no frame to capture");
+        return false;
+    }
+    return mImpl->mScreenshotWriter->enqueue(mImpl->mPresentedFrame.get(), path,
+                                        mImpl->mVideoRotation);
+}
+
+void PlayerController::ScreenshotBurst(const QString &basePath, int count,
+                                       const QString &suffix) {
+    std::lock_guard lock(mImpl->mMtxPresented);
+    spdlog::info(PREFIX "burst {} frames to {}", count,
+                 basePath.toStdString());
+    mImpl->mBurstBase = basePath;
+    mImpl->mBurstSuffix = suffix;
+    mImpl->mBurstIndex = 0;
+    mImpl->mBurstRemaining = std::max(count, 0);
+}
+
+void PlayerController::SetDeinterlace(DeinterlaceMode mode, bool bwdif) {
+    spdlog::info(PREFIX "deinterlace mode:{} bwdif:{}",
+                 static_cast<int>(mode), bwdif);
+    mImpl->mDeinterlaceBwdif = bwdif;
+    mImpl->mDeinterlaceMode = mode;
+}
+
+void PlayerController::SetVideoFilters(const std::string &description) {
+    std::lock_guard lock(mImpl->mMtxFilters);
+    mImpl->mVideoFilters = description;
+    if (mImpl->mFilterStage) {
+        mImpl->mFilterStage->setDescription(description);
+    }
+}
+
+std::vector<VideoFilterStage::Timing>
+PlayerController::VideoFilterTimings() const {
+    std::lock_guard lock(mImpl->mMtxFilters);
+    return mImpl->mFilterStage ? mImpl->mFilterStage->timings()
+                          : std::vector<VideoFilterStage::Timing>{};
 }
 
 void PlayerController::SeekTo(int64_t seek_pos) {
     if (mState == PlayerState::Playing) {
         mState = PlayerState::Seeking;
-        g_last_pause_point = std::chrono::system_clock::now();
-        g_is_paused = false;
-        g_cv_pause.notify_all();
-        g_is_seeking = true;
-        spdlog::info(PREFIX "seek to {}", seek_pos);
-        g_seek_pos_ms = seek_pos;
+        ++mImpl->mPendingSeeks;
+        const uint64_t sequence = mImpl->mCommands.push(
+            PlayerCommand::Type::Seek, seek_pos);
+        spdlog::info(PREFIX "seek to {} (#{})", seek_pos, sequence);
         mState = PlayerState::Playing;
         emit StateChanged(mState);
         return;
@@ -553,12 +1327,10 @@ void PlayerController::SeekTo(int64_t seek_pos) {
 
     if (mState == PlayerState::Paused) {
         mState = PlayerState::Seeking;
-        g_last_pause_point = std::chrono::system_clock::now();
-        g_is_paused = false;
-        g_cv_pause.notify_all();
-        g_is_seeking = true;
-        spdlog::info(PREFIX "seek to {}", seek_pos);
-        g_seek_pos_ms = seek_pos;
+        ++mImpl->mPendingSeeks;
+        const uint64_t sequence = mImpl->mCommands.push(
+            PlayerCommand::Type::Seek, seek_pos);
+        spdlog::info(PREFIX "seek to {} (#{})", seek_pos, sequence);
         mState = PlayerState::Playing;
         emit StateChanged(mState);
         return;
@@ -567,13 +1339,18 @@ void PlayerController::SeekTo(int64_t seek_pos) {
 }
 
 
+CommandTimings PlayerController::CommandLatency() const {
+    std::lock_guard lock(mImpl->mMtxCommandTimings);
+    return mImpl->mCommandTimings;
+}
+
 std::pair<int64_t, int64_t> PlayerController::CurrentPosition() const {
     using namespace std::chrono;
 
     int64_t current_ms = duration_cast<milliseconds>(
-        (system_clock::now() - g_pause_time.load() - g_start_time)
+        system_clock::now() - mImpl->mPipeline.clock().origin()
         ).count();
 
-    int64_t total_ms = g_total_video_time.count();
+    int64_t total_ms = mImpl->mTotalVideoTime.count();
     return {current_ms, total_ms};
 }
@@ -2,11 +2,15 @@
 #include <string>
 #include <memory>
 #include <qobjectdefs.h>
-#include "CommonDef.h"
+#include "FrameTypes.h"
 #include <qobject.h>
+#include <QString>
 #include <future>
 #include <thread>
-#include "OpenglPlayWidget.h"
+#include "VideoSink.h"
+#include "VideoFilterStage.h"
+#include "AudioSink.h"
+#include "CommandQueue.h"
 extern "C" {
 #include <libavutil/frame.h>
 }
@@ -24,27 +28,77 @@ enum class PlayerState {
     Speeding,
     Error,
 };
-class PlayerWidget;
-class OpenglPlayWidget;
+// 去隔行：Auto 在遇到 interlaced_frame 时自动启用，只处理隔行帧
+enum class DeinterlaceMode {
+    Off,
+    Auto,
+    Always,
+};
+// 播放引擎（modernplayer_core），不依赖 Qt Widgets。帧交给 AddVideoSink
+// 挂上的接收端，显示控件由界面层用 VideoRenderer::attach 挂上
 class PlayerController : public QObject {
     Q_OBJECT
 
 public:
-    explicit PlayerController(const  PlayerWidget *rendererBridge);
-    explicit PlayerController(const  OpenglPlayWidget *rendererBridge);
+    PlayerController();
     ~PlayerController() override;
-    void Open(const std::string &url); // 支持本地/网络
+    // 支持本地/网络。打不开或没有视频流时返回 false，保持 Idle
+    bool Open(const std::string &url);
     void Play();
     void Close();
     void Speed(bool checked) const;
     void SeekTo(int64_t seek_pos);
+    // 渲染控件可见性。不可见时跳过视频帧的等待、转换和绘制，音频不受影响
+    void SetVideoVisible(bool visible);
+    // 挂上/摘下视频帧接收端（显示、录制、分析等）。RemoveVideoSink 返回后
+    // 不会再回调该接收端。sink 的生命周期由调用方管理
+    void AddVideoSink(VideoSink *sink);
+    void RemoveVideoSink(VideoSink *sink);
+    // 跟随 master 的时钟（对比播放）：呈现和音频按 master 的起点与暂停计时，
+    // 自己 seek 时不再调整时钟，master seek 期间暂停呈现。
+    // master 需比本对象活得久，nullptr 恢复独立时钟
+    void FollowClock(PlayerController *master);
+    // 精确 seek：从关键帧解码到目标位置，之前的帧不呈现、不输出（默认关闭）
+    void SetAccurateSeek(bool accurate);
+    // 显示尺寸提示。解码器支持 lowres（MPEG-2/4、MJPEG 等）时直接以
+    // 不小于该尺寸的降采样分辨率解码；播放中改变时从下一个关键帧起生效
+    void SetDecodeSizeHint(int width, int height);
+    // 音频输出端，nullptr 为声卡。需在 Open 之前设置，生命周期由调用方管理
+    void SetAudioSink(AudioSink *sink);
+    // 不按时间戳等待，尽快解码和交付（无界面基准测试用）
+    void SetUnthrottled(bool unthrottled);
+    // 不可见期间只把关键帧送进解码器（默认开启）
+    void SetSkipHiddenVideo(bool skip);
+    // 垂直同步节拍：提前 FramePacer::leadFor() 交付帧，由渲染控件按 vsync 选帧
+    void SetVsyncPacing(bool enable);
+    // 截取当前呈现的帧：原始分辨率（含显示旋转），后台线程转换并编码，
+    // 格式由后缀决定（png/jpg）。没有可截取的帧时返回 false
+    bool Screenshot(const QString &path);
+    // 连拍：从下一帧起连续截取 count 帧，写入 basePath_0001.suffix ...
+    void ScreenshotBurst(const QString &basePath, int count,
+                         const QString &suffix = "png");
+    // 解码与呈现之间的 yadif/bwdif 滤镜（send_frame，不改变帧率），默认 Auto + bwdif
+    void SetDeinterlace(DeinterlaceMode mode, bool bwdif = true);
+    // 通用 libavfilter 滤镜（crop/降噪/叠加/缩放等），在独立线程运行，
+    // 例如 "crop=1280:720,hqdn3d"；空字符串关闭。输出需为 YuvConverter 支持的格式
+    void SetVideoFilters(const std::string &description);
+    // 各滤镜的每帧耗时
+    std::vector<VideoFilterStage::Timing> VideoFilterTimings() const;
+    // Play/SeekTo/Speed 只把命令放进队列，由流水线在检查点应用。
+    // 这里是命令从发出到应用、seek 从发出到第一帧送出的耗时
+    CommandTimings CommandLatency() const;
     std::pair<int64_t, int64_t> CurrentPosition() const;
 
 Q_SIGNALS:
+    // 兼容旧接口：在视频线程发出，只在有连接时发出。新代码用 VideoSink
     void VideoFrameReady(VideoFrame frame);
     void AudioFrameReady(AudioFrame frame);
     void ErrorOccurred(std::string msg);
     void StateChanged(PlayerState state);
+    // 视频流显示矩阵的顺时针旋转角度，Open 时发出
+    void RotationChanged(int rotation);
+    // 截图写入完成，在截图线程发出
+    void ScreenshotSaved(QString path, bool ok);
 
 public:
     PlayerState state() const {
@@ -55,10 +109,16 @@ public:
         return mUrl;
     }
 
+    // 比较每帧分发的开销：按名字 invokeMethod（旧路径）与直接调用 VideoSink
+    static void BenchmarkDispatch(int frames = 1000000);
+
+protected:
+    void connectNotify(const QMetaMethod &signal) override;
+    void disconnectNotify(const QMetaMethod &signal) override;
+
 private:
+    struct Impl;
+    Impl *mImpl{};
     PlayerState mState{PlayerState::Idle};
     std::string mUrl{};
-    std::jthread mReadTask{};
-    std::jthread mVideoTask{};
-    std::jthread mAudioTask{};
 };
@@ -0,0 +1,179 @@
+#include "PlayerEngine.h"
+#include "PlayerController.h"
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+
+// 自己作为控制器的视频和音频接收端，把收到的帧和 PCM 排队等调用方取走
+struct PlayerEngine::Impl final : VideoSink, AudioSink {
+    explicit Impl(const Options &options): options(options) {}
+
+    void onVideoFrame(const FrameRef &frame) override {
+        {
+            std::lock_guard lock(mtx);
+            if (frames.size() >= std::max<size_t>(options.maxQueuedFrames,
+                                                  1)) {
+                frames.pop_front();
+                ++stats.droppedVideoFrames;
+            }
+            frames.push_back(frame);
+            ++stats.videoFrames;
+        }
+        cv.notify_all();
+    }
+
+    // 调用方要的是每一帧，控件是否可见与此无关
+    bool alwaysActive() const override {
+        return true;
+    }
+
+    void open(int sampleRate, int channels, int bitsPerSample) override {
+        std::lock_guard lock(mtx);
+        format = {sampleRate, channels, bitsPerSample};
+    }
+
+    void write(const char *data, qint64 bytes) override {
+        {
+            std::lock_guard lock(mtx);
+            if (audio.size() >= std::max<size_t>(options.maxQueuedAudio, 1)) {
+                audio.pop_front();
+                ++stats.droppedAudioChunks;
+            }
+            audio.push_back({format, std::vector<char>(data, data + bytes)});
+            ++stats.audioChunks;
+        }
+        cv.notify_all();
+    }
+
+    void clearQueues() {
+        std::lock_guard lock(mtx);
+        frames.clear();
+        audio.clear();
+    }
+
+    const Options options;
+    PlayerController controller;
+    // 保护 controller 的状态切换
+    mutable std::mutex controlMtx;
+    mutable std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<FrameRef> frames;
+    std::deque<AudioChunk> audio;
+    AudioFormat format;
+    Stats stats;
+};
+
+PlayerEngine::PlayerEngine(): PlayerEngine(Options{}) {}
+
+PlayerEngine::PlayerEngine(const Options &options)
+    : mImpl(new Impl(options)) {
+    PlayerController &controller = mImpl->controller;
+    controller.AddVideoSink(mImpl);
+    controller.SetAudioSink(mImpl);
+    controller.SetUnthrottled(options.unthrottled);
+    controller.SetAccurateSeek(options.accurateSeek);
+    controller.SetDecodeSizeHint(options.decodeWidth, options.decodeHeight);
+}
+
+PlayerEngine::~PlayerEngine() {
+    close();
+    mImpl->controller.RemoveVideoSink(mImpl);
+    delete mImpl;
+}
+
+bool PlayerEngine::open(const std::string &url) {
+    std::lock_guard lock(mImpl->controlMtx);
+    return mImpl->controller.Open(url);
+}
+
+void PlayerEngine::play() {
+    std::lock_guard lock(mImpl->controlMtx);
+    const PlayerState state = mImpl->controller.state();
+    if (state == PlayerState::Ready || state == PlayerState::Paused) {
+        mImpl->controller.Play();
+    }
+}
+
+void PlayerEngine::pause() {
+    std::lock_guard lock(mImpl->controlMtx);
+    if (mImpl->controller.state() == PlayerState::Playing) {
+        mImpl->controller.Play();
+    }
+}
+
+void PlayerEngine::seek(int64_t positionMs) {
+    std::lock_guard lock(mImpl->controlMtx);
+    mImpl->controller.SeekTo(positionMs);
+    // 队列里是 seek 之前的帧和 PCM。呈现阶段交付每帧前都会取命令，
+    // 之后最多还会收到一帧正在交付的旧帧
+    mImpl->clearQueues();
+}
+
+void PlayerEngine::close() {
+    {
+        std::lock_guard lock(mImpl->controlMtx);
+        if (mImpl->controller.state() != PlayerState::Idle) {
+            mImpl->controller.Close();
+        }
+    }
+    mImpl->clearQueues();
+}
+
+PlayerEngine::State PlayerEngine::state() const {
+    std::lock_guard lock(mImpl->controlMtx);
+    switch (mImpl->controller.state()) {
+        case PlayerState::Ready:
+            return State::Ready;
+        case PlayerState::Playing:
+        case PlayerState::Seeking:
+        case PlayerState::Speeding:
+            return State::Playing;
+        case PlayerState::Paused:
+            return State::Paused;
+        default:
+            return State::Idle;
+    }
+}
+
+int64_t PlayerEngine::positionMs() const {
+    return mImpl->controller.CurrentPosition().first;
+}
+
+int64_t PlayerEngine::durationMs() const {
+    return mImpl->controller.CurrentPosition().second;
+}
+
+FrameRef PlayerEngine::nextVideoFrame(std::chrono::milliseconds timeout) {
+    std::unique_lock lock(mImpl->mtx);
+    if (!mImpl->cv.wait_for(lock, timeout, [this] {
+        return !mImpl->frames.empty();
+    })) {
+        return {};
+    }
+    FrameRef frame = std::move(mImpl->frames.front());
+    mImpl->frames.pop_front();
+    return frame;
+}
+
+std::optional<PlayerEngine::AudioChunk> PlayerEngine::nextAudio(
+    std::chrono::milliseconds timeout) {
+    std::unique_lock lock(mImpl->mtx);
+    if (!mImpl->cv.wait_for(lock, timeout, [this] {
+        return !mImpl->audio.empty();
+    })) {
+        return std::nullopt;
+    }
+    AudioChunk chunk = std::move(mImpl->audio.front());
+    mImpl->audio.pop_front();
+    return chunk;
+}
+
+PlayerEngine::Stats PlayerEngine::stats() const {
+    std::lock_guard lock(mImpl->mtx);
+    return mImpl->stats;
+}
+
+PlayerController &PlayerEngine::controller() {
+    return mImpl->controller;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "VideoSink.h"
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+class PlayerController;
+
+// modernplayer_core 的无界面接口，头文件不涉及 Qt 类型，供服务进程嵌入和
+// 单独测性能：打开、播放、暂停、seek，按需取出解码后的视频帧和 PCM。
+// 取出的帧和 PCM 在内部排队，消费跟不上时丢弃最旧的并计数，不阻塞流水线。
+// 所有方法线程安全
+class PlayerEngine {
+public:
+    struct Options {
+        // 不按时间戳等待，解码多快交付多快（转码、分析）
+        bool unthrottled = false;
+        bool accurateSeek = false;
+        // 支持 lowres 的编码按不小于此尺寸降采样解码，0 为原尺寸
+        int decodeWidth = 0;
+        int decodeHeight = 0;
+        size_t maxQueuedFrames = 8;
+        size_t maxQueuedAudio = 64;
+    };
+
+    enum class State {
+        Idle,
+        Ready,
+        Playing,
+        Paused,
+    };
+
+    struct AudioFormat {
+        int sampleRate = 0;
+        int channels = 0;
+        int bitsPerSample = 0;
+    };
+
+    // 交错的有符号整数 PCM，小端
+    struct AudioChunk {
+        AudioFormat format;
+        std::vector<char> data;
+    };
+
+    struct Stats {
+        uint64_t videoFrames = 0;
+        uint64_t droppedVideoFrames = 0;
+        uint64_t audioChunks = 0;
+        uint64_t droppedAudioChunks = 0;
+    };
+
+    PlayerEngine();
+    explicit PlayerEngine(const Options &options);
+    ~PlayerEngine();
+
+    PlayerEngine(const PlayerEngine &) = delete;
+    PlayerEngine &operator=(const PlayerEngine &) = delete;
+
+    // 本地文件或网络地址，失败返回 false
+    bool open(const std::string &url);
+    void play();
+    void pause();
+    // 播放或暂停中有效，丢弃已排队的帧和 PCM，之后取到的是目标位置的帧
+    void seek(int64_t positionMs);
+    void close();
+
+    State state() const;
+    int64_t positionMs() const;
+    int64_t durationMs() const;
+
+    // 等待下一帧，超时返回空 FrameRef
+    FrameRef nextVideoFrame(std::chrono::milliseconds timeout);
+    // 等待下一块 PCM，超时返回空
+    std::optional<AudioChunk> nextAudio(std::chrono::milliseconds timeout);
+
+    Stats stats() const;
+
+    // 滤镜、截图、线程等进一步的设置
+    PlayerController &controller();
+
+private:
+    struct Impl;
+    Impl *mImpl{};
+};
@@ -0,0 +1,44 @@
+#pragma once
+
+#include "FramePipeline.h"
+
+// PlayerController 用的呈现路径，构建时选择。默认 RuntimeFramePipeline；
+// CMake 的 MODERNPLAYER_PIPELINE_HEADER 指定头文件时改用其中的配置，
+// 该头文件需定义 PlayerPipeline 和
+//     PlayerPipeline makePlayerPipeline(const PlaybackClock &clock,
+//                                       AudioSink *soundCard);
+// soundCard 为控制器自带的声卡输出，可以不用。静态配置下 AddVideoSink、
+// SetAudioSink、FollowClock 不起作用，示例见 examples/static_pipeline.h
+#ifdef MODERNPLAYER_PIPELINE_HEADER
+#include MODERNPLAYER_PIPELINE_HEADER
+#else
+using PlayerPipeline = RuntimeFramePipeline;
+
+inline PlayerPipeline makePlayerPipeline(const PlaybackClock &clock,
+                                         AudioSink *soundCard) {
+    return PlayerPipeline{clock, soundCard};
+}
+#endif
+
+// 运行时配置：接收端可增删、时钟可跟随、音频输出可替换
+template<class Pipeline>
+concept RuntimeConfigurable = requires(Pipeline &pipeline, VideoSink *video,
+                                       AudioSink *audio,
+                                       const PlaybackClock *master) {
+    pipeline.sinks().add(video);
+    pipeline.sinks().remove(video);
+    pipeline.sinks().clear();
+    pipeline.clock().follow(master);
+    pipeline.audio().set(audio);
+};
+
+// 运行时配置时调用 f(pipeline) 并返回 true；静态配置下 f 不会实例化
+template<class Pipeline, class F>
+bool withRuntimePipeline(Pipeline &pipeline, F &&f) {
+    if constexpr (RuntimeConfigurable<Pipeline>) {
+        f(pipeline);
+        return true;
+    } else {
+        return false;
+    }
+}
@@ -2,9 +2,16 @@
 #include <spdlog/spdlog.h>
 #include "PlayerController.h"
 #include <QPainter>
-#include "libyuv.h"
+#include "YuvConverter.h"
+#include "ViewZoom.h"
+#include "RepaintCoalescer.h"
+#include <QMouseEvent>
+#include <QWheelEvent>
 #include <QStyleOption>
 #include <QTimer>
+#include <atomic>
+#include <memory>
+#include <mutex>
 
 extern "C" {
 #include <libavutil/frame.h>
@@ -12,10 +19,70 @@ extern "C" {
 
 
 struct PlayerWidget::Impl {
+    std::mutex mtx;
     std::vector<uint8_t> g_rgbaData;
     int g_width = 0;
     int g_height = 0;
+    // g_rgbaData 中已缩放到显示尺寸的图像
+    int g_dstWidth = 0;
+    int g_dstHeight = 0;
     int g_stride = 0;
+    QRect g_viewRect;
+    // 保留最近一帧的引用，暂停时变焦/平移也能重新转换
+    AVFrame *g_lastFrame{};
+    ViewZoom zoom;
+    QPoint dragPos;
+    // 隐藏时只保留帧引用，不转换也不重绘
+    std::atomic_bool visible{false};
+    int rotation = 0; // 顺时针，g_width/g_height 为旋转后的尺寸
+    // 内容未变的帧（暂停、静态画面、重复帧）跳过转换和重绘
+    FrameChangeDetector changeDetector;
+    std::unique_ptr<RepaintCoalescer> repaint;
+
+    ~Impl() {
+        av_frame_free(&g_lastFrame);
+    }
+
+    // 需持有 mtx。只转换可见区域，再缩放到显示尺寸
+    void renderLocked() {
+        if (!g_lastFrame) {
+            return;
+        }
+        const AVFrame *frame = g_lastFrame;
+        QRect dstRect = scaleKeepAspectRatio(g_viewRect, g_width, g_height);
+        if (dstRect.isEmpty()) {
+            dstRect = {0, 0, g_width, g_height};
+        }
+        g_dstWidth = dstRect.width();
+        g_dstHeight = dstRect.height();
+        g_stride = g_dstWidth * 4;
+        g_rgbaData.resize(static_cast<size_t>(g_stride) * g_dstHeight);
+
+        AVFrame *view = nullptr;
+        if (zoom.active()) {
+            const QRect roi = zoom.sourceRect(frame->width, frame->height);
+            view = YuvConverter::cropView(frame, roi.x(), roi.y(),
+                                          roi.width(), roi.height());
+        }
+        // 调用转换
+        YuvConverter::instance().convertScaled(
+            view ? view : frame, g_rgbaData.data(), g_stride,
+            g_dstWidth, g_dstHeight, rotation);
+        av_frame_free(&view);
+    }
+
+    // 控件坐标 -> 画面内归一化坐标
+    QPointF toImage(const QPointF &pos) const {
+        const QRect dstRect = scaleKeepAspectRatio(g_viewRect, g_width,
+                                                   g_height);
+        if (dstRect.isEmpty()) {
+            return {0.5, 0.5};
+        }
+        return {
+            std::clamp((pos.x() - dstRect.x()) / dstRect.width(), 0.0, 1.0),
+            std::clamp((pos.y() - dstRect.y()) / dstRect.height(), 0.0, 1.0)
+        };
+    }
 
     QRect
     static scaleKeepAspectRatio(const QRect &outer, int inner_w, int inner_h) {
@@ -46,35 +113,32 @@ struct PlayerWidget::Impl {
 PlayerWidget::PlayerWidget(QWidget *parent): QWidget(parent),
                                              mImpl(new Impl{}) {
     setStyleSheet("QWidget{border: 1px solid black; background-color: black;}");
+    // paintEvent 自己画满背景，Qt 不必先擦除
+    setAttribute(Qt::WA_OpaquePaintEvent);
+    mImpl->repaint = std::make_unique<RepaintCoalescer>(this);
+}
+
+PlayerWidget::~PlayerWidget() {
+    delete mImpl;
 }
 
 
 void PlayerWidget::onFrameChanged(VideoFrame frame) {
-
-    const uint8_t *src_y = frame->data[0];
-    const uint8_t *src_u = frame->data[1];
-    const uint8_t *src_v = frame->data[2];
-
-    int src_stride_y = frame->linesize[0];
-    int src_stride_u = frame->linesize[1];
-    int src_stride_v = frame->linesize[2];
-    // spdlog::warn("onFrameChanged: VideoFrame2");
-    mImpl->g_width = frame->width;
-    mImpl->g_height = frame->height;
-
-    mImpl->g_rgbaData = std::vector<uint8_t>(
-        mImpl->g_width * mImpl->g_height * 4);
-    mImpl->g_stride = mImpl->g_width * 4;
-
-    // 调用转换
-    libyuv::I420ToARGB(
-        src_y, src_stride_y,
-        src_u, src_stride_u,
-        src_v, src_stride_v,
-        mImpl->g_rgbaData.data(), mImpl->g_stride,
-        mImpl->g_width, mImpl->g_height
-        );
-    this->update();
+    {
+        std::lock_guard lock(mImpl->mtx);
+        const bool swap = mImpl->rotation == 90 || mImpl->rotation == 270;
+        mImpl->g_width = swap ? frame->height : frame->width;
+        mImpl->g_height = swap ? frame->width : frame->height;
+        av_frame_free(&mImpl->g_lastFrame);
+        mImpl->g_lastFrame = av_frame_clone(frame);
+        if (!mImpl->visible || !mImpl->changeDetector.changed(frame)) {
+            return;
+        }
+        // 在解码线程直接缩放到显示尺寸，paintEvent 不再做 SmoothTransformation
+        mImpl->renderLocked();
+    }
+    // 解码线程不直接 update()，由刷新节拍合并
+    mImpl->repaint->markDirty();
 }
 
 
@@ -83,6 +147,7 @@ void PlayerWidget::paintEvent(QPaintEvent *event) {
     opt.init(this);
     QPainter painter(this);
     style()->drawPrimitive(QStyle::PE_Widget, &opt, &painter, this);
+    std::lock_guard lock(mImpl->mtx);
     if (mImpl->g_rgbaData.empty()) {
         return;
     }
@@ -91,19 +156,115 @@ void PlayerWidget::paintEvent(QPaintEvent *event) {
 
     const QRect dstRect = Impl::scaleKeepAspectRatio(
         viewRect, mImpl->g_width, mImpl->g_height);
+    // 尺寸一致时直接绘制；窗口刚缩放、下一帧未到时由 QPainter 临时拉伸
     const QImage rgbImage = QImage(
         mImpl->g_rgbaData.data(),
-        mImpl->g_width,
-        mImpl->g_height,
+        mImpl->g_dstWidth,
+        mImpl->g_dstHeight,
         mImpl->g_stride,
         QImage::Format_ARGB32
-        ).scaled(dstRect.size(), Qt::KeepAspectRatioByExpanding,
-                 Qt::SmoothTransformation);
+        );
 
     painter.drawImage(dstRect, rgbImage);
 }
 
+void PlayerWidget::resizeEvent(QResizeEvent *event) {
+    {
+        std::lock_guard lock(mImpl->mtx);
+        mImpl->g_viewRect = rect();
+        mImpl->renderLocked();
+    }
+    QWidget::resizeEvent(event);
+}
+
+
+void PlayerWidget::setRotation(int rotation) {
+    {
+        std::lock_guard lock(mImpl->mtx);
+        if (mImpl->g_lastFrame &&
+            (mImpl->rotation - rotation) % 180 != 0) {
+            std::swap(mImpl->g_width, mImpl->g_height);
+        }
+        mImpl->rotation = rotation;
+        mImpl->zoom.reset();
+        mImpl->renderLocked();
+    }
+    update();
+}
+
+QMetaObject::Connection PlayerWidget::connectVisibility(
+    QObject *receiver, std::function<void(bool)> callback) {
+    return connect(this, &PlayerWidget::visibilityChanged, receiver,
+                   std::move(callback));
+}
+
+void PlayerWidget::showEvent(QShowEvent *event) {
+    {
+        std::lock_guard lock(mImpl->mtx);
+        mImpl->visible = true;
+        // 隐藏期间的帧没有经过检测
+        mImpl->changeDetector.reset();
+        mImpl->renderLocked();
+    }
+    mImpl->repaint->start();
+    QWidget::showEvent(event);
+    emit visibilityChanged(true);
+}
+
+void PlayerWidget::hideEvent(QHideEvent *event) {
+    mImpl->visible = false;
+    mImpl->repaint->stop();
+    QWidget::hideEvent(event);
+    emit visibilityChanged(false);
+}
+
+void PlayerWidget::wheelEvent(QWheelEvent *event) {
+    {
+        std::lock_guard lock(mImpl->mtx);
+        const double factor = event->angleDelta().y() > 0
+                                  ? ViewZoom::kWheelStep
+                                  : 1.0 / ViewZoom::kWheelStep;
+        mImpl->zoom.zoomAt(
+            ViewZoom::toSource(mImpl->toImage(event->position()),
+                               mImpl->rotation), factor);
+        mImpl->renderLocked();
+    }
+    event->accept();
+    update();
+}
+
+void PlayerWidget::mousePressEvent(QMouseEvent *event) {
+    mImpl->dragPos = event->pos();
+    QWidget::mousePressEvent(event);
+}
+
+void PlayerWidget::mouseMoveEvent(QMouseEvent *event) {
+    if (!(event->buttons() & Qt::LeftButton)) {
+        return;
+    }
+    {
+        std::lock_guard lock(mImpl->mtx);
+        if (!mImpl->zoom.active()) {
+            return;
+        }
+        const QPointF delta = mImpl->toImage(event->pos()) -
+                              mImpl->toImage(mImpl->dragPos);
+        mImpl->dragPos = event->pos();
+        mImpl->zoom.panBy(ViewZoom::toSourceDelta(delta, mImpl->rotation));
+        mImpl->renderLocked();
+    }
+    update();
+}
 
+void PlayerWidget::mouseDoubleClickEvent(QMouseEvent *event) {
+    {
+        std::lock_guard lock(mImpl->mtx);
+        mImpl->zoom.reset();
+        mImpl->renderLocked();
+    }
+    update();
+    QWidget::mouseDoubleClickEvent(event);
+}
 
 QSize PlayerWidget::sizeHint() const {
     if (mImpl->g_width > 0 && mImpl->g_height > 0) {
@@ -1,23 +1,64 @@
 #pragma once
 
 #include "CommonDef.h"
+#include "VideoRenderer.h"
 #include <QWidget>
 
 
-class PlayerWidget final : public QWidget {
+class PlayerWidget final : public QWidget, public VideoRenderer {
     Q_OBJECT
 
 public:
     explicit PlayerWidget(QWidget *parent = nullptr);
+    ~PlayerWidget() override;
 
     void paintEvent(QPaintEvent *event) override;
 
+    void resizeEvent(QResizeEvent *event) override;
+
+    // 滚轮变焦，左键拖动平移，双击复位
+    void wheelEvent(QWheelEvent *event) override;
+
+    void mousePressEvent(QMouseEvent *event) override;
+
+    void mouseMoveEvent(QMouseEvent *event) override;
+
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+    void showEvent(QShowEvent *event) override;
+
+    void hideEvent(QHideEvent *event) override;
+
 
     QSize sizeHint() const override;
+
+    QWidget *widget() override {
+        return this;
+    }
+
+    // VideoSink
+    void onVideoFrame(const FrameRef &frame) override {
+        onFrameChanged(frame.get());
+    }
+
+    void onVideoRotation(int rotation) override {
+        setRotation(rotation);
+    }
+
+    Kind kind() const override {
+        return Kind::Cpu;
+    }
+
+    QMetaObject::Connection connectVisibility(
+        QObject *receiver, std::function<void(bool)> callback) override;
 Q_SIGNALS:
     void sizeChanged(QSize);
+    // 显示/隐藏（包括窗口最小化）时发出
+    void visibilityChanged(bool visible);
 public Q_SLOTS:
-    void onFrameChanged(VideoFrame);
+    void onFrameChanged(VideoFrame frame);
+    // 顺时针 0/90/180/270，与缩放/转换合并为一次处理
+    void setRotation(int rotation);
 
 private:
     struct Impl;
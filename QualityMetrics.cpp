@@ -0,0 +1,382 @@
+#include "QualityMetrics.h"
+#include "StripePool.h"
+#include "ThreadPolicy.h"
+#include <libyuv/compare.h>
+#include <libyuv/planar_functions.h>
+#include <libyuv/scale.h>
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/fmt.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <thread>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#define PREFIX  "[QualityMetrics]"
+
+namespace {
+// 约一小时 60fps 的结果
+constexpr size_t kMaxHistory = 216000;
+
+struct Plane {
+    const uint8_t *data = nullptr;
+    int stride = 0;
+    int width = 0;
+    int height = 0;
+};
+
+// 色度的水平/垂直下采样位数，不支持的格式返回 false
+bool chromaShift(int format, int &shiftW, int &shiftH) {
+    switch (format) {
+        case AV_PIX_FMT_YUV420P:
+        case AV_PIX_FMT_YUVJ420P:
+        case AV_PIX_FMT_NV12:
+            shiftW = 1;
+            shiftH = 1;
+            return true;
+        case AV_PIX_FMT_YUV422P:
+        case AV_PIX_FMT_YUVJ422P:
+            shiftW = 1;
+            shiftH = 0;
+            return true;
+        case AV_PIX_FMT_YUV444P:
+        case AV_PIX_FMT_YUVJ444P:
+            shiftW = 0;
+            shiftH = 0;
+            return true;
+        default:
+            return false;
+    }
+}
+
+int defaultThreadCount() {
+    int n = static_cast<int>(std::thread::hardware_concurrency());
+    return std::clamp(n, 1, 8);
+}
+
+// CalcFrameSsim 以步长 4 遍历 8x8 窗口，结果是各窗口 SSIM 的均值。
+// 按窗口行切成条带分别计算，再按窗口行数加权，与整帧结果相同
+double bandedSsim(StripePool &pool, const Plane &x, const Plane &y) {
+    const int windowRows = x.height > 8 ? (x.height - 8 + 3) / 4 : 0;
+    const int bands = std::min(pool.size(), windowRows);
+    if (bands < 2) {
+        return libyuv::CalcFrameSsim(x.data, x.stride, y.data, y.stride,
+                                     x.width, x.height);
+    }
+    std::vector<double> partial(bands);
+    pool.run(bands, [&](int i) {
+        const int r0 = windowRows * i / bands;
+        const int r1 = windowRows * (i + 1) / bands;
+        const int top = r0 * 4;
+        partial[i] = libyuv::CalcFrameSsim(
+            x.data + static_cast<ptrdiff_t>(top) * x.stride, x.stride,
+            y.data + static_cast<ptrdiff_t>(top) * y.stride, y.stride,
+            x.width, (r1 - r0) * 4 + 8) * (r1 - r0);
+    });
+    double total = 0.0;
+    for (double value: partial) {
+        total += value;
+    }
+    return total / windowRows;
+}
+}
+
+struct QualityMetrics::Scratch {
+    // 0..1 为 A 的 NV12 拆出的 U/V，2..3 为 B 的，4..6 为缩放后的 B 平面
+    std::array<std::vector<uint8_t>, 7> buffers;
+
+    uint8_t *buffer(int index, int width, int height) {
+        auto &buf = buffers[index];
+        buf.resize(static_cast<size_t>(width) * height);
+        return buf.data();
+    }
+
+    // 取 frame 的三个平面，NV12 的 UV 拆到 buffers[base..base+1]
+    bool planes(const AVFrame *frame, std::array<Plane, 3> &out, int base) {
+        int shiftW = 0;
+        int shiftH = 0;
+        if (!chromaShift(frame->format, shiftW, shiftH)) {
+            return false;
+        }
+        const int cw = (frame->width + (1 << shiftW) - 1) >> shiftW;
+        const int ch = (frame->height + (1 << shiftH) - 1) >> shiftH;
+        out[0] = {frame->data[0], frame->linesize[0], frame->width,
+                  frame->height};
+        if (frame->format != AV_PIX_FMT_NV12) {
+            out[1] = {frame->data[1], frame->linesize[1], cw, ch};
+            out[2] = {frame->data[2], frame->linesize[2], cw, ch};
+            return true;
+        }
+        uint8_t *u = buffer(base, cw, ch);
+        uint8_t *v = buffer(base + 1, cw, ch);
+        libyuv::SplitUVPlane(frame->data[1], frame->linesize[1], u, cw, v, cw,
+                             cw, ch);
+        out[1] = {u, cw, cw, ch};
+        out[2] = {v, cw, cw, ch};
+        return true;
+    }
+};
+
+QualityMetrics::QualityMetrics(size_t maxQueued, int threads)
+    : mMaxQueued(std::max<size_t>(maxQueued, 1)),
+      mBands(std::make_unique<StripePool>(
+          threads > 0 ? threads : defaultThreadCount())),
+      mThread([this](std::stop_token token) { worker(token); }) {}
+
+QualityMetrics::~QualityMetrics() {
+    mThread.request_stop();
+    mCv.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+    for (Job &job: mJobs) {
+        av_frame_free(&job.a);
+        av_frame_free(&job.b);
+    }
+}
+
+bool QualityMetrics::isSupported(int format) {
+    int shiftW = 0;
+    int shiftH = 0;
+    return chromaShift(format, shiftW, shiftH);
+}
+
+bool QualityMetrics::submit(const AVFrame *a, const AVFrame *b,
+                            double ptsMs) {
+    if (!a || !b || !isSupported(a->format) || !isSupported(b->format)) {
+        std::lock_guard lock(mMtx);
+        ++mStats.unsupported;
+        return false;
+    }
+    AVFrame *refA = av_frame_clone(a);
+    AVFrame *refB = av_frame_clone(b);
+    if (!refA || !refB) {
+        av_frame_free(&refA);
+        av_frame_free(&refB);
+        return false;
+    }
+    Job dropped{};
+    {
+        std::lock_guard lock(mMtx);
+        if (mJobs.size() >= mMaxQueued) {
+            dropped = mJobs.front();
+            mJobs.pop_front();
+            ++mStats.skipped;
+        }
+        mJobs.push_back({refA, refB, ptsMs});
+    }
+    mCv.notify_one();
+    av_frame_free(&dropped.a);
+    av_frame_free(&dropped.b);
+    return true;
+}
+
+std::vector<QualityMetrics::Sample> QualityMetrics::history(
+    size_t last) const {
+    std::lock_guard lock(mMtx);
+    const size_t count = last == 0
+                             ? mHistory.size()
+                             : std::min(last, mHistory.size());
+    return {mHistory.end() - static_cast<std::ptrdiff_t>(count),
+            mHistory.end()};
+}
+
+QualityMetrics::Stats QualityMetrics::stats() const {
+    std::lock_guard lock(mMtx);
+    return mStats;
+}
+
+void QualityMetrics::reset() {
+    std::lock_guard lock(mMtx);
+    mHistory.clear();
+    mStats = {};
+    mPsnrSum = 0.0;
+    mSsimSum = 0.0;
+    mComputeSum = 0.0;
+}
+
+bool QualityMetrics::writeCsv(const std::string &path) const {
+    const std::vector<Sample> samples = history();
+    FILE *file = std::fopen(path.c_str(), "w");
+    if (!file) {
+        spdlog::error(PREFIX "open failed:{}", path);
+        return false;
+    }
+    std::fputs("pts_ms,psnr_y,psnr_u,psnr_v,psnr,"
+               "ssim_y,ssim_u,ssim_v,ssim,compute_ms\n", file);
+    for (const Sample &s: samples) {
+        std::fprintf(file, "%.3f,%.4f,%.4f,%.4f,%.4f,"
+                     "%.6f,%.6f,%.6f,%.6f,%.3f\n", s.ptsMs, s.psnrY, s.psnrU,
+                     s.psnrV, s.psnr, s.ssimY, s.ssimU, s.ssimV, s.ssim,
+                     s.computeMs);
+    }
+    const bool ok = std::fclose(file) == 0;
+    spdlog::info(PREFIX "wrote {} samples to {}", samples.size(), path);
+    return ok;
+}
+
+std::string QualityMetrics::report() const {
+    const Stats s = stats();
+    const double fps = s.avgComputeMs > 0 ? 1000.0 / s.avgComputeMs : 0.0;
+    return fmt::format("computed={} skipped={} unsupported={} "
+                       "psnr avg={:.2f}dB ssim avg={:.4f} min={:.4f} "
+                       "compute avg={:.2f}ms max={:.2f}ms ({:.0f} fps)",
+                       s.computed, s.skipped, s.unsupported, s.avgPsnr,
+                       s.avgSsim, s.minSsim, s.avgComputeMs, s.maxComputeMs,
+                       fps);
+}
+
+void QualityMetrics::worker(std::stop_token token) {
+    setThreadName("mp-metrics");
+    Scratch scratch;
+    while (true) {
+        Job job{};
+        {
+            std::unique_lock lock(mMtx);
+            if (!mCv.wait(lock, token, [this] { return !mJobs.empty(); })) {
+                return;
+            }
+            job = mJobs.front();
+            mJobs.pop_front();
+        }
+        Sample sample{};
+        sample.ptsMs = job.ptsMs;
+        const bool ok = compute(job.a, job.b, scratch, *mBands, sample);
+        av_frame_free(&job.a);
+        av_frame_free(&job.b);
+
+        std::lock_guard lock(mMtx);
+        if (!ok) {
+            ++mStats.unsupported;
+            continue;
+        }
+        ++mStats.computed;
+        mPsnrSum += sample.psnr;
+        mSsimSum += sample.ssim;
+        mComputeSum += sample.computeMs;
+        mStats.avgPsnr = mPsnrSum / static_cast<double>(mStats.computed);
+        mStats.avgSsim = mSsimSum / static_cast<double>(mStats.computed);
+        mStats.avgComputeMs = mComputeSum /
+                              static_cast<double>(mStats.computed);
+        mStats.maxComputeMs = std::max(mStats.maxComputeMs,
+                                       sample.computeMs);
+        mStats.minSsim = mStats.computed == 1
+                             ? sample.ssim
+                             : std::min(mStats.minSsim, sample.ssim);
+        mHistory.push_back(sample);
+        if (mHistory.size() > kMaxHistory) {
+            mHistory.pop_front();
+        }
+    }
+}
+
+bool QualityMetrics::compute(const AVFrame *a, const AVFrame *b,
+                             Scratch &scratch, StripePool &bands,
+                             Sample &sample) {
+    using namespace std::chrono;
+    const auto begin = steady_clock::now();
+    std::array<Plane, 3> pa;
+    std::array<Plane, 3> pb;
+    if (!scratch.planes(a, pa, 0) || !scratch.planes(b, pb, 2)) {
+        return false;
+    }
+    for (int p = 0; p < 3; ++p) {
+        if (pb[p].width == pa[p].width && pb[p].height == pa[p].height) {
+            continue;
+        }
+        uint8_t *scaled = scratch.buffer(4 + p, pa[p].width, pa[p].height);
+        libyuv::ScalePlane(pb[p].data, pb[p].stride, pb[p].width,
+                           pb[p].height, scaled, pa[p].width, pa[p].width,
+                           pa[p].height, libyuv::kFilterBilinear);
+        pb[p] = {scaled, pa[p].width, pa[p].width, pa[p].height};
+    }
+
+    std::array<uint64_t, 3> sse{};
+    std::array<double, 3> psnr{};
+    std::array<double, 3> ssim{};
+    uint64_t samples = 0;
+    for (int p = 0; p < 3; ++p) {
+        const Plane &x = pa[p];
+        const Plane &y = pb[p];
+        const uint64_t count = static_cast<uint64_t>(x.width) * x.height;
+        sse[p] = libyuv::ComputeSumSquareErrorPlane(
+            x.data, x.stride, y.data, y.stride, x.width, x.height);
+        psnr[p] = libyuv::SumSquareErrorToPsnr(sse[p], count);
+        ssim[p] = bandedSsim(bands, x, y);
+        samples += count;
+    }
+    sample.psnrY = psnr[0];
+    sample.psnrU = psnr[1];
+    sample.psnrV = psnr[2];
+    sample.psnr = libyuv::SumSquareErrorToPsnr(sse[0] + sse[1] + sse[2],
+                                               samples);
+    sample.ssimY = ssim[0];
+    sample.ssimU = ssim[1];
+    sample.ssimV = ssim[2];
+    sample.ssim = ssim[0] * 0.8 + 0.1 * (ssim[1] + ssim[2]);
+    sample.computeMs = duration<double, std::milli>(
+        steady_clock::now() - begin).count();
+    return true;
+}
+
+void QualityMetrics::benchmark(int width, int height, int maxThreads,
+                               double targetFps) {
+    if (maxThreads <= 0) {
+        maxThreads = defaultThreadCount();
+    }
+    AVFrame *a = av_frame_alloc();
+    AVFrame *b = av_frame_alloc();
+    for (AVFrame *frame: {a, b}) {
+        frame->format = AV_PIX_FMT_YUV420P;
+        frame->width = width;
+        frame->height = height;
+        if (av_frame_get_buffer(frame, 32) < 0) {
+            spdlog::error(PREFIX "benchmark alloc failed");
+            av_frame_free(&a);
+            av_frame_free(&b);
+            return;
+        }
+    }
+    // B = A 加轻微噪声，接近编码对比的取值范围
+    std::mt19937 rng{1};
+    std::uniform_int_distribution<int> pixel(16, 235);
+    std::uniform_int_distribution<int> noise(-3, 3);
+    for (int p = 0; p < 3; ++p) {
+        const int rows = p == 0 ? height : (height + 1) / 2;
+        for (int i = 0; i < a->linesize[p] * rows; ++i) {
+            const int value = pixel(rng);
+            a->data[p][i] = static_cast<uint8_t>(value);
+            b->data[p][i] = static_cast<uint8_t>(
+                std::clamp(value + noise(rng), 0, 255));
+        }
+    }
+
+    constexpr int kIterations = 20;
+    Scratch scratch;
+    Sample sample{};
+    for (int threads = 1; threads <= maxThreads; ++threads) {
+        StripePool bands{threads};
+        compute(a, b, scratch, bands, sample); // 预热
+        double totalMs = 0.0;
+        double maxMs = 0.0;
+        for (int i = 0; i < kIterations; ++i) {
+            compute(a, b, scratch, bands, sample);
+            totalMs += sample.computeMs;
+            maxMs = std::max(maxMs, sample.computeMs);
+        }
+        const double avgMs = totalMs / kIterations;
+        const double fps = avgMs > 0 ? 1000.0 / avgMs : 0.0;
+        spdlog::info(PREFIX "{}x{} threads={} psnr={:.2f}dB ssim={:.4f} "
+                     "avg={:.2f}ms max={:.2f}ms -> {:.0f} fps ({} {:.0f} fps)",
+                     width, height, threads, sample.psnr, sample.ssim, avgMs,
+                     maxMs, fps, fps >= targetFps ? "keeps up with" : "below",
+                     targetFps);
+    }
+    av_frame_free(&a);
+    av_frame_free(&b);
+}
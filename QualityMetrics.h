@@ -0,0 +1,105 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct AVFrame;
+class StripePool;
+
+// 两路配对帧的客观质量：逐帧 Y/U/V 的 PSNR 和 SSIM（libyuv compare 内核）。
+// 在独立线程计算，submit 只取帧的引用；来不及算时丢弃最旧的待算帧并计数，
+// 不会拖慢播放。SSIM 是主要开销，按窗口行切成条带并行计算。
+// B 与 A 尺寸不同时先把 B 缩放到 A 的尺寸再比较
+class QualityMetrics {
+public:
+    struct Sample {
+        double ptsMs = 0.0;
+        double psnrY = 0.0;
+        double psnrU = 0.0;
+        double psnrV = 0.0;
+        // 三个平面合计 SSE 算出的 PSNR
+        double psnr = 0.0;
+        double ssimY = 0.0;
+        double ssimU = 0.0;
+        double ssimV = 0.0;
+        // 0.8 * Y + 0.1 * (U + V)，与 libyuv I420Ssim 相同
+        double ssim = 0.0;
+        double computeMs = 0.0;
+    };
+
+    struct Stats {
+        uint64_t computed = 0;
+        // 队列满时丢弃、没有计算的帧
+        uint64_t skipped = 0;
+        // 格式不支持的帧
+        uint64_t unsupported = 0;
+        double avgComputeMs = 0.0;
+        double maxComputeMs = 0.0;
+        double avgPsnr = 0.0;
+        double avgSsim = 0.0;
+        double minSsim = 0.0;
+    };
+
+    // maxQueued 为等待计算的最大帧对数；threads 为 SSIM 条带线程数，
+    // <= 0 时使用 hardware_concurrency，最多 8 个
+    explicit QualityMetrics(size_t maxQueued = 4, int threads = 0);
+    ~QualityMetrics();
+
+    QualityMetrics(const QualityMetrics &) = delete;
+    QualityMetrics &operator=(const QualityMetrics &) = delete;
+
+    // 8 位平面 YUV（420/422/444，含 J 系列）和 NV12
+    static bool isSupported(int format);
+
+    // 线程安全，不阻塞。ptsMs 为 A 帧的时间戳
+    bool submit(const AVFrame *a, const AVFrame *b, double ptsMs);
+
+    // 最近 last 个结果（0 为全部），按计算顺序
+    std::vector<Sample> history(size_t last = 0) const;
+
+    Stats stats() const;
+
+    // 清空历史和统计（seek 后重新统计时用）
+    void reset();
+
+    // 导出全部历史，失败返回 false
+    bool writeCsv(const std::string &path) const;
+
+    std::string report() const;
+
+    // 合成 width x height 的 420 帧对，以 1..maxThreads 线程分别测量每帧
+    // 计算耗时，以及吞吐是否跟得上 targetFps，结果输出到日志
+    static void benchmark(int width, int height, int maxThreads = 0,
+                          double targetFps = 60.0);
+
+private:
+    struct Job {
+        AVFrame *a;
+        AVFrame *b;
+        double ptsMs;
+    };
+    struct Scratch;
+
+    void worker(std::stop_token token);
+
+    static bool compute(const AVFrame *a, const AVFrame *b, Scratch &scratch,
+                        StripePool &bands, Sample &sample);
+
+    const size_t mMaxQueued;
+    std::unique_ptr<StripePool> mBands;
+    mutable std::mutex mMtx;
+    std::condition_variable_any mCv;
+    std::deque<Job> mJobs;
+    std::deque<Sample> mHistory;
+    Stats mStats;
+    double mPsnrSum = 0.0;
+    double mSsimSum = 0.0;
+    double mComputeSum = 0.0;
+    std::jthread mThread;
+};
@@ -0,0 +1,136 @@
+#include "RendererProbe.h"
+#include "YuvConverter.h"
+#include <QImage>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+#include <QPainter>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <spdlog/spdlog.h>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#define PREFIX  "[RendererProbe]"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point begin) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - begin).
+        count();
+}
+
+// 灰阶渐变的 I420 测试帧
+AVFrame *makeFrame(QSize size) {
+    AVFrame *frame = av_frame_alloc();
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = size.width() & ~1;
+    frame->height = size.height() & ~1;
+    if (av_frame_get_buffer(frame, 32) < 0) {
+        av_frame_free(&frame);
+        return nullptr;
+    }
+    for (int y = 0; y < frame->height; ++y) {
+        std::memset(frame->data[0] + y * frame->linesize[0],
+                    16 + y * 219 / frame->height, frame->width);
+    }
+    for (int p = 1; p < 3; ++p) {
+        for (int y = 0; y < frame->height / 2; ++y) {
+            std::memset(frame->data[p] + y * frame->linesize[p], 128,
+                        frame->width / 2);
+        }
+    }
+    return frame;
+}
+
+// 先跑一轮预热，再取中位数
+template<typename Fn>
+double median(int iterations, Fn &&fn) {
+    fn();
+    std::vector<double> samples;
+    for (int i = 0; i < iterations; ++i) {
+        const auto begin = Clock::now();
+        fn();
+        samples.push_back(elapsedMs(begin));
+    }
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2,
+                     samples.end());
+    return samples[samples.size() / 2];
+}
+
+double probeCpu(const AVFrame *frame, QSize view, int iterations) {
+    const QSize dst = QSize(frame->width, frame->height).scaled(
+        view, Qt::KeepAspectRatio);
+    QImage image(dst, QImage::Format_ARGB32);
+    QImage target(view, QImage::Format_ARGB32_Premultiplied);
+    return median(iterations, [&] {
+        YuvConverter::instance().convertScaled(
+            frame, image.bits(), static_cast<int>(image.bytesPerLine()),
+            dst.width(), dst.height());
+        QPainter painter(&target);
+        painter.drawImage(QRect({0, 0}, dst), image);
+    });
+}
+
+// GL 不可用时返回负数
+double probeGl(const AVFrame *frame, int iterations) {
+    QOpenGLContext context;
+    if (!context.create()) {
+        return -1.0;
+    }
+    QOffscreenSurface surface;
+    surface.setFormat(context.format());
+    surface.create();
+    if (!surface.isValid() || !context.makeCurrent(&surface)) {
+        return -1.0;
+    }
+    QOpenGLFunctions *gl = context.functions();
+    const int stride = frame->width * 4;
+    std::vector<uint8_t> rgba(static_cast<size_t>(stride) * frame->height);
+    GLuint texture = 0;
+    gl->glGenTextures(1, &texture);
+    gl->glBindTexture(GL_TEXTURE_2D, texture);
+    const double ms = median(iterations, [&] {
+        YuvConverter::instance().convert(frame, rgba.data(), stride);
+        gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, frame->width,
+                         frame->height, 0, GL_BGRA, GL_UNSIGNED_BYTE,
+                         rgba.data());
+        gl->glFinish();
+    });
+    gl->glDeleteTextures(1, &texture);
+    context.doneCurrent();
+    return ms;
+}
+}
+
+RendererProbe::Result RendererProbe::run(QSize video, QSize view,
+                                         int iterations) {
+    Result result;
+    AVFrame *frame = makeFrame(video);
+    if (!frame || view.isEmpty()) {
+        av_frame_free(&frame);
+        return result;
+    }
+    iterations = std::max(1, iterations);
+    result.cpuMs = probeCpu(frame, view, iterations);
+    const double glMs = probeGl(frame, iterations);
+    result.glAvailable = glMs >= 0.0;
+    result.glMs = std::max(glMs, 0.0);
+    result.best = result.glAvailable && result.glMs < result.cpuMs
+                      ? VideoRenderer::Kind::OpenGL
+                      : VideoRenderer::Kind::Cpu;
+    av_frame_free(&frame);
+    spdlog::info(PREFIX "{}x{} -> {}x{} cpu:{:.2f}ms gl:{} pick:{}",
+                 video.width(), video.height(), view.width(), view.height(),
+                 result.cpuMs,
+                 result.glAvailable
+                     ? fmt::format("{:.2f}ms", result.glMs)
+                     : std::string("unavailable"),
+                 VideoRenderer::name(result.best));
+    return result;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include "VideoRenderer.h"
+#include <QSize>
+
+// 启动时的小型基准：在当前机器上分别测量两种后端处理一帧的耗时，
+// 选出更快的一个。
+//   cpu: 条带转换并缩放到视图尺寸 + QPainter 绘制
+//   gl : 原尺寸转换 + 纹理上传（离屏上下文，glFinish 计时）
+class RendererProbe {
+public:
+    struct Result {
+        double cpuMs = 0.0;
+        double glMs = 0.0;
+        bool glAvailable = false;
+        VideoRenderer::Kind best = VideoRenderer::Kind::Cpu;
+    };
+
+    // video 为片源分辨率，view 为显示区域尺寸。需在 GUI 线程调用
+    static Result run(QSize video, QSize view, int iterations = 5);
+};
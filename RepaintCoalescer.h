@@ -0,0 +1,95 @@
+#pragma once
+
+#include <QGuiApplication>
+#include <QMetaObject>
+#include <QOpenGLWidget>
+#include <QScreen>
+#include <QTimer>
+#include <QWidget>
+#include <QWindow>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+// 把任意线程发来的重绘请求合并到显示刷新节拍：上一次重绘完成之前
+// 不再 update()，期间的请求合并为下一次。GL 控件以 frameSwapped（交换
+// 阻塞到 vsync）为完成，普通控件以一个刷新周期为完成；没有请求时不运行。
+// 解码线程只调用 markDirty()，不直接碰 QWidget::update()。
+class RepaintCoalescer {
+public:
+    explicit RepaintCoalescer(QWidget *widget): mWidget(widget),
+                                                mTimer(new QTimer(widget)) {
+        mTimer->setSingleShot(true);
+        mTimer->setTimerType(Qt::PreciseTimer);
+        QObject::connect(mTimer, &QTimer::timeout, widget, [this] {
+            frameDone();
+        });
+        if (auto *gl = qobject_cast<QOpenGLWidget *>(widget)) {
+            mGl = true;
+            QObject::connect(gl, &QOpenGLWidget::frameSwapped, widget,
+                             [this] {
+                                 frameDone();
+                             });
+        }
+    }
+
+    // 控件显示时调用，按所在屏幕的刷新率定普通控件的周期
+    void start() {
+        QScreen *screen = mWidget->window()->windowHandle()
+                              ? mWidget->window()->windowHandle()->screen()
+                              : QGuiApplication::primaryScreen();
+        const qreal rate = screen ? screen->refreshRate() : 60.0;
+        mPeriodMs = static_cast<int>(std::lround(1000.0 / std::max<qreal>(
+            rate, 1.0)));
+        mRunning = true;
+        mInFlight = false;
+        kick();
+    }
+
+    // 隐藏时调用，之后的请求留到下次 start
+    void stop() {
+        mRunning = false;
+        mInFlight = false;
+        mTimer->stop();
+    }
+
+    // 线程安全
+    void markDirty() {
+        mDirty = true;
+        if (!mPosted.exchange(true)) {
+            QMetaObject::invokeMethod(mWidget, [this] {
+                mPosted = false;
+                kick();
+            }, Qt::QueuedConnection);
+        }
+    }
+
+private:
+    // 隐藏、最小化时 GL 控件不会交换，超时后按完成处理
+    static constexpr int kSwapTimeoutMs = 100;
+
+    // 以下只在 GUI 线程调用
+    void kick() {
+        if (!mRunning || mInFlight || !mDirty.exchange(false)) {
+            return;
+        }
+        mInFlight = true;
+        mWidget->update();
+        mTimer->start(mGl ? kSwapTimeoutMs : mPeriodMs);
+    }
+
+    void frameDone() {
+        mTimer->stop();
+        mInFlight = false;
+        kick();
+    }
+
+    QWidget *mWidget;
+    QTimer *mTimer;
+    bool mGl = false;
+    bool mRunning = false;
+    bool mInFlight = false;
+    int mPeriodMs = 16;
+    std::atomic_bool mDirty{false};
+    std::atomic_bool mPosted{false};
+};
@@ -0,0 +1,99 @@
+#include "ScreenshotWriter.h"
+#include <QFileInfo>
+#include <QImage>
+#include <spdlog/spdlog.h>
+#include "ThreadPolicy.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#define PREFIX  "[ScreenshotWriter]"
+
+namespace {
+constexpr int kJpegQuality = 95;
+constexpr int kConvertThreads = 2;
+}
+
+ScreenshotWriter::ScreenshotWriter(Callback callback)
+    : mCallback(std::move(callback)), mConverter(kConvertThreads),
+      mThread([this](std::stop_token token) { worker(token); }) {}
+
+ScreenshotWriter::~ScreenshotWriter() {
+    mThread.request_stop();
+    mCv.notify_all();
+    if (mThread.joinable()) {
+        mThread.join();
+    }
+    for (Job &job: mJobs) {
+        av_frame_free(&job.frame);
+    }
+}
+
+bool ScreenshotWriter::enqueue(const AVFrame *frame, const QString &path,
+                               int rotation) {
+    if (!frame || !YuvConverter::isSupported(frame->format)) {
+        spdlog::error(PREFIX "unsupported frame");
+        return false;
+    }
+    AVFrame *ref = av_frame_clone(frame);
+    if (!ref) {
+        return false;
+    }
+    {
+        std::lock_guard lock(mMtx);
+        mJobs.push_back({ref, path, rotation});
+    }
+    mCv.notify_one();
+    return true;
+}
+
+int ScreenshotWriter::pending() const {
+    std::lock_guard lock(mMtx);
+    return static_cast<int>(mJobs.size());
+}
+
+void ScreenshotWriter::worker(std::stop_token token) {
+    setThreadName("mp-screenshot");
+    while (true) {
+        Job job{};
+        {
+            std::unique_lock lock(mMtx);
+            if (!mCv.wait(lock, token, [this] { return !mJobs.empty(); })) {
+                return;
+            }
+            job = std::move(mJobs.front());
+            mJobs.pop_front();
+        }
+        const bool ok = write(job);
+        av_frame_free(&job.frame);
+        if (mCallback) {
+            mCallback(job.path, ok);
+        }
+    }
+}
+
+bool ScreenshotWriter::write(const Job &job) {
+    const AVFrame *frame = job.frame;
+    const bool swap = job.rotation == 90 || job.rotation == 270;
+    const int width = swap ? frame->height : frame->width;
+    const int height = swap ? frame->width : frame->height;
+    QImage image(width, height, QImage::Format_ARGB32);
+    if (image.isNull()) {
+        return false;
+    }
+    mConverter.convertScaled(frame, image.bits(),
+                             static_cast<int>(image.bytesPerLine()), width,
+                             height, job.rotation);
+
+    const QString suffix = QFileInfo(job.path).suffix().toLower();
+    const bool jpeg = suffix == "jpg" || suffix == "jpeg";
+    if (!image.save(job.path, jpeg ? "JPEG" : "PNG",
+                    jpeg ? kJpegQuality : -1)) {
+        spdlog::error(PREFIX "save failed:{}", job.path.toStdString());
+        return false;
+    }
+    spdlog::info(PREFIX "saved:{} {}x{}", job.path.toStdString(), width,
+                 height);
+    return true;
+}
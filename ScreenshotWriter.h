@@ -0,0 +1,51 @@
+#pragma once
+
+#include "YuvConverter.h"
+#include <QString>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+struct AVFrame;
+
+// 后台截图：持有解码帧的引用，在独立线程按原始分辨率转换并编码 PNG/JPEG，
+// 不占用 GUI 线程，也不与播放共用 YuvConverter 的线程池。
+class ScreenshotWriter {
+public:
+    // 写入完成回调，在工作线程调用
+    using Callback = std::function<void(const QString &path, bool ok)>;
+
+    explicit ScreenshotWriter(Callback callback);
+    ~ScreenshotWriter();
+
+    ScreenshotWriter(const ScreenshotWriter &) = delete;
+    ScreenshotWriter &operator=(const ScreenshotWriter &) = delete;
+
+    // 取得 frame 的引用后立即返回。格式按 path 后缀（png/jpg/jpeg）决定，
+    // rotation 为顺时针 0/90/180/270
+    bool enqueue(const AVFrame *frame, const QString &path, int rotation = 0);
+
+    // 队列中等待编码的张数
+    int pending() const;
+
+private:
+    struct Job {
+        AVFrame *frame;
+        QString path;
+        int rotation;
+    };
+
+    void worker(std::stop_token token);
+
+    bool write(const Job &job);
+
+    Callback mCallback;
+    // 截图专用转换器，避免和渲染争用共享线程池
+    YuvConverter mConverter;
+    mutable std::mutex mMtx;
+    std::condition_variable_any mCv;
+    std::deque<Job> mJobs;
+    std::jthread mThread;
+};
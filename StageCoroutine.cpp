@@ -0,0 +1,331 @@
+#include "StageCoroutine.h"
+#include <spdlog/spdlog.h>
+#include <condition_variable>
+#include <latch>
+#include <sys/resource.h>
+
+#define PREFIX  "[StageCoroutine]"
+using namespace std::literals;
+
+struct StageCoroutine::Handle::State {
+    explicit State(StageCoroutine coroutine): coroutine(std::move(coroutine)) {}
+
+    StageCoroutine coroutine;
+    std::stop_source source;
+    // 请求停止时唤醒挂起的协程
+    std::optional<std::stop_callback<std::function<void()>>> onStop;
+    StagePool::Handle task;
+    std::atomic<uint64_t> resumes{0};
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool finished = false;
+
+    // 任务的一步：条件满足时恢复协程，返回协程挂起时要求的时间
+    StagePool::Clock::time_point step() {
+        CoroutineHandle handle = coroutine.mHandle;
+        promise_type &promise = handle.promise();
+        if (!promise.token.stop_requested()) {
+            // 提前唤醒（唤醒被记下后重排、休眠中收到唤醒）时继续等待
+            if (promise.waiting) {
+                return StagePool::kParked;
+            }
+            if (promise.next != StagePool::kParked &&
+                promise.next > StagePool::Clock::now()) {
+                return promise.next;
+            }
+        }
+        ++resumes;
+        handle.resume();
+        if (!handle.done()) {
+            return promise.next;
+        }
+        {
+            std::lock_guard lock(mtx);
+            finished = true;
+        }
+        cv.notify_all();
+        return StagePool::kFinished;
+    }
+};
+
+StageCoroutine::Handle::Handle() = default;
+
+StageCoroutine::Handle::Handle(Handle &&) noexcept = default;
+
+StageCoroutine::Handle::Handle(std::unique_ptr<State> state)
+    : mState(std::move(state)) {}
+
+StageCoroutine::Handle &StageCoroutine::Handle::operator=(
+    Handle &&other) noexcept {
+    if (this != &other) {
+        stop();
+        mState = std::move(other.mState);
+    }
+    return *this;
+}
+
+StageCoroutine::Handle::~Handle() {
+    stop();
+}
+
+void StageCoroutine::Handle::stop() {
+    if (!mState) {
+        return;
+    }
+    mState->source.request_stop();
+    {
+        std::unique_lock lock(mState->mtx);
+        mState->cv.wait(lock, [this] { return mState->finished; });
+    }
+    mState->task.stop();
+    mState->onStop.reset();
+    mState.reset();
+}
+
+uint64_t StageCoroutine::Handle::resumes() const {
+    return mState ? mState->resumes.load() : 0;
+}
+
+StageCoroutine::Handle StageCoroutine::spawn(StagePool &pool,
+                                             StagePool::Stage stage,
+                                             const Factory &factory) {
+    std::stop_source source;
+    auto state = std::make_unique<Handle::State>(factory(source.get_token()));
+    state->source = std::move(source);
+    promise_type &promise = state->coroutine.mHandle.promise();
+    promise.token = state->source.get_token();
+    // 先挂起提交，设置好 waker 再开始，协程第一次挂起时就能被唤醒
+    Handle::State *raw = state.get();
+    state->task = pool.submit(stage, [raw] { return raw->step(); }, false);
+    promise.waker = state->task.waker();
+    state->onStop.emplace(promise.token, [waker = promise.waker] {
+        waker.wake();
+    });
+    promise.waker.wake();
+    return Handle{std::move(state)};
+}
+
+namespace {
+constexpr size_t kBenchQueue = 8;
+constexpr auto kBenchRetry = 1ms;
+// 每项的处理耗时和消费间隔
+constexpr auto kProduceWork = 5us;
+constexpr auto kProcessWork = 50us;
+constexpr auto kConsumeInterval = 500us;
+
+void spin(std::chrono::nanoseconds duration) {
+    const auto end = StagePool::Clock::now() + duration;
+    while (StagePool::Clock::now() < end) {}
+}
+
+struct Usage {
+    uint64_t switches = 0;
+    uint64_t involuntary = 0;
+    double cpuMs = 0.0;
+
+    static Usage now() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        const auto ms = [](const timeval &tv) {
+            return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+        };
+        return {
+            static_cast<uint64_t>(usage.ru_nvcsw + usage.ru_nivcsw),
+            static_cast<uint64_t>(usage.ru_nivcsw),
+            ms(usage.ru_utime) + ms(usage.ru_stime)
+        };
+    }
+};
+
+// 轮询式的一段会话，与改造前的播放流水线相同：队列空/满时 kBenchRetry 后再试
+struct PollSession {
+    struct Queue {
+        std::mutex mtx;
+        std::deque<int> items;
+
+        bool push(int value) {
+            std::lock_guard lock(mtx);
+            if (items.size() >= kBenchQueue) {
+                return false;
+            }
+            items.push_back(value);
+            return true;
+        }
+
+        bool pop(int &value) {
+            std::lock_guard lock(mtx);
+            if (items.empty()) {
+                return false;
+            }
+            value = items.front();
+            items.pop_front();
+            return true;
+        }
+    };
+
+    Queue raw;
+    Queue processed;
+    int produced = 0;
+    std::optional<int> pending;
+    int processedCount = 0;
+    int consumed = 0;
+};
+
+StageCoroutine produce(std::stop_token token, StageChannel<int> &out,
+                       int items) {
+    for (int i = 0; i < items && !token.stop_requested(); ++i) {
+        spin(kProduceWork);
+        if (!co_await out.send(i)) {
+            co_return;
+        }
+    }
+}
+
+StageCoroutine process(std::stop_token token, StageChannel<int> &in,
+                       StageChannel<int> &out, int items) {
+    for (int i = 0; i < items && !token.stop_requested(); ++i) {
+        const std::optional<int> value = co_await in.receive();
+        if (!value) {
+            co_return;
+        }
+        spin(kProcessWork);
+        if (!co_await out.send(*value)) {
+            co_return;
+        }
+    }
+}
+
+StageCoroutine consume(std::stop_token token, StageChannel<int> &in,
+                       int items, StagePool::Clock::time_point start,
+                       std::latch &done) {
+    for (int i = 0; i < items && !token.stop_requested(); ++i) {
+        const std::optional<int> value = co_await in.receive();
+        if (!value || !co_await StageCoroutine::sleepUntil(
+                start + kConsumeInterval * *value)) {
+            co_return;
+        }
+    }
+    done.count_down();
+}
+}
+
+void StageCoroutine::benchmark(int sessions, int items) {
+    sessions = std::max(sessions, 1);
+    items = std::max(items, 1);
+    StagePool pool;
+    const auto report = [&](const char *name, StagePool::Clock::time_point
+                            begin, const Usage &before) {
+        const Usage after = Usage::now();
+        const double wallMs = std::chrono::duration<double, std::milli>(
+            StagePool::Clock::now() - begin).count();
+        uint64_t runs = 0;
+        for (const StagePool::StageStats &stage: pool.stats()) {
+            runs += stage.runs;
+        }
+        spdlog::info(PREFIX "{:<9} sessions={} items={} wall={:.0f}ms "
+                     "cpu={:.0f}ms steps={} context switches={} "
+                     "(involuntary {})", name, sessions, items, wallMs,
+                     after.cpuMs - before.cpuMs, runs,
+                     after.switches - before.switches,
+                     after.involuntary - before.involuntary);
+    };
+
+    {
+        std::vector<std::unique_ptr<PollSession>> all;
+        std::vector<StagePool::Handle> tasks;
+        std::latch done(sessions);
+        pool.clearStats();
+        const Usage before = Usage::now();
+        const auto start = StagePool::Clock::now();
+        for (int s = 0; s < sessions; ++s) {
+            all.push_back(std::make_unique<PollSession>());
+            PollSession *session = all.back().get();
+            tasks.push_back(pool.submit(StagePool::Stage::Read, [=] {
+                const auto now = StagePool::Clock::now();
+                if (session->produced == items) {
+                    return StagePool::kFinished;
+                }
+                if (!session->raw.push(session->produced)) {
+                    return now + kBenchRetry;
+                }
+                spin(kProduceWork);
+                ++session->produced;
+                return now;
+            }));
+            tasks.push_back(pool.submit(StagePool::Stage::Decode, [=] {
+                const auto now = StagePool::Clock::now();
+                if (!session->pending) {
+                    if (session->processedCount == items) {
+                        return StagePool::kFinished;
+                    }
+                    int value;
+                    if (!session->raw.pop(value)) {
+                        return now + kBenchRetry;
+                    }
+                    spin(kProcessWork);
+                    session->pending = value;
+                    ++session->processedCount;
+                }
+                if (!session->processed.push(*session->pending)) {
+                    return now + kBenchRetry;
+                }
+                session->pending.reset();
+                return now;
+            }));
+            tasks.push_back(pool.submit(StagePool::Stage::Present,
+                                        [=, &done] {
+                const auto now = StagePool::Clock::now();
+                std::unique_lock lock(session->processed.mtx);
+                if (session->processed.items.empty()) {
+                    return now + kBenchRetry;
+                }
+                const auto due = start + kConsumeInterval *
+                                 session->processed.items.front();
+                if (due > now) {
+                    return due;
+                }
+                session->processed.items.pop_front();
+                if (++session->consumed == items) {
+                    done.count_down();
+                    return StagePool::kFinished;
+                }
+                return now;
+            }));
+        }
+        done.wait();
+        report("polling", start, before);
+    }
+
+    {
+        std::vector<std::unique_ptr<StageChannel<int>>> channels;
+        std::vector<Handle> tasks;
+        std::latch done(sessions);
+        pool.clearStats();
+        const Usage before = Usage::now();
+        const auto start = StagePool::Clock::now();
+        for (int s = 0; s < sessions; ++s) {
+            channels.push_back(std::make_unique<StageChannel<int>>(
+                kBenchQueue));
+            StageChannel<int> &raw = *channels.back();
+            channels.push_back(std::make_unique<StageChannel<int>>(
+                kBenchQueue));
+            StageChannel<int> &processed = *channels.back();
+            tasks.push_back(spawn(pool, StagePool::Stage::Read,
+                                  [&](std::stop_token token) {
+                                      return produce(token, raw, items);
+                                  }));
+            tasks.push_back(spawn(pool, StagePool::Stage::Decode,
+                                  [&](std::stop_token token) {
+                                      return process(token, raw, processed,
+                                                     items);
+                                  }));
+            tasks.push_back(spawn(pool, StagePool::Stage::Present,
+                                  [&](std::stop_token token) {
+                                      return consume(token, processed, items,
+                                                     start, done);
+                                  }));
+        }
+        done.wait();
+        report("coroutine", start, before);
+    }
+}
@@ -0,0 +1,375 @@
+#pragma once
+
+#include "StagePool.h"
+#include <algorithm>
+#include <atomic>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stop_token>
+#include <utility>
+#include <vector>
+
+// 用 C++20 协程写流水线阶段，仍在 StagePool 上调度：协程从一个挂起点
+// 运行到下一个挂起点就是任务的一步。co_await 休眠时挂在定时堆上；
+// 在 StageChannel 上等数据或空位时任务挂起（kParked），由对端唤醒，不轮询。
+// 取消沿 std::stop_token 传播：请求停止后挂起在通道上的协程被唤醒，
+// 之后的 co_await 都立即返回 false/空，协程应随即 co_return
+class StageCoroutine {
+public:
+    struct promise_type {
+        StageCoroutine get_return_object() {
+            return StageCoroutine{
+                std::coroutine_handle<promise_type>::from_promise(*this)
+            };
+        }
+
+        std::suspend_always initial_suspend() noexcept {
+            return {};
+        }
+
+        std::suspend_always final_suspend() noexcept {
+            return {};
+        }
+
+        void return_void() {}
+
+        void unhandled_exception() {
+            std::terminate();
+        }
+
+        std::stop_token token;
+        StagePool::Waker waker;
+        // 挂起时希望的恢复时间，等通道时为 kParked
+        StagePool::Clock::time_point next{};
+        // 排在通道上等待，对端交付后清除
+        std::atomic_bool waiting = false;
+    };
+
+    using CoroutineHandle = std::coroutine_handle<promise_type>;
+
+    StageCoroutine(StageCoroutine &&other) noexcept
+        : mHandle(std::exchange(other.mHandle, {})) {}
+
+    StageCoroutine &operator=(StageCoroutine &&) = delete;
+
+    ~StageCoroutine() {
+        if (mHandle) {
+            mHandle.destroy();
+        }
+    }
+
+    // 运行中的协程阶段，析构或 stop() 时请求停止并等待协程返回。
+    // 协程在休眠时，最多等到这次休眠结束
+    class Handle {
+    public:
+        Handle();
+        Handle(Handle &&) noexcept;
+        Handle &operator=(Handle &&other) noexcept;
+        ~Handle();
+
+        void stop();
+
+        // 协程恢复执行的次数
+        uint64_t resumes() const;
+
+        explicit operator bool() const {
+            return static_cast<bool>(mState);
+        }
+
+    private:
+        friend class StageCoroutine;
+        struct State;
+        explicit Handle(std::unique_ptr<State> state);
+
+        std::unique_ptr<State> mState;
+    };
+
+    using Factory = std::function<StageCoroutine(std::stop_token)>;
+
+    // factory 用 Handle 的 stop_token 创建协程，在 pool 上按 stage 的优先级运行
+    static Handle spawn(StagePool &pool, StagePool::Stage stage,
+                        const Factory &factory);
+
+    // co_await 返回 false 表示已请求停止
+    class SleepAwaiter {
+    public:
+        explicit SleepAwaiter(StagePool::Clock::time_point due): mDue(due) {}
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        bool await_suspend(CoroutineHandle handle) noexcept {
+            mPromise = &handle.promise();
+            if (mPromise->token.stop_requested()) {
+                return false;
+            }
+            mPromise->next = mDue;
+            return true;
+        }
+
+        bool await_resume() const noexcept {
+            return !mPromise->token.stop_requested();
+        }
+
+    private:
+        StagePool::Clock::time_point mDue;
+        promise_type *mPromise{};
+    };
+
+    static SleepAwaiter sleepUntil(StagePool::Clock::time_point due) {
+        return SleepAwaiter{due};
+    }
+
+    static SleepAwaiter sleepFor(StagePool::Clock::duration duration) {
+        return SleepAwaiter{StagePool::Clock::now() + duration};
+    }
+
+    // 让出线程，重新排队
+    static SleepAwaiter yield() {
+        return SleepAwaiter{StagePool::Clock::now()};
+    }
+
+    // 同样的三段流水线（生产 → 处理 → 按时间戳消费，队列容量 8）分别用
+    // 轮询式 step（队列空/满时 1ms 后重试）和协程 + 通道运行，
+    // 输出耗时、CPU 时间、任务步数和进程的上下文切换次数
+    static void benchmark(int sessions = 8, int items = 1000);
+
+private:
+    explicit StageCoroutine(CoroutineHandle handle): mHandle(handle) {}
+
+    CoroutineHandle mHandle;
+};
+
+// 有界通道：满时 send 挂起发送方，空时 receive 挂起接收方，对端取放后
+// 唤醒对方，不轮询。多生产者多消费者安全。取消的 send 会丢弃值，
+// 所以 T 应自己管理资源（FrameRef、unique_ptr 等）
+template<class T>
+class StageChannel {
+public:
+    class SendAwaiter;
+    class ReceiveAwaiter;
+
+    explicit StageChannel(size_t capacity)
+        : mCapacity(std::max<size_t>(capacity, 1)) {}
+
+    StageChannel(const StageChannel &) = delete;
+    StageChannel &operator=(const StageChannel &) = delete;
+
+    // co_await 返回 bool，false 表示已请求停止、值没有送出
+    SendAwaiter send(T value) {
+        return SendAwaiter{*this, std::move(value)};
+    }
+
+    // co_await 返回 std::optional<T>，空表示已请求停止
+    ReceiveAwaiter receive() {
+        return ReceiveAwaiter{*this};
+    }
+
+    // 不挂起的发送，可在协程之外调用。满时返回 false，value 保持不变
+    bool trySend(T &value) {
+        StagePool::Waker waker;
+        {
+            std::lock_guard lock(mMtx);
+            if (!mReceivers.empty()) {
+                ReceiveAwaiter *receiver = mReceivers.front();
+                mReceivers.pop_front();
+                receiver->mResult = std::move(value);
+                receiver->mQueued = false;
+                receiver->mPromise->waiting = false;
+                waker = receiver->mPromise->waker;
+            } else if (mItems.size() < mCapacity) {
+                mItems.push_back(std::move(value));
+            } else {
+                return false;
+            }
+        }
+        waker.wake();
+        return true;
+    }
+
+    // 不挂起的接收，可在协程之外调用。空时返回空
+    std::optional<T> tryReceive() {
+        std::vector<StagePool::Waker> wakers;
+        std::optional<T> value;
+        {
+            std::lock_guard lock(mMtx);
+            if (mItems.empty()) {
+                return std::nullopt;
+            }
+            value = std::move(mItems.front());
+            mItems.pop_front();
+            admitSenders(wakers);
+        }
+        for (const StagePool::Waker &waker: wakers) {
+            waker.wake();
+        }
+        return value;
+    }
+
+    // 丢弃队列中的数据（seek 时由生产方调用），挂起的发送方补进来并被唤醒
+    void clear() {
+        std::vector<StagePool::Waker> wakers;
+        std::deque<T> dropped;
+        {
+            std::lock_guard lock(mMtx);
+            dropped.swap(mItems);
+            admitSenders(wakers);
+        }
+        for (const StagePool::Waker &waker: wakers) {
+            waker.wake();
+        }
+    }
+
+    size_t size() const {
+        std::lock_guard lock(mMtx);
+        return mItems.size();
+    }
+
+    class SendAwaiter {
+    public:
+        SendAwaiter(StageChannel &channel, T value)
+            : mChannel(channel), mValue(std::move(value)) {}
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        bool await_suspend(StageCoroutine::CoroutineHandle handle) {
+            mPromise = &handle.promise();
+            if (mPromise->token.stop_requested()) {
+                return false;
+            }
+            StagePool::Waker waker;
+            {
+                std::lock_guard lock(mChannel.mMtx);
+                if (!mChannel.mReceivers.empty()) {
+                    // 有接收方在等，直接交给它
+                    ReceiveAwaiter *receiver = mChannel.mReceivers.front();
+                    mChannel.mReceivers.pop_front();
+                    receiver->mResult = std::move(mValue);
+                    receiver->mQueued = false;
+                    receiver->mPromise->waiting = false;
+                    waker = receiver->mPromise->waker;
+                } else if (mChannel.mItems.size() < mChannel.mCapacity) {
+                    mChannel.mItems.push_back(std::move(mValue));
+                } else {
+                    mQueued = true;
+                    mSuspended = true;
+                    mChannel.mSenders.push_back(this);
+                    mPromise->waiting = true;
+                    mPromise->next = StagePool::kParked;
+                    return true;
+                }
+                mSent = true;
+            }
+            waker.wake();
+            return false;
+        }
+
+        bool await_resume() {
+            if (mSuspended) {
+                std::lock_guard lock(mChannel.mMtx);
+                if (mQueued) {
+                    // 停止时仍在排队
+                    std::erase(mChannel.mSenders, this);
+                    mQueued = false;
+                }
+            }
+            return mSent;
+        }
+
+    private:
+        friend class StageChannel;
+
+        StageChannel &mChannel;
+        T mValue;
+        StageCoroutine::promise_type *mPromise{};
+        bool mSuspended = false;
+        // 以下由通道锁保护
+        bool mQueued = false;
+        bool mSent = false;
+    };
+
+    class ReceiveAwaiter {
+    public:
+        explicit ReceiveAwaiter(StageChannel &channel): mChannel(channel) {}
+
+        bool await_ready() const noexcept {
+            return false;
+        }
+
+        bool await_suspend(StageCoroutine::CoroutineHandle handle) {
+            mPromise = &handle.promise();
+            if (mPromise->token.stop_requested()) {
+                return false;
+            }
+            std::vector<StagePool::Waker> wakers;
+            {
+                std::lock_guard lock(mChannel.mMtx);
+                if (mChannel.mItems.empty()) {
+                    mQueued = true;
+                    mSuspended = true;
+                    mChannel.mReceivers.push_back(this);
+                    mPromise->waiting = true;
+                    mPromise->next = StagePool::kParked;
+                    return true;
+                }
+                mResult = std::move(mChannel.mItems.front());
+                mChannel.mItems.pop_front();
+                mChannel.admitSenders(wakers);
+            }
+            for (const StagePool::Waker &waker: wakers) {
+                waker.wake();
+            }
+            return false;
+        }
+
+        std::optional<T> await_resume() {
+            if (mSuspended) {
+                std::lock_guard lock(mChannel.mMtx);
+                if (mQueued) {
+                    std::erase(mChannel.mReceivers, this);
+                    mQueued = false;
+                }
+            }
+            return std::move(mResult);
+        }
+
+    private:
+        friend class StageChannel;
+        friend class SendAwaiter;
+
+        StageChannel &mChannel;
+        StageCoroutine::promise_type *mPromise{};
+        bool mSuspended = false;
+        // 以下由通道锁保护
+        bool mQueued = false;
+        std::optional<T> mResult;
+    };
+
+private:
+    // 需持有 mMtx。把挂起的发送方的值放进空出来的位置
+    void admitSenders(std::vector<StagePool::Waker> &wakers) {
+        while (!mSenders.empty() && mItems.size() < mCapacity) {
+            SendAwaiter *sender = mSenders.front();
+            mSenders.pop_front();
+            mItems.push_back(std::move(sender->mValue));
+            sender->mQueued = false;
+            sender->mSent = true;
+            sender->mPromise->waiting = false;
+            wakers.push_back(sender->mPromise->waker);
+        }
+    }
+
+    const size_t mCapacity;
+    mutable std::mutex mMtx;
+    std::deque<T> mItems;
+    std::deque<SendAwaiter *> mSenders;
+    std::deque<ReceiveAwaiter *> mReceivers;
+};
@@ -0,0 +1,388 @@
+#include "StagePool.h"
+#include <algorithm>
+#include <latch>
+#include <spdlog/fmt/fmt.h>
+
+class StagePool::Task {
+public:
+    Task(StagePool *pool, Stage stage, Step step): pool(pool), stage(stage),
+                                                   step(std::move(step)) {}
+
+    StagePool *const pool;
+    const Stage stage;
+    Step step;
+    Clock::time_point due{};
+    // 上次排到的线程，唤醒时放回它的队列
+    int home = 0;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool running = false;
+    bool stopped = false;
+    bool parked = false;
+    // 执行或排队期间收到的唤醒
+    bool wakePending = false;
+};
+
+namespace {
+void updateMax(std::atomic<uint64_t> &value, uint64_t sample) {
+    uint64_t current = value.load(std::memory_order_relaxed);
+    while (current < sample && !value.compare_exchange_weak(current, sample)) {}
+}
+
+StagePool::ThreadConfig &pendingConfig() {
+    static StagePool::ThreadConfig config;
+    return config;
+}
+
+uint64_t microsBetween(StagePool::Clock::time_point from,
+                       StagePool::Clock::time_point to) {
+    return to > from
+               ? std::chrono::duration_cast<std::chrono::microseconds>(
+                   to - from).count()
+               : 0;
+}
+}
+
+void StagePool::Waker::wake() const {
+    std::shared_ptr<Task> task = mTask.lock();
+    if (!task) {
+        return;
+    }
+    {
+        std::lock_guard lock(task->mtx);
+        if (task->stopped) {
+            return;
+        }
+        if (!task->parked) {
+            task->wakePending = true;
+            return;
+        }
+        task->parked = false;
+        task->due = Clock::now();
+    }
+    const int home = task->home;
+    task->pool->enqueue(home, std::move(task));
+}
+
+StagePool::Handle &StagePool::Handle::operator=(Handle &&other) noexcept {
+    if (this != &other) {
+        stop();
+        mTask = std::move(other.mTask);
+    }
+    return *this;
+}
+
+StagePool::Handle::~Handle() {
+    stop();
+}
+
+void StagePool::Handle::stop() {
+    if (!mTask) {
+        return;
+    }
+    std::unique_lock lock(mTask->mtx);
+    mTask->stopped = true;
+    mTask->cv.wait(lock, [this] { return !mTask->running; });
+    lock.unlock();
+    mTask.reset();
+}
+
+StagePool::StagePool(int threads, const ThreadConfig &config) {
+    const int cores = std::max(
+        1, static_cast<int>(std::thread::hardware_concurrency()));
+    std::vector<ThreadPolicy> policies;
+    std::vector<std::string> names;
+    const auto addLane = [&](int count, const ThreadPolicy &policy,
+                             const char *name) {
+        auto lane = std::make_unique<Lane>();
+        lane->first = static_cast<int>(mWorkers.size());
+        lane->count = count;
+        for (int i = 0; i < count; ++i) {
+            mWorkers.push_back(std::make_unique<Worker>());
+            mWorkers.back()->lane = static_cast<int>(mLanes.size());
+            policies.push_back(policy);
+            names.push_back(fmt::format("mp-{}-{}", name, i));
+        }
+        mLanes.push_back(std::move(lane));
+    };
+    if (std::any_of(config.dedicated.begin(), config.dedicated.end(),
+                    [](const auto &policy) { return !policy; })) {
+        addLane(threads > 0 ? std::min(threads, cores) : cores,
+                config.shared, "pool");
+    }
+    for (int stage = 0; stage < kStages; ++stage) {
+        const std::optional<ThreadPolicy> &policy = config.dedicated[stage];
+        if (policy) {
+            mStageLane[stage] = static_cast<int>(mLanes.size());
+            addLane(std::max<int>(1, policy->cpus.size()), *policy,
+                    name(static_cast<Stage>(stage)));
+        }
+    }
+
+    const int n = static_cast<int>(mWorkers.size());
+    mGrants.resize(n);
+    std::latch applied(n);
+    for (int i = 0; i < n; ++i) {
+        mThreads.emplace_back([this, i, &applied, policy = policies[i],
+                                  name = names[i]](std::stop_token token) {
+            mGrants[i] = applyThreadPolicy(name, policy);
+            applied.count_down();
+            worker(i, token);
+        });
+    }
+    applied.wait();
+}
+
+StagePool::~StagePool() {
+    for (auto &thread: mThreads) {
+        thread.request_stop();
+    }
+    for (auto &lane: mLanes) {
+        lane->cv.notify_all();
+    }
+    mThreads.clear();
+}
+
+void StagePool::configure(const ThreadConfig &config) {
+    pendingConfig() = config;
+}
+
+StagePool &StagePool::instance() {
+    static StagePool pool(0, pendingConfig());
+    return pool;
+}
+
+int StagePool::threadCount() const {
+    return static_cast<int>(mThreads.size());
+}
+
+const std::vector<ThreadGrant> &StagePool::threadGrants() const {
+    return mGrants;
+}
+
+std::string StagePool::threadReport() const {
+    std::string text = fmt::format("threads={}", threadCount());
+    for (const ThreadGrant &grant: mGrants) {
+        text += fmt::format(" | {} {}", grant.name,
+                            grant.granted.describe());
+        if (!grant.note.empty()) {
+            text += fmt::format(" (requested {}: {})",
+                                grant.requested.describe(), grant.note);
+        }
+    }
+    return text;
+}
+
+StagePool::Handle StagePool::submit(Stage stage, Step step, bool start) {
+    auto task = std::make_shared<Task>(this, stage, std::move(step));
+    const Lane &lane = *mLanes[mStageLane[static_cast<int>(stage)]];
+    const int index = lane.first + static_cast<int>(
+                          mNextWorker++ % static_cast<unsigned>(lane.count));
+    task->home = index;
+    if (start) {
+        schedule(index, task, Clock::now());
+    } else {
+        task->parked = true;
+    }
+    return Handle{std::move(task)};
+}
+
+void StagePool::enqueue(int index, std::shared_ptr<Task> task) {
+    Worker &worker = *mWorkers[index];
+    {
+        std::lock_guard lock(worker.mtx);
+        worker.queues[static_cast<int>(task->stage)].push_back(
+            std::move(task));
+    }
+    Lane &lane = *mLanes[worker.lane];
+    ++lane.ready;
+    {
+        // 与 worker() 中的等待条件同步，避免丢失唤醒
+        std::lock_guard lock(lane.mtx);
+    }
+    lane.cv.notify_one();
+}
+
+void StagePool::schedule(int index, std::shared_ptr<Task> task,
+                         Clock::time_point due) {
+    task->due = due;
+    task->home = index;
+    if (due <= Clock::now()) {
+        enqueue(index, std::move(task));
+        return;
+    }
+    Lane &lane = *mLanes[mWorkers[index]->lane];
+    bool earliest;
+    {
+        std::lock_guard lock(lane.mtx);
+        earliest = lane.timers.empty() || due < lane.timers.top().due;
+        lane.timers.push({due, std::move(task)});
+    }
+    if (earliest) {
+        lane.cv.notify_one();
+    }
+}
+
+// 到期的定时任务放进本线程的队列
+void StagePool::promoteDue(int index) {
+    Lane &lane = *mLanes[mWorkers[index]->lane];
+    std::vector<std::shared_ptr<Task>> due;
+    {
+        std::lock_guard lock(lane.mtx);
+        const auto now = Clock::now();
+        while (!lane.timers.empty() && lane.timers.top().due <= now) {
+            due.push_back(lane.timers.top().task);
+            lane.timers.pop();
+        }
+    }
+    for (auto &task: due) {
+        enqueue(index, std::move(task));
+    }
+}
+
+// 先按优先级取本地队列的队首，再按优先级从同组其他线程的队尾偷
+std::shared_ptr<StagePool::Task> StagePool::take(int index) {
+    Lane &lane = *mLanes[mWorkers[index]->lane];
+    const int n = lane.count;
+    const int local = index - lane.first;
+    for (int stage = 0; stage < kStages; ++stage) {
+        for (int k = 0; k < n; ++k) {
+            Worker &worker = *mWorkers[lane.first + (local + k) % n];
+            std::lock_guard lock(worker.mtx);
+            auto &queue = worker.queues[stage];
+            if (queue.empty()) {
+                continue;
+            }
+            std::shared_ptr<Task> task;
+            if (k == 0) {
+                task = std::move(queue.front());
+                queue.pop_front();
+            } else {
+                task = std::move(queue.back());
+                queue.pop_back();
+            }
+            --lane.ready;
+            return task;
+        }
+    }
+    return nullptr;
+}
+
+void StagePool::worker(int index, std::stop_token token) {
+    while (!token.stop_requested()) {
+        promoteDue(index);
+        if (std::shared_ptr<Task> task = take(index)) {
+            run(index, task);
+            continue;
+        }
+        Lane &lane = *mLanes[mWorkers[index]->lane];
+        std::unique_lock lock(lane.mtx);
+        auto ready = [&lane] {
+            return lane.ready > 0 || (!lane.timers.empty() &&
+                                      lane.timers.top().due <= Clock::now());
+        };
+        if (lane.timers.empty()) {
+            lane.cv.wait(lock, token, ready);
+        } else {
+            lane.cv.wait_until(lock, token, lane.timers.top().due, ready);
+        }
+    }
+}
+
+void StagePool::run(int index, const std::shared_ptr<Task> &task) {
+    {
+        std::lock_guard lock(task->mtx);
+        if (task->stopped) {
+            return;
+        }
+        task->running = true;
+        task->wakePending = false;
+    }
+    const auto begin = Clock::now();
+    Clock::time_point next = task->step();
+    const auto end = Clock::now();
+
+    Counters &counters = mCounters[static_cast<int>(task->stage)];
+    const uint64_t latency = microsBetween(task->due, begin);
+    const uint64_t elapsed = microsBetween(begin, end);
+    counters.runs.fetch_add(1, std::memory_order_relaxed);
+    counters.latencyUs.fetch_add(latency, std::memory_order_relaxed);
+    counters.runUs.fetch_add(elapsed, std::memory_order_relaxed);
+    updateMax(counters.maxLatencyUs, latency);
+    updateMax(counters.maxRunUs, elapsed);
+
+    bool stopped;
+    bool parked = false;
+    {
+        std::lock_guard lock(task->mtx);
+        task->running = false;
+        stopped = task->stopped;
+        if (next == kParked && !stopped) {
+            if (task->wakePending) {
+                task->wakePending = false;
+                next = end;
+            } else {
+                task->parked = parked = true;
+            }
+        }
+    }
+    task->cv.notify_all();
+    if (!stopped && !parked && next != kFinished) {
+        schedule(index, task, next);
+    }
+}
+
+std::array<StagePool::StageStats, StagePool::kStages> StagePool::stats()
+const {
+    std::array<StageStats, kStages> result;
+    for (int i = 0; i < kStages; ++i) {
+        const Counters &c = mCounters[i];
+        StageStats &s = result[i];
+        s.runs = c.runs;
+        if (s.runs) {
+            s.avgLatencyMs = c.latencyUs / 1000.0 / s.runs;
+            s.avgRunMs = c.runUs / 1000.0 / s.runs;
+        }
+        s.maxLatencyMs = c.maxLatencyUs / 1000.0;
+        s.maxRunMs = c.maxRunUs / 1000.0;
+    }
+    return result;
+}
+
+void StagePool::clearStats() {
+    for (Counters &c: mCounters) {
+        c.runs = 0;
+        c.latencyUs = 0;
+        c.maxLatencyUs = 0;
+        c.runUs = 0;
+        c.maxRunUs = 0;
+    }
+}
+
+std::string StagePool::report() const {
+    std::string text = fmt::format("threads={}", threadCount());
+    const auto all = stats();
+    for (int i = 0; i < kStages; ++i) {
+        const StageStats &s = all[i];
+        text += fmt::format(" | {} runs={} latency avg={:.3f}ms max={:.3f}ms "
+                            "run avg={:.3f}ms max={:.3f}ms",
+                            name(static_cast<Stage>(i)), s.runs,
+                            s.avgLatencyMs, s.maxLatencyMs, s.avgRunMs,
+                            s.maxRunMs);
+    }
+    return text;
+}
+
+const char *StagePool::name(Stage stage) {
+    switch (stage) {
+        case Stage::Audio:
+            return "audio";
+        case Stage::Present:
+            return "present";
+        case Stage::Decode:
+            return "decode";
+        case Stage::Read:
+            return "read";
+    }
+    return "?";
+}
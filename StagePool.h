@@ -0,0 +1,182 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ThreadPolicy.h"
+
+// 所有播放器共用的流水线调度池。每个播放会话的读包、解码、呈现、音频
+// 各是一个任务，任务每次执行一步（一个包/一帧）就返回下次希望运行的时间，
+// 不在池线程里睡眠。线程数不超过核数：每个线程有按阶段分级的本地队列，
+// 先取本地最高优先级，空了再从其他线程偷；到期前的任务挂在定时堆上。
+// 同一任务同一时刻只在一个线程上运行，阶段内部仍是单线程语义。
+// 可以给阶段分配独立的线程组（实时调度、绑核），组之间互不偷取。
+class StagePool {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // 优先级从高到低
+    enum class Stage {
+        Audio,
+        Present,
+        Decode,
+        Read,
+    };
+
+    static constexpr int kStages = 4;
+
+    // 执行一步，返回下次运行时间；<= now 立即重新排队，kFinished 结束任务，
+    // kParked 挂起到 Waker::wake()（等待数据时不占线程也不轮询）
+    using Step = std::function<Clock::time_point()>;
+    static constexpr Clock::time_point kFinished = Clock::time_point::max();
+    static constexpr Clock::time_point kParked = kFinished - Clock::duration{1};
+
+    struct StageStats {
+        uint64_t runs = 0;
+        // 到期到开始执行的调度延迟
+        double avgLatencyMs = 0.0;
+        double maxLatencyMs = 0.0;
+        // 每步耗时
+        double avgRunMs = 0.0;
+        double maxRunMs = 0.0;
+    };
+
+    class Task;
+
+    // 唤醒挂起的任务，可复制，任意线程调用。任务正在执行或已排队时，
+    // 记下这次唤醒，该步返回 kParked 后立即再执行一次；任务已停止时不做事
+    class Waker {
+    public:
+        Waker() = default;
+
+        void wake() const;
+
+    private:
+        friend class StagePool;
+        explicit Waker(std::weak_ptr<Task> task): mTask(std::move(task)) {}
+
+        std::weak_ptr<Task> mTask;
+    };
+
+    // 任务句柄，析构或 stop() 时停止任务
+    class Handle {
+    public:
+        Handle() = default;
+        Handle(Handle &&) noexcept = default;
+        Handle &operator=(Handle &&other) noexcept;
+        ~Handle();
+
+        // 返回后该任务的 step 不会再被调用（正在执行的一步会先执行完）
+        void stop();
+
+        Waker waker() const {
+            return Waker{mTask};
+        }
+
+        explicit operator bool() const {
+            return static_cast<bool>(mTask);
+        }
+
+    private:
+        friend class StagePool;
+        explicit Handle(std::shared_ptr<Task> task): mTask(std::move(task)) {}
+
+        std::shared_ptr<Task> mTask;
+    };
+
+    // dedicated 中设置了的阶段有自己的线程组：线程数为 cpus 的个数，
+    // 未指定 CPU 时为 1，只运行该阶段的任务；其余阶段共用按 shared 设置的线程
+    struct ThreadConfig {
+        std::array<std::optional<ThreadPolicy>, kStages> dedicated;
+        ThreadPolicy shared;
+    };
+
+    // threads 为共用线程数，<= 0 时取核数。构造返回时各线程已应用调度设置
+    explicit StagePool(int threads = 0, const ThreadConfig &config = {});
+    ~StagePool();
+
+    StagePool(const StagePool &) = delete;
+    StagePool &operator=(const StagePool &) = delete;
+
+    // 在第一次调用 instance() 之前设置才生效
+    static void configure(const ThreadConfig &config);
+    static StagePool &instance();
+
+    int threadCount() const;
+
+    // 各线程实际得到的调度类和亲和性
+    const std::vector<ThreadGrant> &threadGrants() const;
+    std::string threadReport() const;
+
+    // start 为 false 时任务先挂起，由 waker().wake() 开始
+    Handle submit(Stage stage, Step step, bool start = true);
+
+    std::array<StageStats, kStages> stats() const;
+    void clearStats();
+    std::string report() const;
+
+    static const char *name(Stage stage);
+
+private:
+    struct Worker {
+        int lane = 0;
+        std::mutex mtx;
+        std::array<std::deque<std::shared_ptr<Task>>, kStages> queues;
+    };
+
+    struct Timed {
+        Clock::time_point due;
+        std::shared_ptr<Task> task;
+
+        bool operator>(const Timed &other) const {
+            return due > other.due;
+        }
+    };
+
+    struct Counters {
+        std::atomic<uint64_t> runs{0};
+        std::atomic<uint64_t> latencyUs{0};
+        std::atomic<uint64_t> maxLatencyUs{0};
+        std::atomic<uint64_t> runUs{0};
+        std::atomic<uint64_t> maxRunUs{0};
+    };
+
+    // 一组线程 [first, first + count)，各有定时堆和休眠，任务只在组内调度
+    struct Lane {
+        int first = 0;
+        int count = 0;
+        // 保护定时堆和休眠
+        std::mutex mtx;
+        std::condition_variable_any cv;
+        std::priority_queue<Timed, std::vector<Timed>, std::greater<>> timers;
+        std::atomic<int> ready{0};
+    };
+
+    void worker(int index, std::stop_token token);
+    void enqueue(int index, std::shared_ptr<Task> task);
+    void schedule(int index, std::shared_ptr<Task> task,
+                  Clock::time_point due);
+    std::shared_ptr<Task> take(int index);
+    void promoteDue(int index);
+    void run(int index, const std::shared_ptr<Task> &task);
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+    std::vector<std::unique_ptr<Lane>> mLanes;
+    std::array<int, kStages> mStageLane{};
+    std::atomic<unsigned> mNextWorker{0};
+    std::array<Counters, kStages> mCounters;
+    // 构造时各线程写入自己的一项，之后只读
+    std::vector<ThreadGrant> mGrants;
+    std::vector<std::jthread> mThreads;
+};
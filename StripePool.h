@@ -0,0 +1,102 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "ThreadPolicy.h"
+
+// 按条带并行的常驻线程池（YuvConverter、QualityMetrics）：调用线程自己
+// 也参与执行，workers 数量为 threads - 1
+class StripePool {
+public:
+    explicit StripePool(int threads) {
+        for (int i = 1; i < threads; ++i) {
+            mWorkers.emplace_back([this](std::stop_token token) {
+                worker(token);
+            });
+        }
+    }
+
+    ~StripePool() {
+        for (auto &w: mWorkers) {
+            w.request_stop();
+        }
+        mCv.notify_all();
+    }
+
+    int size() const {
+        return static_cast<int>(mWorkers.size()) + 1;
+    }
+
+    // 执行 job(0..count-1)，全部完成后返回
+    void run(int count, const std::function<void(int)> &job) {
+        std::lock_guard runLock(mRunMtx);
+        uint64_t generation;
+        {
+            std::lock_guard lock(mMtx);
+            mJob = &job;
+            mCount = count;
+            mNext = 0;
+            mPending = count;
+            generation = ++mGeneration;
+        }
+        mCv.notify_all();
+        drain(generation);
+
+        std::unique_lock lock(mMtx);
+        mDoneCv.wait(lock, [this] { return mPending == 0; });
+        mJob = nullptr;
+    }
+
+private:
+    void worker(std::stop_token token) {
+        setThreadName("mp-stripe");
+        uint64_t seen = 0;
+        while (true) {
+            {
+                std::unique_lock lock(mMtx);
+                mCv.wait(lock, token, [&] { return mGeneration != seen; });
+                if (token.stop_requested()) {
+                    return;
+                }
+                seen = mGeneration;
+            }
+            drain(seen);
+        }
+    }
+
+    // 领取当前批次的条带直到取完；批次号不匹配说明已经过期
+    void drain(uint64_t generation) {
+        while (true) {
+            int index;
+            const std::function<void(int)> *job;
+            {
+                std::lock_guard lock(mMtx);
+                if (generation != mGeneration || mNext >= mCount) {
+                    return;
+                }
+                index = mNext++;
+                job = mJob;
+            }
+            (*job)(index);
+            std::lock_guard lock(mMtx);
+            if (--mPending == 0) {
+                mDoneCv.notify_all();
+            }
+        }
+    }
+
+    std::mutex mRunMtx;
+    std::mutex mMtx;
+    std::condition_variable_any mCv;
+    std::condition_variable mDoneCv;
+    const std::function<void(int)> *mJob{};
+    int mCount{};
+    int mNext{};
+    int mPending{};
+    uint64_t mGeneration{};
+    std::vector<std::jthread> mWorkers;
+};
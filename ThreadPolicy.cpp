@@ -0,0 +1,247 @@
+#include "ThreadPolicy.h"
+#include <spdlog/fmt/fmt.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+constexpr int kFallbackNice = -10;
+// pthread 线程名最长 15 字节
+constexpr size_t kMaxNameLength = 15;
+
+std::optional<int> parseInt(const std::string &text) {
+    if (text.empty()) {
+        return std::nullopt;
+    }
+    size_t used = 0;
+    try {
+        const int value = std::stoi(text, &used);
+        if (used == text.size()) {
+            return value;
+        }
+    } catch (...) {}
+    return std::nullopt;
+}
+
+// "0-3,6" → {0,1,2,3,6}
+std::optional<std::vector<int>> parseCpus(const std::string &text) {
+    std::vector<int> cpus;
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        const size_t end = std::min(text.find(',', begin), text.size());
+        const std::string item = text.substr(begin, end - begin);
+        const size_t dash = item.find('-');
+        const auto first = parseInt(item.substr(0, dash));
+        const auto last = dash == std::string::npos
+                              ? first
+                              : parseInt(item.substr(dash + 1));
+        if (!first || !last || *first < 0 || *last < *first) {
+            return std::nullopt;
+        }
+        for (int cpu = *first; cpu <= *last; ++cpu) {
+            cpus.push_back(cpu);
+        }
+        begin = end + 1;
+    }
+    std::sort(cpus.begin(), cpus.end());
+    cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+    return cpus;
+}
+
+pid_t threadId() {
+    return gettid();
+}
+
+bool setNice(int nice, std::string &note) {
+    if (setpriority(PRIO_PROCESS, threadId(), nice) == 0) {
+        return true;
+    }
+    note += fmt::format("nice {}: {}; ", nice, std::strerror(errno));
+    return false;
+}
+
+// 实时调度被拒绝说明没有 CAP_SYS_NICE，nice 只能降到 RLIMIT_NICE 允许的
+// 下限 20 - rlim_cur。退回 kFallbackNice 与该下限中较高的一个，
+// 不比当前低时保持不变
+void fallbackToNice(std::string &note) {
+    errno = 0;
+    const int current = getpriority(PRIO_PROCESS, threadId());
+    if (errno != 0) {
+        note += fmt::format("getpriority: {}; ", std::strerror(errno));
+        return;
+    }
+    int lowest = -20;
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NICE, &limit) == 0 &&
+        limit.rlim_cur != RLIM_INFINITY) {
+        lowest = 20 - static_cast<int>(std::min<rlim_t>(limit.rlim_cur, 40));
+    }
+    const int target = std::max(kFallbackNice, lowest);
+    if (target >= current) {
+        note += fmt::format("RLIMIT_NICE allows nice >= {}; ", lowest);
+        return;
+    }
+    setNice(target, note);
+}
+
+// 读回调用线程当前的调度设置
+ThreadPolicy currentPolicy() {
+    ThreadPolicy policy;
+    int scheduler = SCHED_OTHER;
+    sched_param param{};
+    if (pthread_getschedparam(pthread_self(), &scheduler, &param) == 0 &&
+        (scheduler == SCHED_FIFO || scheduler == SCHED_RR)) {
+        policy.scheduling = scheduler == SCHED_FIFO
+                                ? ThreadPolicy::Scheduling::Fifo
+                                : ThreadPolicy::Scheduling::RoundRobin;
+        policy.priority = param.sched_priority;
+        return policy;
+    }
+    errno = 0;
+    const int nice = getpriority(PRIO_PROCESS, threadId());
+    if (errno == 0 && nice != 0) {
+        policy.scheduling = ThreadPolicy::Scheduling::Nice;
+        policy.priority = nice;
+    }
+    return policy;
+}
+}
+
+std::optional<ThreadPolicy> ThreadPolicy::parse(const std::string &text) {
+    ThreadPolicy policy;
+    const size_t at = text.find('@');
+    const std::string scheduling = text.substr(0, at);
+    if (at != std::string::npos) {
+        auto cpus = parseCpus(text.substr(at + 1));
+        if (!cpus) {
+            return std::nullopt;
+        }
+        policy.cpus = std::move(*cpus);
+    }
+    const size_t colon = scheduling.find(':');
+    const std::string kind = scheduling.substr(0, colon);
+    if (kind == "default" || kind.empty()) {
+        return colon == std::string::npos
+                   ? std::optional{policy}
+                   : std::nullopt;
+    }
+    const auto priority = colon == std::string::npos
+                              ? std::nullopt
+                              : parseInt(scheduling.substr(colon + 1));
+    if (!priority) {
+        return std::nullopt;
+    }
+    policy.priority = *priority;
+    if (kind == "fifo" || kind == "rr") {
+        if (policy.priority < 1 || policy.priority > 99) {
+            return std::nullopt;
+        }
+        policy.scheduling = kind == "fifo"
+                                ? Scheduling::Fifo
+                                : Scheduling::RoundRobin;
+    } else if (kind == "nice") {
+        if (policy.priority < -20 || policy.priority > 19) {
+            return std::nullopt;
+        }
+        policy.scheduling = Scheduling::Nice;
+    } else {
+        return std::nullopt;
+    }
+    return policy;
+}
+
+std::string ThreadPolicy::describe() const {
+    std::string text;
+    switch (scheduling) {
+        case Scheduling::Default:
+            text = "default";
+            break;
+        case Scheduling::Nice:
+            text = fmt::format("nice:{}", priority);
+            break;
+        case Scheduling::RoundRobin:
+            text = fmt::format("rr:{}", priority);
+            break;
+        case Scheduling::Fifo:
+            text = fmt::format("fifo:{}", priority);
+            break;
+    }
+    for (size_t i = 0; i < cpus.size(); ++i) {
+        text += fmt::format("{}{}", i == 0 ? '@' : ',', cpus[i]);
+    }
+    return text;
+}
+
+void setThreadName(const std::string &name) {
+    pthread_setname_np(pthread_self(),
+                       name.substr(0, kMaxNameLength).c_str());
+}
+
+ThreadGrant applyThreadPolicy(const std::string &name,
+                              const ThreadPolicy &policy) {
+    ThreadGrant grant{name, policy, {}, {}};
+    setThreadName(name);
+
+    switch (policy.scheduling) {
+        case ThreadPolicy::Scheduling::Default:
+            break;
+        case ThreadPolicy::Scheduling::Nice:
+            setNice(policy.priority, grant.note);
+            break;
+        case ThreadPolicy::Scheduling::RoundRobin:
+        case ThreadPolicy::Scheduling::Fifo: {
+            const int scheduler = policy.scheduling ==
+                                  ThreadPolicy::Scheduling::Fifo
+                                      ? SCHED_FIFO
+                                      : SCHED_RR;
+            sched_param param{};
+            param.sched_priority = std::clamp(
+                policy.priority, sched_get_priority_min(scheduler),
+                sched_get_priority_max(scheduler));
+            if (const int err = pthread_setschedparam(pthread_self(),
+                                                      scheduler, &param)) {
+                grant.note += fmt::format("{}: {}; ", policy.describe(),
+                                          std::strerror(err));
+                fallbackToNice(grant.note);
+            }
+            break;
+        }
+    }
+
+    if (!policy.cpus.empty()) {
+        const long configured = sysconf(_SC_NPROCESSORS_CONF);
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu: policy.cpus) {
+            if (cpu < CPU_SETSIZE && cpu < configured) {
+                CPU_SET(cpu, &set);
+            }
+        }
+        if (CPU_COUNT(&set) == 0) {
+            grant.note += "no such cpu; ";
+        } else if (const int err = pthread_setaffinity_np(
+            pthread_self(), sizeof(set), &set)) {
+            grant.note += fmt::format("affinity: {}; ", std::strerror(err));
+        }
+    }
+
+    grant.granted = currentPolicy();
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (!policy.cpus.empty() &&
+        pthread_getaffinity_np(pthread_self(), sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+            if (CPU_ISSET(cpu, &set)) {
+                grant.granted.cpus.push_back(cpu);
+            }
+        }
+    }
+    if (!grant.note.empty()) {
+        grant.note.resize(grant.note.size() - 2);
+    }
+    return grant;
+}
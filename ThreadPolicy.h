@@ -0,0 +1,44 @@
+#pragma once
+
+#include <optional>
+#include <string>
+#include <vector>
+
+// 线程的调度类、优先级和 CPU 亲和性
+struct ThreadPolicy {
+    enum class Scheduling {
+        Default,
+        Nice,
+        RoundRobin,
+        Fifo,
+    };
+
+    Scheduling scheduling = Scheduling::Default;
+    // Fifo/RoundRobin 为实时优先级 1..99，Nice 为 nice 值 -20..19
+    int priority = 0;
+    // 允许运行的 CPU，为空时不限制
+    std::vector<int> cpus;
+
+    // "fifo:20"、"rr:10@2,3"、"nice:-5@0-3"、"default@1"，格式错误返回空
+    static std::optional<ThreadPolicy> parse(const std::string &text);
+
+    std::string describe() const;
+};
+
+// 实际得到的设置
+struct ThreadGrant {
+    std::string name;
+    ThreadPolicy requested;
+    ThreadPolicy granted;
+    // 没有得到所请求设置的原因，成功时为空
+    std::string note;
+};
+
+// 设置调用线程的名字（超过 15 字节截断），只用于调试器和 top -H 显示
+void setThreadName(const std::string &name);
+
+// 命名调用线程并应用 policy。实时调度被拒绝（没有 CAP_SYS_NICE、
+// RLIMIT_RTPRIO 不够）时退回 RLIMIT_NICE 允许的最低 nice（不低于 -10），
+// 不允许降低时保持默认；亲和性中不存在的 CPU 被忽略
+ThreadGrant applyThreadPolicy(const std::string &name,
+                              const ThreadPolicy &policy);
@@ -0,0 +1,312 @@
+#include "ToneMapper.h"
+#include <libyuv/cpu_id.h>
+#include <algorithm>
+#include <cmath>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TONEMAP_HAS_AVX2 1
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#define TONEMAP_HAS_NEON 1
+#endif
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/mastering_display_metadata.h>
+}
+
+namespace {
+// gamma 查表按 sqrt(线性光) 均匀取样。按线性光均匀取样时，暗部一格
+// 跨好几个 8 位码值，出现色带
+constexpr int kOetfSize = 4096;
+
+// Hable (Uncharted 2) 曲线参数
+constexpr float kA = 0.15f;
+constexpr float kB = 0.50f;
+constexpr float kC = 0.10f;
+constexpr float kD = 0.20f;
+constexpr float kE = 0.02f;
+constexpr float kF = 0.30f;
+
+// 线性 BT.2020 -> 线性 BT.709
+constexpr float kGamut[9] = {
+    1.6605f, -0.5876f, -0.0728f,
+    -0.1246f, 1.1329f, -0.0083f,
+    -0.0182f, -0.1006f, 1.1187f,
+};
+
+inline float hable(float x) {
+    return (x * (kA * x + kC * kB) + kD * kE) /
+           (x * (kA * x + kB) + kD * kF) - kE / kF;
+}
+
+struct RowContext {
+    const float *eotf;
+    const uint32_t *oetf;
+    float invWhiteCurve;
+};
+
+inline uint32_t mapChannel(const RowContext &c, float v) {
+    float y = hable(std::max(v, 0.0f)) * c.invWhiteCurve;
+    y = std::clamp(y, 0.0f, 1.0f);
+    return c.oetf[static_cast<int>(std::sqrt(y) * (kOetfSize - 1) + 0.5f)];
+}
+
+void mapRowScalar(const RowContext &c, const uint32_t *src, uint32_t *dst,
+                  int width) {
+    for (int x = 0; x < width; ++x) {
+        const uint32_t p = src[x];
+        const float b = c.eotf[p & 0x3ff];
+        const float g = c.eotf[(p >> 10) & 0x3ff];
+        const float r = c.eotf[(p >> 20) & 0x3ff];
+        const float r2 = kGamut[0] * r + kGamut[1] * g + kGamut[2] * b;
+        const float g2 = kGamut[3] * r + kGamut[4] * g + kGamut[5] * b;
+        const float b2 = kGamut[6] * r + kGamut[7] * g + kGamut[8] * b;
+        dst[x] = 0xff000000u | mapChannel(c, r2) << 16 |
+                 mapChannel(c, g2) << 8 | mapChannel(c, b2);
+    }
+}
+
+#ifdef TONEMAP_HAS_AVX2
+__attribute__((target("avx2"))) __m256 hableAvx2(__m256 x) {
+    const __m256 a = _mm256_set1_ps(kA);
+    const __m256 num = _mm256_add_ps(
+        _mm256_mul_ps(x, _mm256_add_ps(_mm256_mul_ps(a, x),
+                                       _mm256_set1_ps(kC * kB))),
+        _mm256_set1_ps(kD * kE));
+    const __m256 den = _mm256_add_ps(
+        _mm256_mul_ps(x, _mm256_add_ps(_mm256_mul_ps(a, x),
+                                       _mm256_set1_ps(kB))),
+        _mm256_set1_ps(kD * kF));
+    return _mm256_sub_ps(_mm256_div_ps(num, den), _mm256_set1_ps(kE / kF));
+}
+
+__attribute__((target("avx2"))) __m256i mapChannelAvx2(
+    const RowContext &c, __m256 v) {
+    const __m256 zero = _mm256_setzero_ps();
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 y = _mm256_mul_ps(hableAvx2(_mm256_max_ps(v, zero)),
+                             _mm256_set1_ps(c.invWhiteCurve));
+    y = _mm256_min_ps(_mm256_max_ps(y, zero), one);
+    const __m256i idx = _mm256_cvttps_epi32(_mm256_add_ps(
+        _mm256_mul_ps(_mm256_sqrt_ps(y), _mm256_set1_ps(kOetfSize - 1)),
+        _mm256_set1_ps(0.5f)));
+    return _mm256_i32gather_epi32(reinterpret_cast<const int *>(c.oetf), idx,
+                                  4);
+}
+
+__attribute__((target("avx2"))) __m256 gamutAvx2(
+    int i, __m256 r, __m256 g, __m256 b) {
+    return _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(kGamut[i]), r),
+                      _mm256_mul_ps(_mm256_set1_ps(kGamut[i + 1]), g)),
+        _mm256_mul_ps(_mm256_set1_ps(kGamut[i + 2]), b));
+}
+
+__attribute__((target("avx2"))) void mapRowAvx2(
+    const RowContext &c, const uint32_t *src, uint32_t *dst, int width) {
+    const __m256i mask = _mm256_set1_epi32(0x3ff);
+    const __m256i alpha = _mm256_set1_epi32(static_cast<int>(0xff000000u));
+    int x = 0;
+    for (; x + 8 <= width; x += 8) {
+        const __m256i p = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i *>(src + x));
+        const __m256 b = _mm256_i32gather_ps(
+            c.eotf, _mm256_and_si256(p, mask), 4);
+        const __m256 g = _mm256_i32gather_ps(
+            c.eotf, _mm256_and_si256(_mm256_srli_epi32(p, 10), mask), 4);
+        const __m256 r = _mm256_i32gather_ps(
+            c.eotf, _mm256_and_si256(_mm256_srli_epi32(p, 20), mask), 4);
+
+        const __m256i r8 = mapChannelAvx2(c, gamutAvx2(0, r, g, b));
+        const __m256i g8 = mapChannelAvx2(c, gamutAvx2(3, r, g, b));
+        const __m256i b8 = mapChannelAvx2(c, gamutAvx2(6, r, g, b));
+
+        __m256i out = _mm256_or_si256(alpha, _mm256_slli_epi32(r8, 16));
+        out = _mm256_or_si256(out, _mm256_slli_epi32(g8, 8));
+        out = _mm256_or_si256(out, b8);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + x), out);
+    }
+    mapRowScalar(c, src + x, dst + x, width - x);
+}
+#endif
+
+#ifdef TONEMAP_HAS_NEON
+float32x4_t gatherNeon(const float *table, uint32x4_t idx) {
+    const float lanes[4] = {
+        table[vgetq_lane_u32(idx, 0)], table[vgetq_lane_u32(idx, 1)],
+        table[vgetq_lane_u32(idx, 2)], table[vgetq_lane_u32(idx, 3)],
+    };
+    return vld1q_f32(lanes);
+}
+
+uint32x4_t mapChannelNeon(const RowContext &c, float32x4_t v) {
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    const float32x4_t x = vmaxq_f32(v, zero);
+    const float32x4_t a = vdupq_n_f32(kA);
+    const float32x4_t num = vmlaq_f32(
+        vdupq_n_f32(kD * kE), x, vmlaq_f32(vdupq_n_f32(kC * kB), a, x));
+    const float32x4_t den = vmlaq_f32(
+        vdupq_n_f32(kD * kF), x, vmlaq_f32(vdupq_n_f32(kB), a, x));
+    float32x4_t y = vsubq_f32(vdivq_f32(num, den), vdupq_n_f32(kE / kF));
+    y = vmulq_n_f32(y, c.invWhiteCurve);
+    y = vminq_f32(vmaxq_f32(y, zero), vdupq_n_f32(1.0f));
+    const uint32x4_t idx = vcvtq_u32_f32(vmlaq_n_f32(
+        vdupq_n_f32(0.5f), vsqrtq_f32(y), kOetfSize - 1));
+    const uint32_t lanes[4] = {
+        c.oetf[vgetq_lane_u32(idx, 0)], c.oetf[vgetq_lane_u32(idx, 1)],
+        c.oetf[vgetq_lane_u32(idx, 2)], c.oetf[vgetq_lane_u32(idx, 3)],
+    };
+    return vld1q_u32(lanes);
+}
+
+void mapRowNeon(const RowContext &c, const uint32_t *src, uint32_t *dst,
+                int width) {
+    const uint32x4_t mask = vdupq_n_u32(0x3ff);
+    int x = 0;
+    for (; x + 4 <= width; x += 4) {
+        const uint32x4_t p = vld1q_u32(src + x);
+        const float32x4_t b = gatherNeon(c.eotf, vandq_u32(p, mask));
+        const float32x4_t g = gatherNeon(
+            c.eotf, vandq_u32(vshrq_n_u32(p, 10), mask));
+        const float32x4_t r = gatherNeon(
+            c.eotf, vandq_u32(vshrq_n_u32(p, 20), mask));
+
+        auto row = [&](int i) {
+            return vmlaq_n_f32(vmlaq_n_f32(vmulq_n_f32(r, kGamut[i]), g,
+                                           kGamut[i + 1]),
+                               b, kGamut[i + 2]);
+        };
+        const uint32x4_t r8 = mapChannelNeon(c, row(0));
+        const uint32x4_t g8 = mapChannelNeon(c, row(3));
+        const uint32x4_t b8 = mapChannelNeon(c, row(6));
+
+        uint32x4_t out = vorrq_u32(vdupq_n_u32(0xff000000u),
+                                   vshlq_n_u32(r8, 16));
+        out = vorrq_u32(out, vshlq_n_u32(g8, 8));
+        out = vorrq_u32(out, b8);
+        vst1q_u32(dst + x, out);
+    }
+    mapRowScalar(c, src + x, dst + x, width - x);
+}
+#endif
+
+using RowKernel = void (*)(const RowContext &, const uint32_t *, uint32_t *,
+                           int);
+
+RowKernel selectKernel() {
+#ifdef TONEMAP_HAS_AVX2
+    if (libyuv::TestCpuFlag(libyuv::kCpuHasAVX2)) {
+        return mapRowAvx2;
+    }
+#endif
+#ifdef TONEMAP_HAS_NEON
+    return mapRowNeon;
+#endif
+    return mapRowScalar;
+}
+
+const RowKernel g_rowKernel = selectKernel();
+
+// PQ (SMPTE ST 2084) EOTF，返回 nit
+float pqToNits(float e) {
+    constexpr float m1 = 2610.0f / 16384.0f;
+    constexpr float m2 = 2523.0f / 4096.0f * 128.0f;
+    constexpr float c1 = 3424.0f / 4096.0f;
+    constexpr float c2 = 2413.0f / 4096.0f * 32.0f;
+    constexpr float c3 = 2392.0f / 4096.0f * 32.0f;
+    const float p = std::pow(e, 1.0f / m2);
+    return std::pow(std::max(p - c1, 0.0f) / (c2 - c3 * p), 1.0f / m1) *
+           10000.0f;
+}
+
+// HLG 反 OETF + 简化的逐通道 OOTF（系统 gamma 1.2），返回 nit
+float hlgToNits(float e, float peakNits) {
+    constexpr float a = 0.17883277f;
+    constexpr float b = 0.28466892f;
+    constexpr float c = 0.55991073f;
+    const float scene = e <= 0.5f
+                            ? e * e / 3.0f
+                            : (std::exp((e - c) / a) + b) / 12.0f;
+    return peakNits * std::pow(scene, 1.2f);
+}
+}
+
+ToneMapper::HdrInfo ToneMapper::probe(const AVFrame *frame) {
+    HdrInfo info{};
+    if (frame->color_trc == AVCOL_TRC_SMPTE2084) {
+        info.transfer = Transfer::Pq;
+    } else if (frame->color_trc == AVCOL_TRC_ARIB_STD_B67) {
+        info.transfer = Transfer::Hlg;
+        return info;
+    } else {
+        return info;
+    }
+
+    if (auto sd = av_frame_get_side_data(
+        frame, AV_FRAME_DATA_CONTENT_LIGHT_LEVEL)) {
+        auto cll = reinterpret_cast<const AVContentLightMetadata *>(sd->data);
+        if (cll->MaxCLL > 0) {
+            info.peakNits = static_cast<float>(cll->MaxCLL);
+            return info;
+        }
+    }
+    if (auto sd = av_frame_get_side_data(
+        frame, AV_FRAME_DATA_MASTERING_DISPLAY_METADATA)) {
+        auto md = reinterpret_cast<const AVMasteringDisplayMetadata *>(
+            sd->data);
+        if (md->has_luminance && md->max_luminance.num > 0) {
+            info.peakNits = static_cast<float>(av_q2d(md->max_luminance));
+        }
+    }
+    return info;
+}
+
+ToneMapper::ToneMapper(HdrInfo info): mInfo(info), mEotf(1024),
+                                      mOetf(kOetfSize) {
+    mInfo.peakNits = std::max(mInfo.peakNits, kSdrWhiteNits);
+    mWhite = mInfo.peakNits / kSdrWhiteNits;
+    mInvWhiteCurve = 1.0f / hable(mWhite);
+
+    for (int i = 0; i < 1024; ++i) {
+        const float e = i / 1023.0f;
+        float nits;
+        switch (mInfo.transfer) {
+        case Transfer::Pq:
+            nits = pqToNits(e);
+            break;
+        case Transfer::Hlg:
+            nits = hlgToNits(e, mInfo.peakNits);
+            break;
+        default:
+            nits = std::pow(e, 2.4f) * kSdrWhiteNits;
+            break;
+        }
+        mEotf[i] = nits / kSdrWhiteNits;
+    }
+    for (int i = 0; i < kOetfSize; ++i) {
+        const float s = static_cast<float>(i) / (kOetfSize - 1);
+        mOetf[i] = static_cast<uint32_t>(
+            std::lround(std::pow(s * s, 1.0f / 2.2f) * 255.0f));
+    }
+}
+
+void ToneMapper::mapRow(const uint32_t *src, uint32_t *dst, int width) const {
+    const RowContext c{mEotf.data(), mOetf.data(), mInvWhiteCurve};
+    g_rowKernel(c, src, dst, width);
+}
+
+const char *ToneMapper::kernelName() {
+#ifdef TONEMAP_HAS_AVX2
+    if (g_rowKernel == mapRowAvx2) {
+        return "avx2";
+    }
+#endif
+#ifdef TONEMAP_HAS_NEON
+    if (g_rowKernel == mapRowNeon) {
+        return "neon";
+    }
+#endif
+    return "scalar";
+}
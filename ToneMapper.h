@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+struct AVFrame;
+
+// HDR10(PQ) / HLG -> SDR(BT.709) 色调映射。
+// 输入为 libyuv AR30（2:10:10:10，BT.2020 非线性 RGB），输出 ARGB。
+// 流程：EOTF 查表 -> BT.2020 到 BT.709 色域矩阵 -> Hable 曲线 -> gamma 查表，
+// 行内核按 CPU 能力选择 AVX2 / NEON / 标量实现。
+class ToneMapper {
+public:
+    enum class Transfer {
+        Sdr,
+        Pq,
+        Hlg,
+    };
+
+    struct HdrInfo {
+        Transfer transfer{Transfer::Sdr};
+        float peakNits{1000.0f};
+    };
+
+    // 参考白（SDR 100% 亮度）对应的 nit 值
+    static constexpr float kSdrWhiteNits = 203.0f;
+
+    // 根据 color_trc 与 mastering display / content light level 附加数据判断
+    static HdrInfo probe(const AVFrame *frame);
+
+    static bool isHdr(const AVFrame *frame) {
+        return probe(frame).transfer != Transfer::Sdr;
+    }
+
+    explicit ToneMapper(HdrInfo info);
+
+    const HdrInfo &info() const {
+        return mInfo;
+    }
+
+    // 单行映射，src 为 AR30 像素，dst 为 ARGB 像素
+    void mapRow(const uint32_t *src, uint32_t *dst, int width) const;
+
+    // 给 GL 着色器用的 Hable 白点（线性，已按参考白归一化）
+    float whitePoint() const {
+        return mWhite;
+    }
+
+    // 当前行内核名称（avx2 / neon / scalar）
+    static const char *kernelName();
+
+private:
+    HdrInfo mInfo;
+    float mWhite{};
+    float mInvWhiteCurve{};
+    std::vector<float> mEotf;    // 10 位码值 -> 线性光（1.0 = 参考白）
+    std::vector<uint32_t> mOetf; // sqrt(线性光) 量化 -> 8 位 gamma 码值
+};
@@ -0,0 +1,212 @@
+#include "VideoFilterStage.h"
+#include "FFmpegWrapper.h"
+#include <spdlog/spdlog.h>
+
+#define PREFIX  "[VideoFilterStage]"
+
+struct VideoFilterStage::Segment {
+    std::string description;
+    FFmpeg::FilterGraph graph;
+    // 建图失败后直通，直到描述改变，避免逐帧重试
+    bool failed = false;
+};
+
+VideoFilterStage::VideoFilterStage(AVRational timeBase)
+    : mTimeBase(timeBase) {
+    mTask = StageCoroutine::spawn(
+        StagePool::instance(), StagePool::Stage::Decode,
+        [this](std::stop_token token) {
+            return run(token);
+        });
+}
+
+// 先停止协程（mTask 最后声明），通道中剩下的帧随通道释放
+VideoFilterStage::~VideoFilterStage() = default;
+
+void VideoFilterStage::setDescription(const std::string &description) {
+    std::lock_guard lock(mMtx);
+    spdlog::info(PREFIX "filters:\"{}\"", description);
+    mDescription = description;
+}
+
+std::string VideoFilterStage::description() const {
+    std::lock_guard lock(mMtx);
+    return mDescription;
+}
+
+StageChannel<VideoFilterStage::Item>::SendAwaiter VideoFilterStage::push(
+    FrameRef frame, int tag) {
+    // 停止时没有送出的帧不再计数，之后也不会再查 drained
+    ++mInFlight;
+    return mInput.send(Item{std::move(frame), tag, mEpoch.load()});
+}
+
+StageChannel<VideoFilterStage::Item>::ReceiveAwaiter VideoFilterStage::pop() {
+    return mOutput.receive();
+}
+
+void VideoFilterStage::release() {
+    --mInFlight;
+}
+
+bool VideoFilterStage::drained() const {
+    return mInFlight == 0;
+}
+
+void VideoFilterStage::flush() {
+    ++mEpoch;
+    while (mOutput.tryReceive()) {
+        --mInFlight;
+    }
+}
+
+std::vector<VideoFilterStage::Timing> VideoFilterStage::timings() const {
+    std::lock_guard lock(mMtx);
+    return mTimings;
+}
+
+StageCoroutine VideoFilterStage::run(std::stop_token token) {
+    while (!token.stop_requested()) {
+        std::optional<Item> item = co_await mInput.receive();
+        if (!item) {
+            co_return;
+        }
+        const uint64_t epoch = mEpoch;
+        if (item->epoch == epoch) {
+            if (mWorkerEpoch != epoch) {
+                // seek 之后滤镜内部缓存的帧（hqdn3d/yadif 等）已过期
+                for (auto &segment: mSegments) {
+                    segment->graph.Close();
+                }
+                mWorkerEpoch = epoch;
+            }
+            // 输出通道满时挂起等下游取走；seek 后剩下的直接丢弃。
+            // 先计入输出再减去输入，drained 不会在途中误报
+            std::vector<FrameRef> outputs = process(item->frame.release());
+            mInFlight += static_cast<int>(outputs.size());
+            for (FrameRef &output: outputs) {
+                if (epoch != mEpoch) {
+                    --mInFlight;
+                    continue;
+                }
+                // GCC 12 会错误地析构 co_await 操作数里的花括号临时对象，
+                // 先放进具名变量
+                Item filtered{std::move(output), item->tag, epoch};
+                if (!co_await mOutput.send(std::move(filtered))) {
+                    co_return;
+                }
+            }
+        }
+        --mInFlight;
+    }
+}
+
+std::vector<FrameRef> VideoFilterStage::process(AVFrame *frame) {
+    const std::string description = this->description();
+    if (description != mBuiltDescription) {
+        mSegments.clear();
+        for (const std::string &filter: splitChain(description)) {
+            auto segment = std::make_unique<Segment>();
+            segment->description = filter;
+            mSegments.push_back(std::move(segment));
+        }
+        mBuiltDescription = description;
+    }
+
+    std::vector<AVFrame *> current;
+    if (frame) {
+        current.push_back(frame);
+    }
+    // 每段按上一段输出的时间基建图
+    AVRational timeBase = mTimeBase;
+    for (auto &segment: mSegments) {
+        std::vector<AVFrame *> next;
+        for (AVFrame *input: current) {
+            if (!segment->failed &&
+                !segment->graph.Matches(input, segment->description) &&
+                segment->graph.Init(input, timeBase,
+                                    segment->description) < 0) {
+                spdlog::error(PREFIX "filter \"{}\" unavailable, bypassed",
+                              segment->description);
+                segment->failed = true;
+            }
+            if (segment->failed ||
+                segment->graph.Filter(input, next).hasErr()) {
+                next.push_back(input);
+                continue;
+            }
+            av_frame_free(&input);
+        }
+        // 排空会关闭滤镜图，先取输出时间基
+        if (segment->graph.IsOpen()) {
+            timeBase = segment->graph.OutputTimeBase();
+        }
+        // 上游排空的帧已送入本滤镜，再排空本滤镜
+        if (!frame && segment->graph.Drain(next).hasErr()) {
+            spdlog::error(PREFIX "filter \"{}\" drain failed",
+                          segment->description);
+        }
+        current.swap(next);
+    }
+
+    {
+        std::lock_guard lock(mMtx);
+        mTimings.clear();
+        for (const auto &segment: mSegments) {
+            mTimings.push_back({
+                segment->description, segment->graph.Frames(),
+                segment->graph.LastMs(), segment->graph.AverageMs(),
+                segment->graph.MaxMs()
+            });
+        }
+    }
+
+    // 下游按流的时间基换算，输出换回输入时间基
+    std::vector<FrameRef> outputs;
+    for (AVFrame *output: current) {
+        if (output->pts != AV_NOPTS_VALUE &&
+            av_cmp_q(timeBase, mTimeBase) != 0) {
+            output->pts = av_rescale_q(output->pts, timeBase, mTimeBase);
+        }
+        outputs.emplace_back(output);
+    }
+    return outputs;
+}
+
+std::vector<std::string> VideoFilterStage::splitChain(
+    const std::string &description) {
+    std::vector<std::string> filters;
+    if (description.empty()) {
+        return filters;
+    }
+    // 带标签或多条链的描述无法按滤镜拆分
+    if (description.find_first_of("[;") != std::string::npos) {
+        filters.push_back(description);
+        return filters;
+    }
+    std::string current;
+    bool quoted = false;
+    for (size_t i = 0; i < description.size(); ++i) {
+        const char c = description[i];
+        if (c == '\\' && i + 1 < description.size()) {
+            current += c;
+            current += description[++i];
+            continue;
+        }
+        if (c == '\'') {
+            quoted = !quoted;
+        }
+        if (c == ',' && !quoted) {
+            if (!current.empty()) {
+                filters.push_back(current);
+            }
+            current.clear();
+            continue;
+        }
+        current += c;
+    }
+    if (!current.empty()) {
+        filters.push_back(current);
+    }
+    return filters;
+}
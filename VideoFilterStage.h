@@ -0,0 +1,100 @@
+#pragma once
+
+#include "StageCoroutine.h"
+#include "VideoSink.h"
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavutil/rational.h>
+}
+
+struct AVFrame;
+
+// libavfilter 滤镜阶段，是 StagePool 上（解码优先级）的协程，位于两个
+// 有界通道之间：解码阶段 co_await push 送入解码帧，下游 co_await pop
+// 取出滤镜输出，滤镜耗时不阻塞解码和呈现。任何一方等数据或空位时
+// 挂起，由对端唤醒，不轮询。
+// 滤镜描述（如 "crop=1280:720,hqdn3d,scale=1920:-2"）按顶层逗号拆成
+// 逐个滤镜的子图，以便分别统计耗时；含标签或 ';' 的复杂描述作为整体运行。
+// 输入尺寸/格式或描述变化时在下一帧惰性重建。
+class VideoFilterStage {
+public:
+    static constexpr int kQueueSize = 8;
+
+    // tag 由送入方给出（seek 代数），原样带到由该帧产生的输出帧上
+    struct Item {
+        FrameRef frame;
+        int tag = 0;
+        uint64_t epoch = 0;
+    };
+
+    struct Timing {
+        std::string filter;
+        uint64_t frames = 0;
+        double lastMs = 0.0;
+        double averageMs = 0.0;
+        double maxMs = 0.0;
+    };
+
+    // timeBase 为输入帧的时间基，输出帧换算回同一时间基
+    explicit VideoFilterStage(AVRational timeBase);
+    ~VideoFilterStage();
+
+    VideoFilterStage(const VideoFilterStage &) = delete;
+    VideoFilterStage &operator=(const VideoFilterStage &) = delete;
+
+    // 线程安全，空字符串表示直通
+    void setDescription(const std::string &description);
+
+    std::string description() const;
+
+    // 在协程中 co_await，输入通道满时挂起；返回 false 表示已请求停止。
+    // 空帧表示输入结束（EOF）：排空各滤镜缓存的帧，之后的帧重建滤镜
+    StageChannel<Item>::SendAwaiter push(FrameRef frame, int tag);
+
+    // 在协程中 co_await，没有输出时挂起；已请求停止时为空。
+    // 取到的帧交给下游之后调用 release()
+    StageChannel<Item>::ReceiveAwaiter pop();
+
+    void release();
+
+    // 送入的帧都已处理完，输出也都已被取走并 release
+    bool drained() const;
+
+    // 丢弃输出通道中的帧和滤镜内部缓存（seek 后由送入方调用）
+    void flush();
+
+    // 各滤镜的耗时统计
+    std::vector<Timing> timings() const;
+
+private:
+    struct Segment;
+
+    StageCoroutine run(std::stop_token token);
+
+    // 依次经过各个滤镜，返回输出帧（可能为 0 或多帧）。
+    // frame 为空时排空各滤镜
+    std::vector<FrameRef> process(AVFrame *frame);
+
+    static std::vector<std::string> splitChain(const std::string &description);
+
+    AVRational mTimeBase;
+    mutable std::mutex mMtx; // 保护 mDescription 与 mTimings
+    std::string mDescription;
+    std::vector<Timing> mTimings;
+    std::vector<std::unique_ptr<Segment>> mSegments; // 仅工作线程访问
+    std::string mBuiltDescription;
+    std::atomic<uint64_t> mEpoch{0};
+    uint64_t mWorkerEpoch = 0; // 仅协程访问
+    // 已 push 还没处理完的输入帧，加上还没 release 的输出帧
+    std::atomic_int mInFlight{0};
+    StageChannel<Item> mInput{kQueueSize};
+    StageChannel<Item> mOutput{kQueueSize};
+    // 最后声明，析构时先停止协程
+    StageCoroutine::Handle mTask;
+};
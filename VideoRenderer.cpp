@@ -0,0 +1,43 @@
+#include "VideoRenderer.h"
+#include "PlayerWidget.h"
+#include "OpenglPlayWidget.h"
+#include "PlayerController.h"
+
+PlayerController *VideoRenderer::attach(PlayerController *controller) {
+    controller->AddVideoSink(this);
+    connectVisibility(controller, [controller](bool visible) {
+        controller->SetVideoVisible(visible);
+    });
+    connectVsyncPacing(controller, [controller](bool enable) {
+        controller->SetVsyncPacing(enable);
+    });
+    controller->SetVideoVisible(widget()->isVisible());
+    controller->SetVsyncPacing(vsyncPacing());
+    return controller;
+}
+
+VideoRenderer *VideoRenderer::create(Kind kind, QWidget *parent) {
+    switch (kind) {
+    case Kind::OpenGL:
+        return new OpenglPlayWidget{parent};
+    case Kind::Cpu:
+    default:
+        return new PlayerWidget{parent};
+    }
+}
+
+const char *VideoRenderer::name(Kind kind) {
+    return kind == Kind::OpenGL ? "gl" : "cpu";
+}
+
+bool VideoRenderer::fromName(const QString &name, Kind &kind) {
+    if (name == "gl" || name == "opengl") {
+        kind = Kind::OpenGL;
+        return true;
+    }
+    if (name == "cpu" || name == "qpainter") {
+        kind = Kind::Cpu;
+        return true;
+    }
+    return false;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "CommonDef.h"
+#include "VideoSink.h"
+#include <QMetaObject>
+#include <QString>
+#include <functional>
+
+class PlayerController;
+
+// 显示后端的公共接口，PlayerWidget（QPainter）与 OpenglPlayWidget 都实现它，
+// 运行时选择后端。作为 VideoSink 挂在 PlayerController 上
+class VideoRenderer : public VideoSink {
+public:
+    enum class Kind {
+        Cpu,
+        OpenGL,
+    };
+
+    ~VideoRenderer() override = default;
+
+    // 后端本身的控件，用于布局
+    virtual QWidget *widget() = 0;
+
+    virtual Kind kind() const = 0;
+
+    virtual bool vsyncPacing() const {
+        return false;
+    }
+
+    // 控件显示/隐藏时回调，receiver 销毁后自动断开
+    virtual QMetaObject::Connection connectVisibility(
+        QObject *receiver, std::function<void(bool)> callback) = 0;
+
+    // 节拍模式切换时回调，不支持节拍的后端不会触发
+    virtual QMetaObject::Connection connectVsyncPacing(
+        QObject *receiver, std::function<void(bool)> callback) {
+        (void)receiver;
+        (void)callback;
+        return {};
+    }
+
+    // 作为 controller 的第一个接收端，同步可见性和节拍模式。
+    // 本对象需比 controller 活得久，返回 controller
+    PlayerController *attach(PlayerController *controller);
+
+    static VideoRenderer *create(Kind kind, QWidget *parent = nullptr);
+
+    static const char *name(Kind kind);
+
+    // "cpu" / "gl"，无法识别时返回 false
+    static bool fromName(const QString &name, Kind &kind);
+};
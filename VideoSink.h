@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QtGlobal>
+#include <utility>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+// AVFrame 引用的 RAII 句柄。复制只增加缓冲区引用计数，不拷贝像素
+class FrameRef {
+public:
+    FrameRef() = default;
+
+    // 接管 frame 的所有权
+    explicit FrameRef(AVFrame *frame): mFrame(frame) {}
+
+    // 对 frame 新建一个引用，调用方仍持有原来的引用
+    static FrameRef ref(const AVFrame *frame) {
+        return FrameRef{frame ? av_frame_clone(frame) : nullptr};
+    }
+
+    FrameRef(const FrameRef &other): mFrame(
+        other.mFrame ? av_frame_clone(other.mFrame) : nullptr) {}
+
+    FrameRef(FrameRef &&other) noexcept: mFrame(
+        std::exchange(other.mFrame, nullptr)) {}
+
+    FrameRef &operator=(FrameRef other) noexcept {
+        std::swap(mFrame, other.mFrame);
+        return *this;
+    }
+
+    ~FrameRef() {
+        av_frame_free(&mFrame);
+    }
+
+    AVFrame *get() const {
+        return mFrame;
+    }
+
+    AVFrame *operator->() const {
+        return mFrame;
+    }
+
+    explicit operator bool() const {
+        return mFrame != nullptr;
+    }
+
+    // 交出所有权，调用方负责 av_frame_free
+    AVFrame *release() {
+        return std::exchange(mFrame, nullptr);
+    }
+
+private:
+    AVFrame *mFrame{};
+};
+
+// 视频帧的接收端（显示、录制、分析……）。PlayerController 可同时挂多个，
+// 在视频线程按注册顺序直接调用，不经过 Qt 元对象系统。
+// 回调中的 frame 是借用的引用，需要保留时复制 FrameRef（只加引用计数）。
+// 回调里不能再调用 AddVideoSink/RemoveVideoSink。
+class VideoSink {
+public:
+    virtual ~VideoSink() = default;
+
+    virtual void onVideoFrame(const FrameRef &frame) = 0;
+
+    // 节拍模式下提前送达的帧，dueUs 为预定呈现时间（system_clock 微秒）。
+    // 默认按普通帧处理
+    virtual void onVideoFrameScheduled(const FrameRef &frame, qint64 dueUs) {
+        (void)dueUs;
+        onVideoFrame(frame);
+    }
+
+    // 显示矩阵的顺时针旋转角度，Open 时在调用线程通知
+    virtual void onVideoRotation(int rotation) {
+        (void)rotation;
+    }
+
+    // 显示控件隐藏时仍需要每一帧（录制、分析），控制器因此不跳过解码
+    virtual bool alwaysActive() const {
+        return false;
+    }
+};
@@ -0,0 +1,359 @@
+#include "VideoWallWidget.h"
+
+#include "YuvConverter.h"
+#include "RepaintCoalescer.h"
+#include <QElapsedTimer>
+#include <QPainter>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+
+#include <spdlog/spdlog.h>
+#include <spdlog/fmt/fmt.h>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#define PREFIX  "[VideoWallWidget]"
+
+namespace {
+constexpr int kStatsIntervalMs = 1000;
+}
+
+struct VideoWallWidget::Tile : VideoSink {
+    Tile(Impl *wall, int index): wall(wall), index(index) {}
+
+    void onVideoFrame(const FrameRef &frame) override;
+
+    void onVideoRotation(int value) override {
+        std::lock_guard lock(mtx);
+        rotation = value;
+    }
+
+    Impl *wall;
+    const int index;
+    std::mutex mtx;
+    FrameRef last;
+    int rotation = 0;
+    // 已转换到图集、尚未上传
+    bool dirty = false;
+    // 上次转换的画面尺寸，变化时先清空格子（黑边）
+    QSize drawn;
+    // 每格独立转换，不与其他格子争用共享线程池
+    YuvConverter converter{1};
+    TileStats stats;
+    uint64_t presentedAtWindow = 0;
+};
+
+struct VideoWallWidget::Impl {
+    // 图集布局；格子转换持共享锁，重新排布持独占锁
+    std::shared_mutex layoutMtx;
+    int cols = 0;
+    int rows = 0;
+    int tileW = 0;
+    int tileH = 0;
+    int stride = 0;
+    std::vector<uint8_t> atlas;
+    std::vector<std::unique_ptr<Tile>> tiles;
+    unsigned int textureId = 0;
+    bool textureAllocated = false;
+    std::unique_ptr<RepaintCoalescer> repaint;
+    bool overlay = true;
+    QElapsedTimer statsTimer;
+
+    // 需持有 layoutMtx（共享）和 tile.mtx
+    void renderTile(Tile &tile) {
+        const AVFrame *frame = tile.last.get();
+        if (!frame || tileW <= 0 || tileH <= 0 ||
+            !YuvConverter::isSupported(frame->format)) {
+            return;
+        }
+        const bool swap = tile.rotation == 90 || tile.rotation == 270;
+        const int srcW = swap ? frame->height : frame->width;
+        const int srcH = swap ? frame->width : frame->height;
+        const QRect cell{
+            (tile.index % cols) * tileW, (tile.index / cols) * tileH, tileW,
+            tileH
+        };
+        const QRect dst = fit(cell, srcW, srcH);
+        if (dst.size() != tile.drawn) {
+            for (int y = cell.top(); y <= cell.bottom(); ++y) {
+                std::memset(atlas.data() + static_cast<size_t>(y) * stride +
+                            cell.left() * 4, 0, cell.width() * 4);
+            }
+            tile.drawn = dst.size();
+        }
+        tile.converter.convertScaled(
+            frame, atlas.data() + static_cast<size_t>(dst.top()) * stride +
+                   dst.left() * 4, stride, dst.width() & ~1,
+            dst.height() & ~1, tile.rotation);
+        tile.dirty = true;
+    }
+
+    // 保持比例居中
+    static QRect fit(const QRect &outer, int w, int h) {
+        if (w <= 0 || h <= 0) {
+            return outer;
+        }
+        const bool widthLimited = outer.width() * h < outer.height() * w;
+        const int scaledW = widthLimited ? outer.width() : w * outer.height() / h;
+        const int scaledH = widthLimited ? h * outer.width() / w : outer.height();
+        return {
+            outer.left() + (outer.width() - scaledW) / 2,
+            outer.top() + (outer.height() - scaledH) / 2,
+            std::max(scaledW, 2), std::max(scaledH, 2)
+        };
+    }
+
+    // 需持有 layoutMtx（独占）。按控件像素尺寸重新切分图集并重画各格
+    void layout(int width, int height) {
+        const int count = static_cast<int>(tiles.size());
+        cols = count > 0 ? static_cast<int>(std::ceil(std::sqrt(count))) : 0;
+        rows = cols > 0 ? (count + cols - 1) / cols : 0;
+        tileW = cols > 0 ? (width / cols) & ~1 : 0;
+        tileH = rows > 0 ? (height / rows) & ~1 : 0;
+        stride = cols * tileW * 4;
+        atlas.assign(static_cast<size_t>(stride) * rows * tileH, 0);
+        textureAllocated = false;
+        for (auto &tile: tiles) {
+            std::lock_guard lock(tile->mtx);
+            tile->drawn = {};
+            renderTile(*tile);
+        }
+    }
+};
+
+void VideoWallWidget::Tile::onVideoFrame(const FrameRef &frame) {
+    {
+        std::shared_lock layout(wall->layoutMtx);
+        std::lock_guard lock(mtx);
+        ++stats.received;
+        if (dirty) {
+            ++stats.dropped;
+        }
+        last = frame;
+        wall->renderTile(*this);
+    }
+    // 解码线程不直接 update()，由刷新节拍合并
+    wall->repaint->markDirty();
+}
+
+VideoWallWidget::VideoWallWidget(QWidget *parent): QOpenGLWidget(parent),
+    mImpl(new Impl{}) {
+    mImpl->repaint = std::make_unique<RepaintCoalescer>(this);
+    QSurfaceFormat fmt = format();
+    fmt.setSwapInterval(1);
+    setFormat(fmt);
+    mImpl->statsTimer.start();
+}
+
+VideoWallWidget::~VideoWallWidget() {
+    if (!mImpl->tiles.empty()) {
+        spdlog::info(PREFIX "{}", report());
+    }
+    makeCurrent();
+    if (mImpl->textureId) {
+        glDeleteTextures(1, &mImpl->textureId);
+    }
+    doneCurrent();
+    delete mImpl;
+}
+
+void VideoWallWidget::setTileCount(int count) {
+    const QSize before = tileSize();
+    {
+        std::unique_lock layout(mImpl->layoutMtx);
+        mImpl->tiles.clear();
+        for (int i = 0; i < std::max(count, 0); ++i) {
+            mImpl->tiles.push_back(std::make_unique<Tile>(mImpl, i));
+        }
+        const qreal ratio = devicePixelRatioF();
+        mImpl->layout(static_cast<int>(width() * ratio),
+                      static_cast<int>(height() * ratio));
+    }
+    if (tileSize() != before) {
+        emit tileSizeChanged(tileSize());
+    }
+}
+
+int VideoWallWidget::tileCount() const {
+    std::shared_lock layout(mImpl->layoutMtx);
+    return static_cast<int>(mImpl->tiles.size());
+}
+
+VideoSink *VideoWallWidget::tileSink(int index) const {
+    std::shared_lock layout(mImpl->layoutMtx);
+    if (index < 0 || index >= static_cast<int>(mImpl->tiles.size())) {
+        return nullptr;
+    }
+    return mImpl->tiles[index].get();
+}
+
+QSize VideoWallWidget::tileSize() const {
+    std::shared_lock layout(mImpl->layoutMtx);
+    return {mImpl->tileW, mImpl->tileH};
+}
+
+void VideoWallWidget::setStatsOverlay(bool enable) {
+    mImpl->overlay = enable;
+    update();
+}
+
+std::vector<VideoWallWidget::TileStats> VideoWallWidget::stats() const {
+    std::shared_lock layout(mImpl->layoutMtx);
+    std::vector<TileStats> result;
+    for (auto &tile: mImpl->tiles) {
+        std::lock_guard lock(tile->mtx);
+        result.push_back(tile->stats);
+    }
+    return result;
+}
+
+std::string VideoWallWidget::report() const {
+    std::string text = fmt::format("{} tiles", tileCount());
+    const auto all = stats();
+    for (size_t i = 0; i < all.size(); ++i) {
+        text += fmt::format(" | #{} {:.1f}fps presented={} dropped={}", i,
+                            all[i].fps, all[i].presented, all[i].dropped);
+    }
+    return text;
+}
+
+void VideoWallWidget::initializeGL() {
+    initializeOpenGLFunctions();
+    glEnable(GL_TEXTURE_2D);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+    glGenTextures(1, &mImpl->textureId);
+    glBindTexture(GL_TEXTURE_2D, mImpl->textureId);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    // 上下文重建后纹理为空，需要整张重新上传
+    std::unique_lock layout(mImpl->layoutMtx);
+    mImpl->textureAllocated = false;
+}
+
+void VideoWallWidget::resizeGL(int w, int h) {
+    glViewport(0, 0, w, h);
+    const QSize before = tileSize();
+    {
+        std::unique_lock layout(mImpl->layoutMtx);
+        const qreal ratio = devicePixelRatioF();
+        mImpl->layout(static_cast<int>(w * ratio),
+                      static_cast<int>(h * ratio));
+    }
+    if (tileSize() != before) {
+        emit tileSizeChanged(tileSize());
+    }
+}
+
+void VideoWallWidget::paintGL() {
+    // 上一次叠加文字时 QPainter 可能改过视口
+    const qreal ratio = devicePixelRatioF();
+    glViewport(0, 0, static_cast<int>(width() * ratio),
+               static_cast<int>(height() * ratio));
+    glClear(GL_COLOR_BUFFER_BIT);
+    std::shared_lock layout(mImpl->layoutMtx);
+    const int atlasW = mImpl->cols * mImpl->tileW;
+    const int atlasH = mImpl->rows * mImpl->tileH;
+    if (atlasW <= 0 || atlasH <= 0) {
+        return;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, mImpl->textureId);
+    if (!mImpl->textureAllocated) {
+        // 整张上传，之后只更新变化的格子
+        for (auto &tile: mImpl->tiles) {
+            tile->mtx.lock();
+        }
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_BGRA, atlasW, atlasH, 0, GL_BGRA,
+                     GL_UNSIGNED_BYTE, mImpl->atlas.data());
+        for (auto &tile: mImpl->tiles) {
+            if (tile->dirty) {
+                tile->dirty = false;
+                ++tile->stats.presented;
+            }
+            tile->mtx.unlock();
+        }
+        mImpl->textureAllocated = true;
+    } else {
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, atlasW);
+        for (auto &tile: mImpl->tiles) {
+            std::lock_guard lock(tile->mtx);
+            if (!tile->dirty) {
+                continue;
+            }
+            const int x = (tile->index % mImpl->cols) * mImpl->tileW;
+            const int y = (tile->index / mImpl->cols) * mImpl->tileH;
+            glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, mImpl->tileW,
+                            mImpl->tileH, GL_BGRA, GL_UNSIGNED_BYTE,
+                            mImpl->atlas.data() + static_cast<size_t>(y) *
+                            mImpl->stride + x * 4);
+            tile->dirty = false;
+            ++tile->stats.presented;
+        }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    }
+
+    // 图集与屏幕同一布局，整面墙一个四边形
+    glEnable(GL_TEXTURE_2D);
+    glBegin(GL_QUADS);
+    glTexCoord2f(0.0f, 1.0f);
+    glVertex2f(-1.0f, -1.0f);
+    glTexCoord2f(1.0f, 1.0f);
+    glVertex2f(1.0f, -1.0f);
+    glTexCoord2f(1.0f, 0.0f);
+    glVertex2f(1.0f, 1.0f);
+    glTexCoord2f(0.0f, 0.0f);
+    glVertex2f(-1.0f, 1.0f);
+    glEnd();
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    const qint64 elapsed = mImpl->statsTimer.elapsed();
+    if (elapsed >= kStatsIntervalMs) {
+        for (auto &tile: mImpl->tiles) {
+            std::lock_guard lock(tile->mtx);
+            tile->stats.fps = (tile->stats.presented - tile->presentedAtWindow)
+                              * 1000.0 / elapsed;
+            tile->presentedAtWindow = tile->stats.presented;
+        }
+        mImpl->statsTimer.restart();
+    }
+    if (!mImpl->overlay) {
+        return;
+    }
+    // 叠加文字用逻辑坐标
+    QPainter painter(this);
+    painter.setPen(Qt::yellow);
+    for (auto &tile: mImpl->tiles) {
+        TileStats stats;
+        {
+            std::lock_guard lock(tile->mtx);
+            stats = tile->stats;
+        }
+        const QPointF origin{
+            (tile->index % mImpl->cols) * mImpl->tileW / ratio + 4,
+            (tile->index / mImpl->cols) * mImpl->tileH / ratio + 14
+        };
+        painter.drawText(origin, QString("#%1 %2fps drop %3")
+                                 .arg(tile->index)
+                                 .arg(stats.fps, 0, 'f', 1)
+                                 .arg(stats.dropped));
+    }
+}
+
+void VideoWallWidget::showEvent(QShowEvent *event) {
+    mImpl->repaint->start();
+    QOpenGLWidget::showEvent(event);
+}
+
+void VideoWallWidget::hideEvent(QHideEvent *event) {
+    mImpl->repaint->stop();
+    QOpenGLWidget::hideEvent(event);
+}
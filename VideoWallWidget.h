@@ -0,0 +1,65 @@
+#pragma once
+
+#include "VideoSink.h"
+#include <QOpenGLWidget>
+#include <QOpenGLFunctions>
+#include <string>
+#include <vector>
+
+// 视频墙：N 路视频排成网格，合成到同一个 GL 控件。
+// 所有格子共用一张图集纹理：各路在自己的解码线程上直接缩放转换到图集的
+// 对应区域，每次刷新只上传有变化的格子，整面墙一次绘制、一次交换；
+// 重绘按显示刷新率合并，每个 vsync 最多一次。
+class VideoWallWidget : public QOpenGLWidget, protected QOpenGLFunctions {
+    Q_OBJECT
+
+public:
+    struct TileStats {
+        uint64_t received = 0;
+        uint64_t presented = 0;
+        // 上屏前就被下一帧覆盖的帧
+        uint64_t dropped = 0;
+        double fps = 0.0;
+    };
+
+    explicit VideoWallWidget(QWidget *parent = nullptr);
+    ~VideoWallWidget() override;
+
+    // 重新排布为 count 格（列数取 ceil(sqrt(count))），之前的接收端失效
+    void setTileCount(int count);
+
+    int tileCount() const;
+
+    // 第 index 格的接收端，挂到对应的 PlayerController 上
+    VideoSink *tileSink(int index) const;
+
+    // 当前每格的像素尺寸，可作为 PlayerController::SetDecodeSizeHint
+    QSize tileSize() const;
+
+    // 在画面上叠加每格的帧率和丢帧数（默认开启）
+    void setStatsOverlay(bool enable);
+
+    std::vector<TileStats> stats() const;
+
+    std::string report() const;
+
+Q_SIGNALS:
+    // 每格像素尺寸变了（窗口缩放、重新排布），可据此更新解码尺寸提示
+    void tileSizeChanged(QSize size);
+
+protected:
+    void initializeGL() override;
+
+    void resizeGL(int w, int h) override;
+
+    void paintGL() override;
+
+    void showEvent(QShowEvent *event) override;
+
+    void hideEvent(QHideEvent *event) override;
+
+private:
+    struct Tile;
+    struct Impl;
+    Impl *mImpl{};
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <QPointF>
+#include <QRect>
+#include <algorithm>
+
+// 数字变焦/平移状态，坐标均为归一化源坐标（0..1）。
+// 渲染时只裁剪 sourceRect() 这块区域再转换/缩放，代价与可见区域成正比。
+struct ViewZoom {
+    static constexpr double kMaxZoom = 16.0;
+    static constexpr double kWheelStep = 1.15;
+
+    double zoom = 1.0;
+    QPointF origin{0.0, 0.0}; // 可见区域左上角
+
+    bool active() const {
+        return zoom > 1.0;
+    }
+
+    void reset() {
+        zoom = 1.0;
+        origin = {0.0, 0.0};
+    }
+
+    // anchor 为光标在画面内的归一化位置，缩放后该点保持不动
+    void zoomAt(QPointF anchor, double factor) {
+        const QPointF point = origin + anchor / zoom;
+        zoom = std::clamp(zoom * factor, 1.0, kMaxZoom);
+        origin = point - anchor / zoom;
+        clampOrigin();
+    }
+
+    // delta 为画面内的归一化拖动距离
+    void panBy(QPointF delta) {
+        origin -= delta / zoom;
+        clampOrigin();
+    }
+
+    // 源帧中的可见矩形，按 2 像素对齐（兼容 4:2:0 色度下采样）
+    QRect sourceRect(int width, int height) const {
+        if (!active()) {
+            return {0, 0, width, height};
+        }
+        const int w = std::max(2, static_cast<int>(width / zoom)) & ~1;
+        const int h = std::max(2, static_cast<int>(height / zoom)) & ~1;
+        const int x = std::clamp(static_cast<int>(origin.x() * width) & ~1,
+                                 0, (width - w) & ~1);
+        const int y = std::clamp(static_cast<int>(origin.y() * height) & ~1,
+                                 0, (height - h) & ~1);
+        return {x, y, w, h};
+    }
+
+    // 画面（已按 rotation 顺时针旋转）内的归一化坐标 -> 源帧方向
+    static QPointF toSource(QPointF p, int rotation) {
+        switch (rotation) {
+        case 90:
+            return {p.y(), 1.0 - p.x()};
+        case 180:
+            return {1.0 - p.x(), 1.0 - p.y()};
+        case 270:
+            return {1.0 - p.y(), p.x()};
+        default:
+            return p;
+        }
+    }
+
+    static QPointF toSourceDelta(QPointF d, int rotation) {
+        return toSource(d, rotation) - toSource({0.0, 0.0}, rotation);
+    }
+
+private:
+    void clampOrigin() {
+        const double limit = 1.0 - 1.0 / zoom;
+        origin.setX(std::clamp(origin.x(), 0.0, limit));
+        origin.setY(std::clamp(origin.y(), 0.0, limit));
+    }
+};
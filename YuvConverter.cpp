@@ -0,0 +1,674 @@
+#include "YuvConverter.h"
+#include "StripePool.h"
+#include "ToneMapper.h"
+#include <spdlog/spdlog.h>
+#include <libyuv/compare.h>
+#include <libyuv/convert_argb.h>
+#include <libyuv/rotate_argb.h>
+#include <libyuv/scale_argb.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+#include <libavutil/pixdesc.h>
+}
+
+#define PREFIX  "[YuvConverter]"
+
+namespace {
+// 每种像素格式对应一个 libyuv 内核，按条带调用，不经过中间格式。
+// 色彩矩阵/范围作为模板参数编进内核，逐帧只在入口查表一次
+using StripeKernel = void (*)(const AVFrame *frame, int y0, int rows,
+                              uint8_t *dst, int dstStride);
+
+enum ColorMatrix {
+    kBt601,
+    kBt709,
+    kBt2020,
+    kMatrixCount,
+};
+
+enum ColorRange {
+    kLimited,
+    kFull,
+    kRangeCount,
+};
+
+using KernelTable = std::array<std::array<StripeKernel, kRangeCount>,
+                               kMatrixCount>;
+
+struct FormatKernel {
+    int format;
+    int chromaShiftY; // 色度垂直下采样，条带起点需按 1 << chromaShiftY 对齐
+    bool fullRange;   // YUVJ 格式隐含全范围
+    KernelTable argb;
+    KernelTable ar30{}; // 10 位格式输出 AR30，供 HDR 色调映射使用
+};
+
+template <typename T = uint8_t>
+const T *planeRow(const AVFrame *frame, int plane, int row) {
+    return reinterpret_cast<const T *>(frame->data[plane] +
+                                       row * frame->linesize[plane]);
+}
+
+// libyuv 16 位接口的 stride 以元素计
+int stride16(const AVFrame *frame, int plane) {
+    return frame->linesize[plane] / 2;
+}
+
+template <auto Convert, int ShiftY>
+struct Planar {
+    template <const libyuv::YuvConstants *Matrix>
+    static void stripe(const AVFrame *frame, int y0, int rows, uint8_t *dst,
+                       int dstStride) {
+        Convert(planeRow(frame, 0, y0), frame->linesize[0],
+                planeRow(frame, 1, y0 >> ShiftY), frame->linesize[1],
+                planeRow(frame, 2, y0 >> ShiftY), frame->linesize[2],
+                dst, dstStride, Matrix, frame->width, rows);
+    }
+};
+
+template <auto Convert, int ShiftY>
+struct Planar16 {
+    template <const libyuv::YuvConstants *Matrix>
+    static void stripe(const AVFrame *frame, int y0, int rows, uint8_t *dst,
+                       int dstStride) {
+        Convert(planeRow<uint16_t>(frame, 0, y0), stride16(frame, 0),
+                planeRow<uint16_t>(frame, 1, y0 >> ShiftY),
+                stride16(frame, 1),
+                planeRow<uint16_t>(frame, 2, y0 >> ShiftY),
+                stride16(frame, 2),
+                dst, dstStride, Matrix, frame->width, rows);
+    }
+};
+
+template <auto Convert>
+struct SemiPlanar {
+    template <const libyuv::YuvConstants *Matrix>
+    static void stripe(const AVFrame *frame, int y0, int rows, uint8_t *dst,
+                       int dstStride) {
+        Convert(planeRow(frame, 0, y0), frame->linesize[0],
+                planeRow(frame, 1, y0 >> 1), frame->linesize[1],
+                dst, dstStride, Matrix, frame->width, rows);
+    }
+};
+
+template <auto Convert>
+struct SemiPlanar16 {
+    template <const libyuv::YuvConstants *Matrix>
+    static void stripe(const AVFrame *frame, int y0, int rows, uint8_t *dst,
+                       int dstStride) {
+        Convert(planeRow<uint16_t>(frame, 0, y0), stride16(frame, 0),
+                planeRow<uint16_t>(frame, 1, y0 >> 1), stride16(frame, 1),
+                dst, dstStride, Matrix, frame->width, rows);
+    }
+};
+
+// 展开 (矩阵, 范围) 的全部组合
+template <typename Stripe>
+constexpr KernelTable makeTable() {
+    using namespace libyuv;
+    return {{
+        {
+            Stripe::template stripe<&kYuvI601Constants>,
+            Stripe::template stripe<&kYuvJPEGConstants>
+        },
+        {
+            Stripe::template stripe<&kYuvH709Constants>,
+            Stripe::template stripe<&kYuvF709Constants>
+        },
+        {
+            Stripe::template stripe<&kYuv2020Constants>,
+            Stripe::template stripe<&kYuvV2020Constants>
+        },
+    }};
+}
+
+const FormatKernel kFormatKernels[] = {
+    {
+        AV_PIX_FMT_YUV420P, 1, false,
+        makeTable<Planar<libyuv::I420ToARGBMatrix, 1>>()
+    },
+    {
+        AV_PIX_FMT_YUVJ420P, 1, true,
+        makeTable<Planar<libyuv::I420ToARGBMatrix, 1>>()
+    },
+    {
+        AV_PIX_FMT_YUV422P, 0, false,
+        makeTable<Planar<libyuv::I422ToARGBMatrix, 0>>()
+    },
+    {
+        AV_PIX_FMT_YUVJ422P, 0, true,
+        makeTable<Planar<libyuv::I422ToARGBMatrix, 0>>()
+    },
+    {
+        AV_PIX_FMT_YUV444P, 0, false,
+        makeTable<Planar<libyuv::I444ToARGBMatrix, 0>>()
+    },
+    {
+        AV_PIX_FMT_YUVJ444P, 0, true,
+        makeTable<Planar<libyuv::I444ToARGBMatrix, 0>>()
+    },
+    {
+        AV_PIX_FMT_NV12, 1, false,
+        makeTable<SemiPlanar<libyuv::NV12ToARGBMatrix>>()
+    },
+    {
+        AV_PIX_FMT_YUV420P10LE, 1, false,
+        makeTable<Planar16<libyuv::I010ToARGBMatrix, 1>>(),
+        makeTable<Planar16<libyuv::I010ToAR30Matrix, 1>>()
+    },
+    {
+        AV_PIX_FMT_YUV422P10LE, 0, false,
+        makeTable<Planar16<libyuv::I210ToARGBMatrix, 0>>(),
+        makeTable<Planar16<libyuv::I210ToAR30Matrix, 0>>()
+    },
+    {
+        AV_PIX_FMT_YUV444P10LE, 0, false,
+        makeTable<Planar16<libyuv::I410ToARGBMatrix, 0>>(),
+        makeTable<Planar16<libyuv::I410ToAR30Matrix, 0>>()
+    },
+    {
+        AV_PIX_FMT_P010LE, 1, false,
+        makeTable<SemiPlanar16<libyuv::P010ToARGBMatrix>>(),
+        makeTable<SemiPlanar16<libyuv::P010ToAR30Matrix>>()
+    },
+};
+
+const FormatKernel *findKernel(int format) {
+    for (const auto &k: kFormatKernels) {
+        if (k.format == format) {
+            return &k;
+        }
+    }
+    return nullptr;
+}
+
+// 按 frame->colorspace / color_range 选矩阵；未标注时按分辨率猜测
+// （与多数播放器一致：>= 720p 视为 BT.709）
+ColorMatrix matrixOf(const AVFrame *frame) {
+    switch (frame->colorspace) {
+    case AVCOL_SPC_BT709:
+        return kBt709;
+    case AVCOL_SPC_BT2020_NCL:
+    case AVCOL_SPC_BT2020_CL:
+        return kBt2020;
+    case AVCOL_SPC_BT470BG:
+    case AVCOL_SPC_SMPTE170M:
+    case AVCOL_SPC_SMPTE240M:
+    case AVCOL_SPC_FCC:
+        return kBt601;
+    default:
+        return frame->height >= 720 ? kBt709 : kBt601;
+    }
+}
+
+ColorRange rangeOf(const FormatKernel &kernel, const AVFrame *frame) {
+    if (kernel.fullRange || frame->color_range == AVCOL_RANGE_JPEG) {
+        return kFull;
+    }
+    return kLimited;
+}
+
+StripeKernel selectArgb(const FormatKernel &kernel, const AVFrame *frame) {
+    return kernel.argb[matrixOf(frame)][rangeOf(kernel, frame)];
+}
+
+// HDR 内容按 BT.2020 处理，标注缺失时也不回退到 601/709
+StripeKernel selectAR30(const FormatKernel &kernel, const AVFrame *frame) {
+    return kernel.ar30[kBt2020][rangeOf(kernel, frame)];
+}
+
+int defaultThreadCount() {
+    int n = static_cast<int>(std::thread::hardware_concurrency());
+    return std::clamp(n, 1, 8);
+}
+}
+
+struct YuvConverter::Impl {
+    // setThreadCount 可能与转换并发（共用实例）：替换时只换指针，
+    // 正在转换的调用持有旧池的引用直到完成
+    std::mutex poolMtx;
+    std::shared_ptr<StripePool> pool;
+    std::mutex scratchMtx;
+    std::vector<uint8_t> scratch;
+    std::vector<uint8_t> scratchScaled; // 旋转前的缩放结果（显示尺寸）
+    std::mutex toneMtx;
+    std::shared_ptr<ToneMapper> toneMapper;
+
+    std::shared_ptr<StripePool> currentPool() {
+        std::lock_guard lock(poolMtx);
+        return pool;
+    }
+
+    // HDR 元数据不变时复用查找表
+    std::shared_ptr<ToneMapper> toneMapperFor(const AVFrame *frame) {
+        const auto info = ToneMapper::probe(frame);
+        if (info.transfer == ToneMapper::Transfer::Sdr) {
+            return nullptr;
+        }
+        std::lock_guard lock(toneMtx);
+        if (!toneMapper || toneMapper->info().transfer != info.transfer ||
+            toneMapper->info().peakNits != info.peakNits) {
+            toneMapper = std::make_shared<ToneMapper>(info);
+            spdlog::info(PREFIX "tone mapping peak:{}nits kernel:{}",
+                         info.peakNits, ToneMapper::kernelName());
+        }
+        return toneMapper;
+    }
+
+    // 分块（16 行）转成 AR30 再逐行色调映射，中间数据留在缓存里
+    static void toneMapStripe(StripeKernel ar30Kernel,
+                              const ToneMapper &mapper, const AVFrame *frame,
+                              int y0, int y1, uint8_t *dst, int dstStride) {
+        constexpr int kChunkRows = 16;
+        const int width = frame->width;
+        thread_local std::vector<uint32_t> ar30;
+        ar30.resize(static_cast<size_t>(width) * kChunkRows);
+        for (int y = y0; y < y1; y += kChunkRows) {
+            const int rows = std::min(kChunkRows, y1 - y);
+            ar30Kernel(frame, y, rows,
+                       reinterpret_cast<uint8_t *>(ar30.data()), width * 4);
+            for (int r = 0; r < rows; ++r) {
+                mapper.mapRow(ar30.data() + r * width,
+                              reinterpret_cast<uint32_t *>(
+                                  dst + (y + r) * dstStride), width);
+            }
+        }
+    }
+
+    // 条带行数向上对齐到色度行，保证每个条带从色度行边界开始
+    static int stripeRows(int height, int stripes, int chromaShiftY) {
+        const int align = 1 << chromaShiftY;
+        int rows = (height + stripes - 1) / stripes;
+        return (rows + align - 1) & ~(align - 1);
+    }
+
+    void convertStriped(const FormatKernel &kernel, const AVFrame *frame,
+                        uint8_t *dst, int dstStride) {
+        const std::shared_ptr<StripePool> workers = currentPool();
+        const int height = frame->height;
+        const int stripes = std::min(
+            workers->size(), std::max(1, height >> kernel.chromaShiftY));
+        const int rows = stripeRows(height, stripes, kernel.chromaShiftY);
+        const StripeKernel argbKernel = selectArgb(kernel, frame);
+        const StripeKernel ar30Kernel = selectAR30(kernel, frame);
+        std::shared_ptr<ToneMapper> mapper;
+        if (ar30Kernel) {
+            mapper = toneMapperFor(frame);
+        }
+        workers->run(stripes, [&](int i) {
+            const int y0 = i * rows;
+            const int y1 = std::min(height, y0 + rows);
+            if (y0 >= y1) {
+                return;
+            }
+            if (mapper) {
+                toneMapStripe(ar30Kernel, *mapper, frame, y0, y1, dst,
+                              dstStride);
+                return;
+            }
+            argbKernel(frame, y0, y1 - y0, dst + y0 * dstStride, dstStride);
+        });
+    }
+
+    void convertAR30Striped(const FormatKernel &kernel, const AVFrame *frame,
+                            uint8_t *dst, int dstStride) {
+        const std::shared_ptr<StripePool> workers = currentPool();
+        const int height = frame->height;
+        const int stripes = std::min(
+            workers->size(), std::max(1, height >> kernel.chromaShiftY));
+        const int rows = stripeRows(height, stripes, kernel.chromaShiftY);
+        const StripeKernel ar30Kernel = selectAR30(kernel, frame);
+        workers->run(stripes, [&](int i) {
+            const int y0 = i * rows;
+            const int y1 = std::min(height, y0 + rows);
+            if (y0 >= y1) {
+                return;
+            }
+            ar30Kernel(frame, y0, y1 - y0, dst + y0 * dstStride, dstStride);
+        });
+    }
+
+    void scaleStriped(const uint8_t *src, int srcStride, int srcWidth,
+                      int srcHeight, uint8_t *dst, int dstStride,
+                      int dstWidth, int dstHeight) {
+        const std::shared_ptr<StripePool> workers = currentPool();
+        const int stripes = std::min(workers->size(), dstHeight);
+        const int rows = (dstHeight + stripes - 1) / stripes;
+        workers->run(stripes, [&](int i) {
+            const int y0 = i * rows;
+            const int y1 = std::min(dstHeight, y0 + rows);
+            if (y0 >= y1) {
+                return;
+            }
+            libyuv::ARGBScaleClip(src, srcStride, srcWidth, srcHeight,
+                                  dst, dstStride, dstWidth, dstHeight,
+                                  0, y0, dstWidth, y1 - y0,
+                                  libyuv::kFilterBilinear);
+        });
+    }
+
+    // 缩放 + 旋转在同一轮条带任务里完成：每个条带缩放出自己的行后立即
+    // 旋转写到 dst 对应的列（90/270）或行（180），旋转只作用于显示尺寸
+    void scaleRotateStriped(const uint8_t *src, int srcStride, int srcWidth,
+                            int srcHeight, uint8_t *dst, int dstStride,
+                            int outWidth, int outHeight, int rotation) {
+        const std::shared_ptr<StripePool> workers = currentPool();
+        const bool scale = outWidth != srcWidth || outHeight != srcHeight;
+        const int outStride = outWidth * 4;
+        if (scale) {
+            scratchScaled.resize(static_cast<size_t>(outStride) * outHeight);
+        }
+        const auto mode = static_cast<libyuv::RotationMode>(rotation);
+        const int stripes = std::min(workers->size(), outHeight);
+        const int rows = (outHeight + stripes - 1) / stripes;
+        workers->run(stripes, [&](int i) {
+            const int y0 = i * rows;
+            const int y1 = std::min(outHeight, y0 + rows);
+            if (y0 >= y1) {
+                return;
+            }
+            const uint8_t *stripe = src + y0 * srcStride;
+            int stripeStride = srcStride;
+            if (scale) {
+                libyuv::ARGBScaleClip(src, srcStride, srcWidth, srcHeight,
+                                      scratchScaled.data(), outStride,
+                                      outWidth, outHeight,
+                                      0, y0, outWidth, y1 - y0,
+                                      libyuv::kFilterBilinear);
+                stripe = scratchScaled.data() + y0 * outStride;
+                stripeStride = outStride;
+            }
+            uint8_t *target = dst;
+            if (rotation == 90) {
+                target += (outHeight - y1) * 4;
+            } else if (rotation == 180) {
+                target += (outHeight - y1) * dstStride;
+            } else {
+                target += y0 * 4;
+            }
+            libyuv::ARGBRotate(stripe, stripeStride, target, dstStride,
+                               outWidth, y1 - y0, mode);
+        });
+    }
+};
+
+YuvConverter::YuvConverter(int threads): mImpl(new Impl{}) {
+    setThreadCount(threads);
+}
+
+YuvConverter::~YuvConverter() {
+    delete mImpl;
+}
+
+YuvConverter &YuvConverter::instance() {
+    static YuvConverter converter{};
+    return converter;
+}
+
+void YuvConverter::setThreadCount(int threads) {
+    if (threads <= 0) {
+        threads = defaultThreadCount();
+    }
+    auto pool = std::make_shared<StripePool>(threads);
+    {
+        std::lock_guard lock(mImpl->poolMtx);
+        mImpl->pool.swap(pool);
+    }
+    // 旧池在锁外、最后一个使用者完成后析构
+    spdlog::info(PREFIX "thread count:{}", threads);
+}
+
+int YuvConverter::threadCount() const {
+    return mImpl->currentPool()->size();
+}
+
+uint64_t YuvConverter::fingerprint(const AVFrame *frame, int rowStep) {
+    // 解码器的缓冲池会复用同一块内存，缓冲区指针相同并不代表内容相同，
+    // 所以只能按内容哈希。各条带分别哈希自己的行，再按顺序合并
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(
+        static_cast<AVPixelFormat>(frame->format));
+    if (!desc) {
+        return 0;
+    }
+    const int planes = av_pix_fmt_count_planes(
+        static_cast<AVPixelFormat>(frame->format));
+    const int height = frame->height;
+    const std::shared_ptr<StripePool> workers = mImpl->currentPool();
+    const int stripes = std::min(workers->size(),
+                                 std::max(1, height >> desc->log2_chroma_h));
+    const int rows = Impl::stripeRows(height, stripes, desc->log2_chroma_h);
+    std::vector<uint32_t> hashes(stripes);
+    workers->run(stripes, [&](int i) {
+        const int y0 = i * rows;
+        const int y1 = std::min(height, y0 + rows);
+        uint32_t hash = 5381;
+        for (int p = 0; p < planes && y0 < y1; ++p) {
+            const int shift = p == 0 ? 0 : desc->log2_chroma_h;
+            const int bytes = av_image_get_linesize(
+                static_cast<AVPixelFormat>(frame->format), frame->width, p);
+            const int r1 = AV_CEIL_RSHIFT(y1, shift);
+            int r0 = y0 >> shift;
+            r0 += (rowStep - r0 % rowStep) % rowStep;
+            for (int r = r0; r < r1; r += rowStep) {
+                hash = libyuv::HashDjb2(
+                    frame->data[p] + r * frame->linesize[p], bytes, hash);
+            }
+        }
+        hashes[i] = hash;
+    });
+    uint64_t result = static_cast<uint64_t>(rowStep) << 56 ^
+                      static_cast<uint64_t>(frame->format) << 48 ^
+                      static_cast<uint64_t>(frame->width) << 24 ^
+                      static_cast<uint64_t>(frame->height);
+    for (uint32_t h: hashes) {
+        result = result * 1000003 ^ h;
+    }
+    return result;
+}
+
+bool YuvConverter::isSupported(int format) {
+    return findKernel(format) != nullptr;
+}
+
+void YuvConverter::convert(const AVFrame *frame, uint8_t *dst,
+                           int dstStride) {
+    const FormatKernel *kernel = findKernel(frame->format);
+    if (!kernel) {
+        spdlog::error(PREFIX "unsupported format:{}", frame->format);
+        return;
+    }
+    mImpl->convertStriped(*kernel, frame, dst, dstStride);
+}
+
+bool YuvConverter::convertAR30(const AVFrame *frame, uint8_t *dst,
+                               int dstStride) {
+    const FormatKernel *kernel = findKernel(frame->format);
+    if (!kernel || !selectAR30(*kernel, frame)) {
+        return false;
+    }
+    mImpl->convertAR30Striped(*kernel, frame, dst, dstStride);
+    return true;
+}
+
+void YuvConverter::convertScaled(const AVFrame *frame, uint8_t *dst,
+                                 int dstStride, int dstWidth, int dstHeight,
+                                 int rotation) {
+    if (rotation != 0) {
+        convertScaledRotated(frame, dst, dstStride, dstWidth, dstHeight,
+                             rotation);
+        return;
+    }
+    if (dstWidth == frame->width && dstHeight == frame->height) {
+        convert(frame, dst, dstStride);
+        return;
+    }
+    const FormatKernel *kernel = findKernel(frame->format);
+    if (!kernel) {
+        spdlog::error(PREFIX "unsupported format:{}", frame->format);
+        return;
+    }
+    std::lock_guard lock(mImpl->scratchMtx);
+    const int stride = frame->width * 4;
+    mImpl->scratch.resize(static_cast<size_t>(stride) * frame->height);
+    mImpl->convertStriped(*kernel, frame, mImpl->scratch.data(), stride);
+    mImpl->scaleStriped(mImpl->scratch.data(), stride, frame->width,
+                        frame->height, dst, dstStride, dstWidth, dstHeight);
+}
+
+void YuvConverter::convertScaledRotated(const AVFrame *frame, uint8_t *dst,
+                                        int dstStride, int dstWidth,
+                                        int dstHeight, int rotation) {
+    if (rotation != 90 && rotation != 180 && rotation != 270) {
+        spdlog::error(PREFIX "unsupported rotation:{}", rotation);
+        return;
+    }
+    const FormatKernel *kernel = findKernel(frame->format);
+    if (!kernel) {
+        spdlog::error(PREFIX "unsupported format:{}", frame->format);
+        return;
+    }
+    // 旋转前的输出尺寸
+    const bool swap = rotation != 180;
+    const int outWidth = swap ? dstHeight : dstWidth;
+    const int outHeight = swap ? dstWidth : dstHeight;
+
+    std::lock_guard lock(mImpl->scratchMtx);
+    const int stride = frame->width * 4;
+    mImpl->scratch.resize(static_cast<size_t>(stride) * frame->height);
+    mImpl->convertStriped(*kernel, frame, mImpl->scratch.data(), stride);
+    mImpl->scaleRotateStriped(mImpl->scratch.data(), stride, frame->width,
+                              frame->height, dst, dstStride, outWidth,
+                              outHeight, rotation);
+}
+
+AVFrame *YuvConverter::cropView(const AVFrame *frame, int x, int y,
+                                int width, int height) {
+    // 2 像素对齐覆盖所有支持格式的色度下采样
+    x = std::clamp(x & ~1, 0, frame->width);
+    y = std::clamp(y & ~1, 0, frame->height);
+    width = std::min(width, frame->width - x);
+    height = std::min(height, frame->height - y);
+    if (width <= 0 || height <= 0) {
+        return nullptr;
+    }
+    AVFrame *view = av_frame_clone(frame);
+    if (!view) {
+        return nullptr;
+    }
+    view->crop_left = x;
+    view->crop_top = y;
+    view->crop_right = frame->width - x - width;
+    view->crop_bottom = frame->height - y - height;
+    if (av_frame_apply_cropping(view, AV_FRAME_CROP_UNALIGNED) < 0) {
+        spdlog::error(PREFIX "crop failed");
+        av_frame_free(&view);
+        return nullptr;
+    }
+    return view;
+}
+
+void YuvConverter::benchmark(int width, int height, int maxThreads) {
+    if (maxThreads <= 0) {
+        maxThreads = static_cast<int>(std::thread::hardware_concurrency());
+    }
+    AVFrame *frame = av_frame_alloc();
+    frame->format = AV_PIX_FMT_YUV420P;
+    frame->width = width;
+    frame->height = height;
+    if (av_frame_get_buffer(frame, 32) < 0) {
+        spdlog::error(PREFIX "benchmark alloc failed");
+        av_frame_free(&frame);
+        return;
+    }
+    for (int p = 0; p < 3; ++p) {
+        const int rows = p == 0 ? height : (height + 1) / 2;
+        std::fill_n(frame->data[p], frame->linesize[p] * rows,
+                    static_cast<uint8_t>(p == 0 ? 96 : 128));
+    }
+
+    // 10 位 PQ 帧，走 AR30 + 色调映射路径
+    AVFrame *hdrFrame = av_frame_alloc();
+    hdrFrame->format = AV_PIX_FMT_YUV420P10LE;
+    hdrFrame->width = width;
+    hdrFrame->height = height;
+    hdrFrame->color_trc = AVCOL_TRC_SMPTE2084;
+    if (av_frame_get_buffer(hdrFrame, 32) < 0) {
+        spdlog::error(PREFIX "benchmark alloc failed");
+        av_frame_free(&frame);
+        av_frame_free(&hdrFrame);
+        return;
+    }
+    for (int p = 0; p < 3; ++p) {
+        const int rows = p == 0 ? height : (height + 1) / 2;
+        auto *data = reinterpret_cast<uint16_t *>(hdrFrame->data[p]);
+        std::fill_n(data, hdrFrame->linesize[p] / 2 * rows,
+                    static_cast<uint16_t>(p == 0 ? 600 : 512));
+    }
+
+    const int scaledW = 1920;
+    const int scaledH = 1080;
+    std::vector<uint8_t> full(static_cast<size_t>(width) * height * 4);
+    std::vector<uint8_t> scaled(static_cast<size_t>(scaledW) * scaledH * 4);
+    constexpr int kIterations = 20;
+
+    using namespace std::chrono;
+    for (int threads = 1; threads <= maxThreads; ++threads) {
+        YuvConverter converter{threads};
+        converter.convert(frame, full.data(), width * 4); // 预热
+
+        auto begin = steady_clock::now();
+        for (int i = 0; i < kIterations; ++i) {
+            converter.convert(frame, full.data(), width * 4);
+        }
+        auto convertUs = duration_cast<microseconds>(
+                             steady_clock::now() - begin).count() /
+                         kIterations;
+
+        begin = steady_clock::now();
+        for (int i = 0; i < kIterations; ++i) {
+            converter.convertScaled(frame, scaled.data(), scaledW * 4,
+                                    scaledW, scaledH);
+        }
+        auto scaledUs = duration_cast<microseconds>(
+                            steady_clock::now() - begin).count() /
+                        kIterations;
+
+        // 旋转输出像素数与 scaled 相同，便于和未旋转的基线对比
+        begin = steady_clock::now();
+        for (int i = 0; i < kIterations; ++i) {
+            converter.convertScaled(frame, scaled.data(), scaledH * 4,
+                                    scaledH, scaledW, 90);
+        }
+        auto rotatedUs = duration_cast<microseconds>(
+                             steady_clock::now() - begin).count() /
+                         kIterations;
+
+        begin = steady_clock::now();
+        for (int i = 0; i < kIterations; ++i) {
+            converter.convert(hdrFrame, full.data(), width * 4);
+        }
+        auto hdrUs = duration_cast<microseconds>(
+                         steady_clock::now() - begin).count() / kIterations;
+
+        spdlog::info(PREFIX "{}x{} threads:{} convert:{:.2f}ms "
+                     "convert+scale({}x{}):{:.2f}ms "
+                     "convert+scale+rotate90:{:.2f}ms "
+                     "hdr10 tonemap:{:.2f}ms",
+                     width, height, threads, convertUs / 1000.0,
+                     scaledW, scaledH, scaledUs / 1000.0,
+                     rotatedUs / 1000.0, hdrUs / 1000.0);
+    }
+    av_frame_free(&frame);
+    av_frame_free(&hdrFrame);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+
+struct AVFrame;
+
+// YUV -> ARGB 转换 + 缩放，按水平条带切分到常驻线程池并行执行。
+// 每种像素格式（I420/NV12/I422/I444 及其 10 位版本）直接映射到对应的
+// libyuv 内核，不经过 swscale 中间转换；色彩矩阵（BT.601/709/2020）与
+// 范围（limited/full）取自 frame->colorspace / color_range，常见组合都有
+// 编译期特化的内核，热循环内没有分支。
+// 带 PQ/HLG 传输特性的 10 位帧会经过 ToneMapper 映射到 SDR。
+// 条带边界按色度行对齐，避免 U/V 行被两个条带共享。
+class YuvConverter {
+public:
+    // threads <= 0 时使用 hardware_concurrency，最多 8 个
+    explicit YuvConverter(int threads = 0);
+    ~YuvConverter();
+
+    YuvConverter(const YuvConverter &) = delete;
+    YuvConverter &operator=(const YuvConverter &) = delete;
+
+    // 两个渲染控件共用的实例
+    static YuvConverter &instance();
+
+    void setThreadCount(int threads);
+    int threadCount() const;
+
+    // frame->format 是否有对应的转换内核
+    static bool isSupported(int format);
+
+    // 帧内容指纹（各平面 HashDjb2，按条带并行），用于跳过重复帧的转换。
+    // rowStep > 1 时只哈希每 rowStep 行，作为廉价的预筛
+    uint64_t fingerprint(const AVFrame *frame, int rowStep = 1);
+
+    // 原尺寸转换，dst 至少 frame->height * dstStride 字节
+    void convert(const AVFrame *frame, uint8_t *dst, int dstStride);
+
+    // 10 位格式转成 AR30（BT.2020 非线性 RGB，不做色调映射），
+    // 供 GL 着色器做色调映射；不支持的格式返回 false
+    bool convertAR30(const AVFrame *frame, uint8_t *dst, int dstStride);
+
+    // 转换并缩放到 dstWidth x dstHeight（旋转后的尺寸）。
+    // rotation 为顺时针 0/90/180/270，旋转与缩放在同一轮条带任务中完成
+    void convertScaled(const AVFrame *frame, uint8_t *dst, int dstStride,
+                       int dstWidth, int dstHeight, int rotation = 0);
+
+    // 返回只覆盖 (x, y, width, height) 区域的帧引用：不拷贝像素，只按
+    // 色度对齐后偏移各平面指针。调用方用 av_frame_free 释放，失败返回 nullptr
+    static AVFrame *cropView(const AVFrame *frame, int x, int y, int width,
+                             int height);
+
+    // 以 1..maxThreads 线程分别测量 width x height 帧的转换/缩放耗时，
+    // 结果输出到日志
+    static void benchmark(int width, int height, int maxThreads = 0);
+
+private:
+    void convertScaledRotated(const AVFrame *frame, uint8_t *dst,
+                              int dstStride, int dstWidth, int dstHeight,
+                              int rotation);
+
+    struct Impl;
+    Impl *mImpl{};
+};
+
+// 判断新帧内容是否与上一帧相同。先哈希每 16 行做预筛，运动画面在这一步
+// 就能判定变化；预筛相同再算完整指纹，连续重复帧从第二次起被识别
+class FrameChangeDetector {
+public:
+    bool changed(const AVFrame *frame) {
+        YuvConverter &converter = YuvConverter::instance();
+        const uint64_t sparse = converter.fingerprint(frame, kSparseStep);
+        if (sparse != mSparse) {
+            mSparse = sparse;
+            mFull = 0;
+            return true;
+        }
+        const uint64_t full = converter.fingerprint(frame);
+        if (full != mFull) {
+            mFull = full;
+            return true;
+        }
+        return false;
+    }
+
+    // 视图（缩放/旋转/尺寸）变化后调用，下一帧一定重新转换
+    void reset() {
+        mSparse = 0;
+        mFull = 0;
+    }
+
+private:
+    static constexpr int kSparseStep = 16;
+    uint64_t mSparse{};
+    uint64_t mFull{};
+};
@@ -0,0 +1,76 @@
+#include "PlayerEngine.h"
+#include <spdlog/spdlog.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+// modernplayer_pull <url> [--unthrottled] [--duration=秒]：只链接
+// modernplayer_core（不依赖 Qt Widgets 和事件循环），用 PlayerEngine 拉取
+// 帧和 PCM，3 秒没有新帧或到时长后结束，打印吞吐和丢弃数
+int main(int argc, char *argv[]) {
+    using namespace std::chrono;
+    constexpr auto kIdleTimeout = 3s;
+    constexpr auto kWait = 100ms;
+    constexpr const char kDuration[] = "--duration=";
+    std::string url;
+    PlayerEngine::Options options;
+    double limitSeconds = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--unthrottled") == 0) {
+            options.unthrottled = true;
+        } else if (std::strncmp(argv[i], kDuration,
+                                sizeof(kDuration) - 1) == 0) {
+            limitSeconds = std::atof(argv[i] + sizeof(kDuration) - 1);
+        } else {
+            url = argv[i];
+        }
+    }
+    if (url.empty()) {
+        spdlog::error("[pull] usage: {} <url> [--unthrottled] "
+                      "[--duration=seconds]", argv[0]);
+        return 1;
+    }
+
+    PlayerEngine engine(options);
+    if (!engine.open(url)) {
+        spdlog::error("[pull] open failed: {}", url);
+        return 1;
+    }
+    std::atomic<uint64_t> pcmBytes = 0;
+    std::jthread audio([&](std::stop_token token) {
+        while (!token.stop_requested()) {
+            if (auto chunk = engine.nextAudio(kWait)) {
+                pcmBytes += chunk->data.size();
+            }
+        }
+    });
+    const auto begin = steady_clock::now();
+    auto lastFrame = begin;
+    uint64_t frames = 0;
+    engine.play();
+    while (true) {
+        const auto now = steady_clock::now();
+        if (now - lastFrame >= kIdleTimeout || (limitSeconds > 0 &&
+                duration<double>(now - begin).count() >= limitSeconds)) {
+            break;
+        }
+        if (engine.nextVideoFrame(kWait)) {
+            ++frames;
+            lastFrame = steady_clock::now();
+        }
+    }
+    const double wall = duration<double>(steady_clock::now() - begin).
+        count();
+    engine.close();
+    audio = {};
+    const PlayerEngine::Stats stats = engine.stats();
+    spdlog::info("[pull] {} wall={:.2f}s frames={} ({:.1f}fps) dropped={} "
+                 "pcm={}KB dropped chunks={}", url, wall, frames,
+                 frames / std::max(wall, 1e-9), stats.droppedVideoFrames,
+                 pcmBytes / 1024, stats.droppedAudioChunks);
+    return 0;
+}
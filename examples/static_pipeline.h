@@ -0,0 +1,26 @@
+#pragma once
+
+#include "FramePipeline.h"
+#include "HeadlessSinks.h"
+
+// 接收端和时钟固定的 PlayerPipeline：进程内的播放器共用一对无显示接收端，
+// 每帧路径没有虚调用和锁。构建：
+//     cmake -DMODERNPLAYER_PIPELINE_HEADER=examples/static_pipeline.h
+using PlayerPipeline = FramePipeline<StaticSink<HeadlessVideoSink>,
+                                     FixedClock,
+                                     StaticAudio<HeadlessAudioSink>>;
+
+inline HeadlessVideoSink &staticVideoSink() {
+    static HeadlessVideoSink sink;
+    return sink;
+}
+
+inline HeadlessAudioSink &staticAudioSink() {
+    static HeadlessAudioSink sink;
+    return sink;
+}
+
+inline PlayerPipeline makePlayerPipeline(const PlaybackClock &clock,
+                                         AudioSink *) {
+    return PlayerPipeline{clock, staticAudioSink(), staticVideoSink()};
+}
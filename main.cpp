@@ -1,10 +1,427 @@
 #include <QApplication>
+#include <QTimer>
 #include "MainWindow.h"
 #include <spdlog/spdlog.h>
+#include "YuvConverter.h"
+#include "FramePipeline.h"
+#include "PlayerController.h"
+#include "HeadlessSinks.h"
+#include "StageCoroutine.h"
+#include "StagePool.h"
+#include "VideoWallWidget.h"
+#include "CompareWidget.h"
+#include "ComparePlayer.h"
+#include "QualityMetrics.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <thread>
+#include <vector>
 
+namespace {
+// "--name=value" 形式的参数，没有时返回空
+QString argValue(int argc, char *argv[], const char *name) {
+    const size_t len = std::strlen(name);
+    for (int i = 1; i < argc; ++i) {
+        if (std::strncmp(argv[i], name, len) == 0 && argv[i][len] == '=') {
+            return QString::fromLocal8Bit(argv[i] + len + 1);
+        }
+    }
+    return {};
+}
+
+// --sched-audio/present/decode/read=<policy> 给该阶段独立的线程组，
+// --sched-pool=<policy> 设置共用线程，格式见 ThreadPolicy::parse
+void configureThreads(int argc, char *argv[]) {
+    StagePool::ThreadConfig config;
+    const auto parse = [&](const char *flag) -> std::optional<ThreadPolicy> {
+        const QString text = argValue(argc, argv, flag);
+        if (text.isEmpty()) {
+            return std::nullopt;
+        }
+        auto policy = ThreadPolicy::parse(text.toStdString());
+        if (!policy) {
+            spdlog::error("invalid {}={}", flag, text.toStdString());
+        }
+        return policy;
+    };
+    config.dedicated[static_cast<int>(StagePool::Stage::Audio)] =
+        parse("--sched-audio");
+    config.dedicated[static_cast<int>(StagePool::Stage::Present)] =
+        parse("--sched-present");
+    config.dedicated[static_cast<int>(StagePool::Stage::Decode)] =
+        parse("--sched-decode");
+    config.dedicated[static_cast<int>(StagePool::Stage::Read)] =
+        parse("--sched-read");
+    if (auto shared = parse("--sched-pool")) {
+        config.shared = std::move(*shared);
+    }
+    StagePool::configure(config);
+    spdlog::info("[threads] {}", StagePool::instance().threadReport());
+}
+
+bool hasArg(int argc, char *argv[], const char *name) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// 无界面播放：--headless=<url> [--unthrottled] [--memory] [--wav=out.wav]
+// [--duration=秒]。不创建窗口和声卡输出，播放结束（3 秒没有新数据）后打印统计
+int runHeadless(int argc, char *argv[], const QString &url) {
+    QCoreApplication a(argc, argv);
+    constexpr auto kIdleTimeout = std::chrono::seconds(3);
+    constexpr auto kPollInterval = std::chrono::milliseconds(200);
+
+    HeadlessVideoSink video(hasArg(argc, argv, "--memory")
+                                ? HeadlessVideoSink::Mode::Memory
+                                : HeadlessVideoSink::Mode::Null);
+    HeadlessAudioSink audio(argValue(argc, argv, "--wav"));
+    const double duration = argValue(argc, argv, "--duration").toDouble();
+
+    PlayerController controller;
+    controller.AddVideoSink(&video);
+    controller.SetAudioSink(&audio);
+    controller.SetUnthrottled(hasArg(argc, argv, "--unthrottled"));
+    if (!controller.Open(url.toStdString())) {
+        spdlog::error("[headless] open failed: {}", url.toStdString());
+        return 1;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    const auto begin = Clock::now();
+    auto lastProgress = begin;
+    int64_t lastCount = -1;
+    QTimer poll;
+    QObject::connect(&poll, &QTimer::timeout, [&] {
+        const auto now = Clock::now();
+        const int64_t count = video.frames() + audio.writes();
+        if (count != lastCount) {
+            lastCount = count;
+            lastProgress = now;
+        }
+        const double elapsed = std::chrono::duration<double>(now - begin).
+            count();
+        if (now - lastProgress >= kIdleTimeout || (
+                duration > 0 && elapsed >= duration)) {
+            poll.stop();
+            QCoreApplication::quit();
+        }
+    });
+    poll.start(kPollInterval);
+    controller.Play();
+    QCoreApplication::exec();
+
+    const double wall = std::chrono::duration<double>(
+        Clock::now() - begin).count();
+    controller.Close();
+    controller.RemoveVideoSink(&video);
+    audio.close();
+    spdlog::info("[headless] {} wall={:.2f}s", url.toStdString(), wall);
+    spdlog::info("[headless] {}", video.report());
+    spdlog::info("[headless] {}", audio.report());
+    spdlog::info("[headless] {}", StagePool::instance().report());
+    return 0;
+}
+
+// 视频墙：--wall=<url>[,<url>...] [--tiles=N]。N 路（url 轮流使用）
+// 合成到一个 GL 控件，统一静音，同时开始播放
+int runVideoWall(int argc, char *argv[], const QString &urls) {
+    QApplication a(argc, argv);
+    const QStringList sources = urls.split(',', Qt::SkipEmptyParts);
+    if (sources.isEmpty()) {
+        spdlog::error("[wall] expected at least one url: --wall=<url>");
+        return 1;
+    }
+    const int requested = argValue(argc, argv, "--tiles").toInt();
+    const int count = requested > 0 ? requested : sources.size();
+
+    VideoWallWidget wall;
+    wall.setWindowTitle("ModernPlayer - wall");
+    wall.resize(1280, 720);
+    wall.setTileCount(count);
+    wall.show();
+
+    HeadlessAudioSink mute;
+    std::vector<std::unique_ptr<PlayerController>> players;
+    const QSize tile = wall.tileSize();
+    for (int i = 0; i < count; ++i) {
+        auto player = std::make_unique<PlayerController>();
+        player->SetDecodeSizeHint(tile.width(), tile.height());
+        player->SetAudioSink(&mute);
+        player->AddVideoSink(wall.tileSink(i));
+        player->Open(sources[i % sources.size()].toStdString());
+        players.push_back(std::move(player));
+    }
+    // 窗口缩放后按新的格子尺寸解码
+    QObject::connect(&wall, &VideoWallWidget::tileSizeChanged,
+                     [&players](QSize size) {
+                         for (auto &player: players) {
+                             player->SetDecodeSizeHint(size.width(),
+                                                       size.height());
+                         }
+                     });
+    // 全部打开后再一起开始，各格的时钟起点相差无几
+    for (auto &player: players) {
+        player->Play();
+    }
+    const int ret = QApplication::exec();
+    players.clear();
+    spdlog::info("[wall] {}", StagePool::instance().report());
+    return ret;
+}
+
+// 编码对比：--compare=<a>,<b> [--wipe] [--metrics] [--metrics-csv=out.csv]。
+// 两路共用 A 的时钟，同步暂停和精确 seek，并排或擦除显示，退出时输出帧配对
+// 统计；开启质量计算时显示 PSNR/SSIM 曲线，退出时可导出 CSV
+int runCompare(int argc, char *argv[], const QString &urls) {
+    QApplication a(argc, argv);
+    const QStringList sources = urls.split(',', Qt::SkipEmptyParts);
+    if (sources.size() != 2) {
+        spdlog::error("[compare] expected two urls: --compare=<a>,<b>");
+        return 1;
+    }
+    CompareWidget view;
+    view.setWindowTitle("ModernPlayer - compare");
+    view.resize(1280, 480);
+    if (hasArg(argc, argv, "--wipe")) {
+        view.setMode(CompareWidget::Mode::Wipe);
+    }
+    // --metrics 或 --metrics-csv=<path> 时计算配对帧的 PSNR/SSIM
+    const QString csv = argValue(argc, argv, "--metrics-csv");
+    std::unique_ptr<QualityMetrics> metrics;
+    if (hasArg(argc, argv, "--metrics") || !csv.isEmpty()) {
+        metrics = std::make_unique<QualityMetrics>();
+        view.setMetrics(metrics.get());
+    }
+    ComparePlayer player(&view);
+    QObject::connect(&view, &CompareWidget::pauseRequested, [&player] {
+        player.Play();
+    });
+    QObject::connect(&view, &CompareWidget::seekRequested,
+                     [&player](qint64 deltaMs) {
+                         player.SeekBy(deltaMs);
+                     });
+    player.Open(sources[0].toStdString(), sources[1].toStdString());
+    view.show();
+    player.Play();
+    const int ret = QApplication::exec();
+    player.Close();
+    spdlog::info("[compare] {}", view.report());
+    if (metrics) {
+        view.setMetrics(nullptr);
+        spdlog::info("[compare] {}", metrics->report());
+        if (!csv.isEmpty()) {
+            metrics->writeCsv(csv.toStdString());
+        }
+    }
+    return ret;
+}
+
+// 最近呈现的一帧的时间戳（相对第一帧），检查实例实际解码到的位置。
+// CurrentPosition 由墙上时钟推算，实例之间的状态串了也看不出来
+class PresentedPtsProbe final : public VideoSink {
+public:
+    void onVideoFrame(const FrameRef &frame) override {
+        if (frame->pts == AV_NOPTS_VALUE || frame->time_base.den == 0) {
+            return;
+        }
+        const auto ms = static_cast<int64_t>(
+            frame->pts * av_q2d(frame->time_base) * 1000);
+        int64_t origin = mOriginMs;
+        if (origin == AV_NOPTS_VALUE) {
+            mOriginMs = origin = ms;
+        }
+        mLastMs = ms - origin;
+    }
+
+    bool alwaysActive() const override {
+        return true;
+    }
+
+    // 还没有收到帧时为 -1
+    int64_t lastMs() const {
+        return mLastMs;
+    }
+
+private:
+    // 只在呈现线程写
+    int64_t mOriginMs = AV_NOPTS_VALUE;
+    std::atomic<int64_t> mLastMs{-1};
+};
+
+// 多实例隔离检查：--stress-sessions=<url> [--sessions=16]。
+// 同时播放 N 个实例，并发 seek 奇数号、并发关闭偶数号，检查其余实例的
+// 播放位置与出帧不受影响。有实例不符合预期时返回 1
+int runSessionStress(int argc, char *argv[], const QString &url) {
+    QCoreApplication a(argc, argv);
+    using namespace std::chrono;
+    constexpr auto kWarmup = 2s;
+    constexpr auto kSettle = 2s;
+    constexpr int64_t kToleranceMs = 1000;
+    const int requested = argValue(argc, argv, "--sessions").toInt();
+    const int count = requested > 1 ? requested : 16;
+
+    struct Session {
+        HeadlessVideoSink video;
+        HeadlessAudioSink audio;
+        PresentedPtsProbe presented;
+        PlayerController controller;
+        int64_t seekTarget = -1;
+        int64_t framesAtClose = -1;
+    };
+    std::vector<std::unique_ptr<Session>> sessions;
+    for (int i = 0; i < count; ++i) {
+        auto session = std::make_unique<Session>();
+        session->controller.AddVideoSink(&session->video);
+        session->controller.AddVideoSink(&session->presented);
+        session->controller.SetAudioSink(&session->audio);
+        session->controller.Open(url.toStdString());
+        sessions.push_back(std::move(session));
+    }
+    for (auto &session: sessions) {
+        session->controller.Play();
+    }
+    std::this_thread::sleep_for(kWarmup);
+
+    // 每个实例在自己的线程里操作，和其他实例同时进行
+    auto concurrently = [&](auto &&op) {
+        std::vector<std::jthread> workers;
+        for (int i = 0; i < count; ++i) {
+            workers.emplace_back([&, i] { op(i, *sessions[i]); });
+        }
+    };
+    int failures = 0;
+    auto check = [&](bool ok, int i, const std::string &what) {
+        if (!ok) {
+            ++failures;
+            spdlog::error("[stress] session {} {}", i, what);
+        }
+    };
+
+    const auto seekTime = steady_clock::now();
+    concurrently([&](int i, Session &session) {
+        const int64_t total = session.controller.CurrentPosition().second;
+        if (i % 2 == 1 && total > 0) {
+            // 连续几次 seek，只有最后一次应当生效，且只生效一次
+            session.seekTarget = total * (i + 1) / (count + 2);
+            session.controller.SeekTo(total / (count + 2));
+            session.controller.SeekTo(total * i / (count + 2));
+            session.controller.SeekTo(session.seekTarget);
+        }
+    });
+    std::this_thread::sleep_for(kSettle);
+    const int64_t sinceSeek = duration_cast<milliseconds>(
+        steady_clock::now() - seekTime).count();
+    for (int i = 0; i < count; ++i) {
+        // 按实际呈现的帧检查：seek 过的实例从自己的目标继续，
+        // 没有 seek 的实例按自己的时钟继续走
+        const int64_t pts = sessions[i]->presented.lastMs();
+        const int64_t total = sessions[i]->controller.CurrentPosition().second;
+        const int64_t expected = sessions[i]->seekTarget >= 0
+                                     ? sessions[i]->seekTarget + sinceSeek
+                                     : duration_cast<milliseconds>(
+                                           kWarmup).count() + sinceSeek;
+        check(pts >= 0 &&
+              std::abs(pts - std::min(expected, total)) <= kToleranceMs, i,
+              fmt::format("presented frame at {}ms, expected ~{}ms", pts,
+                          expected));
+    }
+
+    // Close 时清零，先取出 seek 阶段的命令耗时
+    std::vector<CommandTimings> seekTimings;
+    for (auto &session: sessions) {
+        seekTimings.push_back(session->controller.CommandLatency());
+    }
+
+    std::vector<int64_t> framesBefore;
+    for (auto &session: sessions) {
+        framesBefore.push_back(session->video.frames());
+    }
+    concurrently([&](int i, Session &session) {
+        if (i % 2 == 0) {
+            // Close 返回时工作线程已退出，之后不应再有帧
+            session.controller.Close();
+            session.framesAtClose = session.video.frames();
+        }
+    });
+    std::this_thread::sleep_for(kSettle);
+    for (int i = 0; i < count; ++i) {
+        const int64_t frames = sessions[i]->video.frames();
+        if (i % 2 == 0) {
+            check(frames == sessions[i]->framesAtClose, i,
+                  "delivered frames after Close");
+        } else {
+            check(frames > framesBefore[i], i,
+                  "stalled after other sessions closed");
+        }
+    }
+
+    concurrently([&](int, Session &session) {
+        session.controller.Close();
+    });
+    for (int i = 0; i < count; ++i) {
+        spdlog::info("[stress] session {} {}", i,
+                     sessions[i]->video.report());
+        if (sessions[i]->seekTarget >= 0) {
+            spdlog::info("[stress] session {} {}", i,
+                         seekTimings[i].report());
+        }
+    }
+    spdlog::info("[stress] {}", StagePool::instance().report());
+    spdlog::info("[stress] {} sessions, {} failures", count, failures);
+    return failures ? 1 : 0;
+}
+}
 
 int main(int argc, char *argv[]) {
+    configureThreads(argc, argv);
+    if (const QString url = argValue(argc, argv, "--headless"); !url.
+        isEmpty()) {
+        return runHeadless(argc, argv, url);
+    }
+    if (const QString urls = argValue(argc, argv, "--compare"); !urls.
+        isEmpty()) {
+        return runCompare(argc, argv, urls);
+    }
+    if (const QString urls = argValue(argc, argv, "--wall"); !urls.
+        isEmpty()) {
+        return runVideoWall(argc, argv, urls);
+    }
+    if (const QString url = argValue(argc, argv, "--stress-sessions"); !url.
+        isEmpty()) {
+        return runSessionStress(argc, argv, url);
+    }
     QApplication a(argc, argv);
+    if (QApplication::arguments().contains("--bench-convert")) {
+        YuvConverter::benchmark(3840, 2160);
+        YuvConverter::benchmark(7680, 4320);
+        return 0;
+    }
+    if (QApplication::arguments().contains("--bench-metrics")) {
+        QualityMetrics::benchmark(1920, 1080);
+        return 0;
+    }
+    if (QApplication::arguments().contains("--bench-coroutines")) {
+        StageCoroutine::benchmark();
+        StageCoroutine::benchmark(32);
+        return 0;
+    }
+    if (QApplication::arguments().contains("--bench-dispatch")) {
+        PlayerController::BenchmarkDispatch();
+        return 0;
+    }
+    if (QApplication::arguments().contains("--bench-pipeline")) {
+        benchmarkFramePipeline();
+        return 0;
+    }
     // a.setStyleSheet(R"(*{border: 1px solid green;})");
     MainWindow w{};
     w.show();